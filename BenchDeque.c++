@@ -0,0 +1,925 @@
+// -----------------------------
+// projects/deque/BenchDeque.c++
+// -----------------------------
+
+/*
+To compile the benchmarks:
+    % g++ -std=c++11 -O2 -DNDEBUG -pedantic -Wall BenchDeque.c++ -o BenchDeque -lpthread
+
+To run every benchmark, or only those whose name starts with a prefix:
+    % BenchDeque
+    % BenchDeque spsc
+
+Each result is one line: benchmark name, value, unit.
+With --csv first the lines are name,value,unit, to keep and diff between releases:
+    % BenchDeque --csv ops > BenchDeque.csv
+
+The mapped benchmark writes its backlog to disk, see bench_mapped:
+    % BENCH_MAPPED_MB=65536 BENCH_MAPPED_DIR=/data BenchDeque mapped
+
+The huge benchmark sizes its deques with BENCH_HUGE_MB, see bench_huge:
+    % BENCH_HUGE_MB=16384 BenchDeque huge
+*/
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // max, min, sort
+#include <chrono>    // duration, steady_clock
+#include <cstdio>    // fclose, fgets, fopen, printf, snprintf, sscanf
+#include <cstdlib>   // atoll, getenv, system
+#include <cstring>   // strcmp, strncmp
+#include <deque>     // deque
+#include <memory>    // allocator
+#include <mutex>     // lock_guard, mutex
+#include <numeric>   // accumulate
+#include <random>    // mt19937, uniform_int_distribution, uniform_real_distribution
+#include <string>    // string
+#include <thread>    // thread, yield
+#include <type_traits> // false_type, true_type
+#include <vector>    // vector
+
+#include "Deque.h"
+#include "MappedDeque.h"
+
+// -----
+// clock
+// -----
+
+typedef std::chrono::steady_clock bench_clock;
+
+long long now_ns () {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count();}
+
+// ------
+// report
+// ------
+
+bool csv = false;
+
+void report (const char* name, double value, const char* unit) {
+    if (csv)
+        std::printf("%s,%.2f,%s\n", name, value, unit);
+    else
+        std::printf("%-48s %14.2f %s\n", name, value, unit);}
+
+/**
+ * @param v the latencies in ns, sorted in place
+ * report the median and the 99th percentile under name
+ */
+void report_latency (const char* name, std::vector<long long>& v) {
+    std::sort(v.begin(), v.end());
+    char s[128];
+    std::snprintf(s, sizeof(s), "%s.p50", name);
+    report(s, v[v.size() / 2], "ns");
+    std::snprintf(s, sizeof(s), "%s.p99", name);
+    report(s, v[v.size() * 99 / 100], "ns");}
+
+// ----------
+// operations
+// ----------
+
+/**
+ * counts what every bench_allocator allocates
+ */
+struct heap_stats {
+    static long long allocations;
+    static long long bytes;	// live
+    static long long peak;	// most live since the last reset
+
+    static void reset () {
+        allocations = 0;
+        peak = bytes;}};
+
+long long heap_stats::allocations = 0;
+long long heap_stats::bytes       = 0;
+long long heap_stats::peak        = 0;
+
+template <typename T>
+struct bench_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        typedef bench_allocator<U> other;};
+
+    bench_allocator ()
+        {}
+
+    template <typename U>
+    bench_allocator (const bench_allocator<U>&)
+        {}
+
+    T* allocate (std::size_t n) {
+        ++heap_stats::allocations;
+        heap_stats::bytes += n * sizeof(T);
+        heap_stats::peak = std::max(heap_stats::peak, heap_stats::bytes);
+        return std::allocator<T>::allocate(n);}
+
+    void deallocate (T* p, std::size_t n) {
+        heap_stats::bytes -= n * sizeof(T);
+        std::allocator<T>::deallocate(p, n);}};
+
+/**
+ * a 64 byte element, for the cost of moving something bigger than a word
+ */
+struct big {
+    double d[8];
+
+    big (double x = 0) {
+        std::fill(d, d + 8, x);}
+
+    operator double () const {
+        return d[0];}};
+
+// containers that have push_front and pop_front
+template <typename C>
+struct has_front : std::true_type {};
+
+template <typename T, typename A>
+struct has_front< std::vector<T, A> > : std::false_type {};
+
+const int OPS_N = 100000;
+
+/**
+ * @param name the benchmark name
+ * @param n the number of operations f performs
+ * @param f the operation, run three times on fresh state made by setup, the fastest counts
+ * report ns/op, allocations/op and the peak bytes above what setup left
+ */
+template <typename S, typename F>
+void measure (const std::string& name, int n, S setup, F f) {
+    long long best = -1;
+    long long allocations = 0;
+    long long peak = 0;
+    for (int r = 0; r != 3; ++r) {
+        typename S::result_type c = setup();
+        const long long base = heap_stats::bytes;
+        heap_stats::reset();
+        const long long t = now_ns();
+        f(c);
+        const long long d = now_ns() - t;
+        if (best < 0 || d < best)
+            best = d;
+        allocations = heap_stats::allocations;
+        peak = heap_stats::peak - base;}
+    report((name + ".ns_per_op").c_str(), double(best) / n, "ns");
+    report((name + ".allocs_per_op").c_str(), double(allocations) / n, "allocs");
+    report((name + ".peak_bytes").c_str(), double(peak), "bytes");}
+
+template <typename C>
+struct make {
+    typedef C result_type;
+
+    int _n;
+
+    explicit make (int n) :
+            _n(n) {}
+
+    C operator () () const {
+        C c;
+        for (int i = 0; i != _n; ++i)
+            c.push_back(typename C::value_type(i));
+        return c;}};
+
+volatile double sink;
+
+/**
+ * the operations every container supports
+ */
+template <typename C>
+void ops_common (const std::string& p) {
+    typedef typename C::value_type value_type;
+    const int n = OPS_N;
+
+    measure(p + ".push_back", n, make<C>(0), [n] (C& c) {
+        for (int i = 0; i != n; ++i)
+            c.push_back(value_type(i));});
+
+    measure(p + ".pop_back", n, make<C>(n), [n] (C& c) {
+        for (int i = 0; i != n; ++i)
+            c.pop_back();});
+
+    std::vector<int> idx(n);
+    std::mt19937 g(1);
+    std::uniform_int_distribution<int> u(0, n - 1);
+    for (int& i : idx)
+        i = u(g);
+    measure(p + ".random_access", n, make<C>(n), [&idx] (C& c) {
+        double x = 0;
+        for (int i : idx)
+            x += c[i];
+        sink = x;});
+
+    measure(p + ".iterate", n, make<C>(n), [] (C& c) {
+        double x = 0;
+        for (typename C::const_iterator b = c.begin(), e = c.end(); b != e; ++b)
+            x += *b;
+        sink = x;});
+
+    const int m = 2000;
+    measure(p + ".insert_middle", m, make<C>(m), [m] (C& c) {
+        for (int i = 0; i != m; ++i)
+            c.insert(c.begin() + c.size() / 2, value_type(i));});
+
+    measure(p + ".erase_middle", m, make<C>(2 * m), [m] (C& c) {
+        for (int i = 0; i != m; ++i)
+            c.erase(c.begin() + c.size() / 2);});
+
+    measure(p + ".copy", n, make<C>(n), [] (C& c) {
+        C x(c);
+        sink = x.back();});
+
+    measure(p + ".assign", n, make<C>(n), [] (C& c) {
+        C x;
+        x.push_back(value_type(1));
+        x = c;
+        sink = x.back();});}
+
+template <typename C>
+void ops_front (const std::string&, std::false_type) {}
+
+/**
+ * the operations at the front, and a queue that stays at 1000 elements
+ */
+template <typename C>
+void ops_front (const std::string& p, std::true_type) {
+    typedef typename C::value_type value_type;
+    const int n = OPS_N;
+
+    measure(p + ".push_front", n, make<C>(0), [n] (C& c) {
+        for (int i = 0; i != n; ++i)
+            c.push_front(value_type(i));});
+
+    measure(p + ".pop_front", n, make<C>(n), [n] (C& c) {
+        for (int i = 0; i != n; ++i)
+            c.pop_front();});
+
+    measure(p + ".queue", 10 * n, make<C>(1000), [n] (C& c) {
+        for (int i = 0; i != 10 * n; ++i) {
+            c.push_back(value_type(i));
+            c.pop_front();}});}
+
+template <typename C>
+void ops (const char* container, const char* type) {
+    const std::string p = std::string("ops.") + container + "." + type;
+    ops_common<C>(p);
+    ops_front<C>(p, has_front<C>());}
+
+template <typename T>
+void ops_type (const char* type) {
+    ops< std::deque<T, bench_allocator<T> > >("std_deque", type);
+    ops< std::vector<T, bench_allocator<T> > >("std_vector", type);
+    ops< my_deque<T, bench_allocator<T> > >("my_deque", type);}
+
+void bench_ops () {
+    ops_type<int>("int");
+    ops_type<double>("double");
+    ops_type<big>("big");}
+
+// ----------
+// spsc queue
+// ----------
+
+/**
+ * the mutex wrapped my_deque the spsc benchmarks compare against
+ */
+template <typename T>
+class locked_queue {
+    private:
+        std::mutex  _m;
+        my_deque<T> _d;
+
+    public:
+        bool try_push (const T& v) {
+            std::lock_guard<std::mutex> g(_m);
+            _d.push_back(v);
+            return true;}
+
+        bool try_pop (T& v) {
+            std::lock_guard<std::mutex> g(_m);
+            if (_d.empty())
+                return false;
+            v = _d.front();
+            _d.pop_front();
+            return true;}};
+
+const int SPSC_N = 2000000;
+
+/**
+ * one producer pushes SPSC_N ints, one consumer pops them
+ * return elapsed ns
+ */
+template <typename Q>
+long long spsc_throughput (Q& q) {
+    const long long t = now_ns();
+    std::thread p([&q] () {
+        for (int i = 0; i < SPSC_N; ++i)
+            while (!q.try_push(i))
+                std::this_thread::yield();});
+    int v;
+    for (int i = 0; i < SPSC_N; ++i)
+        while (!q.try_pop(v))
+            std::this_thread::yield();
+    p.join();
+    return now_ns() - t;}
+
+/**
+ * as spsc_throughput but pushing and popping 64 at a time
+ */
+long long spsc_batch_throughput (my_spsc_queue<int>& q) {
+    const long long t = now_ns();
+    std::thread p([&q] () {
+        int a[64];
+        for (int i = 0; i < SPSC_N;) {
+            const int k = std::min(64, SPSC_N - i);
+            for (int j = 0; j != k; ++j)
+                a[j] = i + j;
+            for (int j = 0; j != k;) {
+                const int m = q.try_push_n(a + j, k - j);
+                if (!m)
+                    std::this_thread::yield();
+                j += m;}
+            i += k;}});
+    int b[64];
+    for (int i = 0; i < SPSC_N;) {
+        const int m = q.try_pop_n(b, 64);
+        if (!m)
+            std::this_thread::yield();
+        i += m;}
+    p.join();
+    return now_ns() - t;}
+
+/**
+ * the producer pushes timestamps, the consumer records how long each one waited
+ */
+template <typename Q>
+std::vector<long long> spsc_latency (Q& q) {
+    const int n = 200000;
+    std::vector<long long> r;
+    r.reserve(n);
+    std::thread p([&q] () {
+        for (int i = 0; i < n; ++i)
+            while (!q.try_push(now_ns()))
+                std::this_thread::yield();});
+    long long v;
+    for (int i = 0; i < n; ++i) {
+        while (!q.try_pop(v))
+            std::this_thread::yield();
+        r.push_back(now_ns() - v);}
+    p.join();
+    return r;}
+
+void bench_spsc () {
+    {
+    my_spsc_queue<int> q(4096);
+    report("spsc.lock_free.throughput", SPSC_N / (spsc_throughput(q) / 1e3), "Mops/s");
+    }
+    {
+    my_spsc_queue<int> q(4096);
+    report("spsc.lock_free_batch.throughput", SPSC_N / (spsc_batch_throughput(q) / 1e3), "Mops/s");
+    }
+    {
+    locked_queue<int> q;
+    report("spsc.mutex_my_deque.throughput", SPSC_N / (spsc_throughput(q) / 1e3), "Mops/s");
+    }
+    {
+    my_spsc_queue<long long> q(4096);
+    std::vector<long long> r = spsc_latency(q);
+    report_latency("spsc.lock_free.latency", r);
+    }
+    {
+    locked_queue<long long> q;
+    std::vector<long long> r = spsc_latency(q);
+    report_latency("spsc.mutex_my_deque.latency", r);
+    }}
+
+// --------------
+// work stealing
+// --------------
+
+/**
+ * fork join fibonacci, every call above the cutoff forks its left half
+ */
+long ws_fib (my_ws_pool& p, int n) {
+    if (n < 16) {
+        long a = 0, b = 1;
+        for (int i = 0; i < n; ++i) {
+            const long c = a + b;
+            a = b;
+            b = c;}
+        volatile long spin = 0;
+        for (int i = 0; i < 30000; ++i)
+            spin = spin + i;
+        return a;}
+    long x = 0;
+    my_ws_pool::group g;
+    p.submit(g, [&p, &x, n] () {x = ws_fib(p, n - 1);});
+    const long y = ws_fib(p, n - 2);
+    p.wait(g);
+    return x + y;}
+
+/**
+ * time the same fork join tree on pools of 1, 2, 4, ... workers up to the hardware threads
+ */
+void bench_ws () {
+    const unsigned n = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> ws;
+    for (unsigned w = 1; w < n; w *= 2)
+        ws.push_back(w);
+    ws.push_back(n);
+    double base = 0;
+    for (unsigned w : ws) {
+        my_ws_pool p(w);
+        const long long t = now_ns();
+        ws_fib(p, 30);
+        const double ms = (now_ns() - t) / 1e6;
+        if (w == 1)
+            base = ms;
+        char s[64];
+        std::snprintf(s, sizeof(s), "ws.fib30.workers_%u.time", w);
+        report(s, ms, "ms");
+        std::snprintf(s, sizeof(s), "ws.fib30.workers_%u.speedup", w);
+        report(s, base / ms, "x");}}
+
+// --------
+// parallel
+// --------
+
+/**
+ * reduce, count_if and sort over 4M elements, serial std algorithms first, then pools of 1, 2, 4, ... workers
+ */
+void bench_parallel () {
+    const int n = 1 << 22;
+    my_deque<double> x;
+    std::mt19937 g(1);
+    std::uniform_real_distribution<double> u(0, 1);
+    for (int i = 0; i != n; ++i)
+        x.push_back(u(g));
+    long long t = now_ns();
+    sink = std::accumulate(x.begin(), x.end(), 0.0);
+    report("parallel.reduce.serial.time", (now_ns() - t) / 1e6, "ms");
+    my_deque<double> y(x);
+    t = now_ns();
+    std::sort(y.begin(), y.end());
+    report("parallel.sort.serial.time", (now_ns() - t) / 1e6, "ms");
+
+    const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> ws;
+    for (unsigned w = 1; w < hw; w *= 2)
+        ws.push_back(w);
+    ws.push_back(hw);
+    char s[64];
+    for (unsigned w : ws) {
+        my_ws_pool p(w);
+        t = now_ns();
+        sink = parallel_reduce(p, x);
+        std::snprintf(s, sizeof(s), "parallel.reduce.workers_%u.time", w);
+        report(s, (now_ns() - t) / 1e6, "ms");
+        t = now_ns();
+        sink = parallel_count_if(p, x, [] (double v) {return v < 0.5;});
+        std::snprintf(s, sizeof(s), "parallel.count_if.workers_%u.time", w);
+        report(s, (now_ns() - t) / 1e6, "ms");
+        y = x;
+        t = now_ns();
+        parallel_sort(p, y);
+        std::snprintf(s, sizeof(s), "parallel.sort.workers_%u.time", w);
+        report(s, (now_ns() - t) / 1e6, "ms");}}
+
+// ----
+// simd
+// ----
+
+const int SIMD_N = 1 << 20;
+
+/**
+ * @param f the work, run five times
+ * return the fastest run in ns per element of SIMD_N
+ */
+template <typename F>
+double per_element (F f) {
+    long long best = -1;
+    for (int r = 0; r != 5; ++r) {
+        const long long t = now_ns();
+        f();
+        const long long d = now_ns() - t;
+        if (best < 0 || d < best)
+            best = d;}
+    return double(best) / SIMD_N;}
+
+/**
+ * the std algorithms over std::deque and my_deque, then the deque_kernels at every level the CPU has
+ */
+template <typename T>
+void simd_type (const char* type) {
+    std::deque<T> a;
+    my_deque<T>   x;
+    my_deque<T>   y;
+    for (int i = 0; i != SIMD_N; ++i) {
+        a.push_back(T(i % 1000));
+        x.push_back(T(i % 1000));
+        y.push_back(T(1));}
+    const T missing = T(-1);
+    char s[128];
+    const auto name = [&s, type] (const char* op, const char* how) {
+        std::snprintf(s, sizeof(s), "simd.%s.%s.%s", type, op, how);
+        return s;};
+
+    report(name("sum", "std_deque_accumulate"), per_element([&] () {sink = std::accumulate(a.begin(), a.end(), T());}), "ns");
+    report(name("sum", "my_deque_accumulate"), per_element([&] () {sink = std::accumulate(x.begin(), x.end(), T());}), "ns");
+    report(name("min", "std_deque_min_element"), per_element([&] () {sink = *std::min_element(a.begin(), a.end());}), "ns");
+    report(name("count", "std_deque_count"), per_element([&] () {sink = std::count(a.begin(), a.end(), T(7));}), "ns");
+    report(name("find", "std_deque_find"), per_element([&] () {sink = std::find(a.begin(), a.end(), missing) - a.begin();}), "ns");
+    report(name("axpy", "my_deque_loop"), per_element([&] () {
+        for (std::size_t i = 0; i != x.size(); ++i)
+            y[i] = T(2) * x[i] + y[i];}), "ns");
+
+    const deque_simd::level top = deque_simd::detect();
+    for (int k = deque_simd::scalar; k <= top; ++k) {
+        const deque_simd::level l = deque_simd::set_level(deque_simd::level(k));
+        report(name("sum", deque_simd::name(l)), per_element([&] () {sink = deque_sum(x);}), "ns");
+        report(name("min", deque_simd::name(l)), per_element([&] () {sink = deque_min(x);}), "ns");
+        report(name("count", deque_simd::name(l)), per_element([&] () {sink = deque_count(x, T(7));}), "ns");
+        report(name("find", deque_simd::name(l)), per_element([&] () {sink = deque_find(x, missing) - x.begin();}), "ns");
+        report(name("axpy", deque_simd::name(l)), per_element([&] () {deque_axpy(T(2), x, y);}), "ns");}
+    deque_simd::set_level(top);}
+
+void bench_simd () {
+    simd_type<int>("int");
+    simd_type<double>("double");}
+
+// ------
+// window
+// ------
+
+/**
+ * min, max and sum over a window of the last W samples, per sample pushed:
+ * recomputed from a std::deque of the window, sliding_window pushed one sample or a batch at a time,
+ * and two_stack_window for the sum
+ */
+void bench_window () {
+    const int n = 1 << 20;
+    std::vector<double> v(n);
+    std::vector<long long> ts(n);
+    std::mt19937 g(1);
+    std::uniform_real_distribution<double> u(0, 1);
+    for (int i = 0; i != n; ++i) {
+        v[i] = u(g);
+        ts[i] = i;}
+    char s[64];
+    for (int w : {16, 256, 4096}) {
+        const int m = (w < 4096) ? n : n / 16;
+        long long t = now_ns();
+        std::deque<double> q;
+        double x = 0;
+        for (int i = 0; i != m; ++i) {
+            q.push_back(v[i]);
+            if (int(q.size()) > w)
+                q.pop_front();
+            x += *std::min_element(q.begin(), q.end()) + *std::max_element(q.begin(), q.end());}
+        sink = x;
+        std::snprintf(s, sizeof(s), "window.w_%d.naive_minmax", w);
+        report(s, double(now_ns() - t) / m, "ns");
+
+        t = now_ns();
+        sliding_window<double> a;
+        x = 0;
+        for (int i = 0; i != n; ++i) {
+            a.push(v[i], ts[i]);
+            a.evict_older_than(ts[i] - w + 1);
+            x += a.min() + a.max();}
+        sink = x;
+        std::snprintf(s, sizeof(s), "window.w_%d.sliding_minmax", w);
+        report(s, double(now_ns() - t) / n, "ns");
+
+        t = now_ns();
+        sliding_window<double> b;
+        x = 0;
+        for (int i = 0; i != n; i += 64) {
+            b.push_n(&v[i], &ts[i], 64);
+            b.evict_older_than(ts[i + 63] - w + 1);
+            x += b.min() + b.max();}
+        sink = x;
+        std::snprintf(s, sizeof(s), "window.w_%d.sliding_minmax_batch64", w);
+        report(s, double(now_ns() - t) / n, "ns");
+
+        t = now_ns();
+        q.clear();
+        x = 0;
+        for (int i = 0; i != m; ++i) {
+            q.push_back(v[i]);
+            if (int(q.size()) > w)
+                q.pop_front();
+            x += std::accumulate(q.begin(), q.end(), 0.0);}
+        sink = x;
+        std::snprintf(s, sizeof(s), "window.w_%d.naive_sum", w);
+        report(s, double(now_ns() - t) / m, "ns");
+
+        t = now_ns();
+        two_stack_window<double> c;
+        x = 0;
+        for (int i = 0; i != n; ++i) {
+            c.push(v[i], ts[i]);
+            c.evict_older_than(ts[i] - w + 1);
+            x += c.aggregate();}
+        sink = x;
+        std::snprintf(s, sizeof(s), "window.w_%d.two_stack_sum", w);
+        report(s, double(now_ns() - t) / n, "ns");}}
+
+// ------
+// mapped
+// ------
+
+/**
+ * sustained throughput of a my_mapped_deque of 64 byte records:
+ * fill a backlog of BENCH_MAPPED_MB megabytes (default 1024) under BENCH_MAPPED_DIR (default /tmp),
+ * checkpoint it, then drain it while pushing one record for every two popped
+ * set BENCH_MAPPED_MB to ten times the machine's memory for the outage case
+ */
+void bench_mapped () {
+    struct record {
+        long long ts;
+        char      payload[56];};
+    const char* m = std::getenv("BENCH_MAPPED_MB");
+    const char* d = std::getenv("BENCH_MAPPED_DIR");
+    const long long mb = m ? std::atoll(m) : 1024;
+    const std::string dir = std::string(d ? d : "/tmp") + "/BenchDeque.mapped";
+    const long long n = mb * (1 << 20) / sizeof(record);
+    std::system(("rm -rf " + dir).c_str());
+    {
+    my_mapped_deque<record> q(dir);
+    record r;
+    std::memset(&r, 0, sizeof(r));
+    long long t = now_ns();
+    for (long long i = 0; i != n; ++i) {
+        r.ts = i;
+        q.push_back(r);}
+    double s = (now_ns() - t) / 1e9;
+    report("mapped.fill.MB_per_s", mb / s, "MB/s");
+    t = now_ns();
+    q.checkpoint();
+    report("mapped.checkpoint.time", (now_ns() - t) / 1e6, "ms");
+    t = now_ns();
+    long long popped = 0;
+    long long x = 0;
+    while (!q.empty()) {
+        x += q.front().ts;
+        q.pop_front();
+        if (++popped % 2 == 0) {
+            r.ts = popped;
+            q.push_back(r);}}
+    sink = double(x);
+    s = (now_ns() - t) / 1e9;
+    report("mapped.drain.MB_per_s", popped * sizeof(record) / double(1 << 20) / s, "MB/s");
+    }
+    std::system(("rm -rf " + dir).c_str());}
+
+// ------
+// blocks
+// ------
+
+/**
+ * a B byte element whose my_deque blocks spend Budget bytes, by deque_block_size's rule,
+ * or hold 50 elements, the width my_deque had before deque_block_size, when Budget is 0
+ */
+template <std::size_t B, std::size_t Budget>
+struct payload {
+    char c[B];
+
+    payload (int i = 0) {
+        c[0] = char(i);}
+
+    operator double () const {
+        return c[0];}};
+
+template <std::size_t B, std::size_t Budget>
+struct deque_block_size< payload<B, Budget> > :
+        std::integral_constant<std::size_t, Budget ? deque_block_size<char[B], Budget>::value : 50>
+    {};
+
+/**
+ * @param f the work, run three times
+ * return the fastest run in ns per n operations
+ */
+template <typename F>
+double per_op (int n, F f) {
+    long long best = -1;
+    for (int r = 0; r != 3; ++r) {
+        const long long t = now_ns();
+        f();
+        const long long d = now_ns() - t;
+        if (best < 0 || d < best)
+            best = d;}
+    return double(best) / n;}
+
+/**
+ * push_back, random access, iteration and a push_back/pop_front queue over 16 MB of B byte elements
+ */
+template <std::size_t B, std::size_t Budget>
+void blocks_type () {
+    typedef payload<B, Budget> T;
+    typedef my_deque<T>        D;
+    const int n = (16 << 20) / B;
+    char p[128];
+    if (Budget)
+        std::snprintf(p, sizeof(p), "blocks.%uB.budget_%u.width_%u", unsigned(B), unsigned(Budget), unsigned(D::block_width()));
+    else
+        std::snprintf(p, sizeof(p), "blocks.%uB.width_50", unsigned(B));
+    char s[160];
+    const auto name = [&s, &p] (const char* op) {
+        std::snprintf(s, sizeof(s), "%s.%s", p, op);
+        return s;};
+
+    report(name("push_back"), per_op(n, [n] () {
+        D x;
+        for (int i = 0; i != n; ++i)
+            x.push_back(T(i));
+        sink = x.back();}), "ns");
+
+    D x;
+    for (int i = 0; i != n; ++i)
+        x.push_back(T(i));
+    std::vector<int> idx(n);
+    std::mt19937 g(1);
+    std::uniform_int_distribution<int> u(0, n - 1);
+    for (int& i : idx)
+        i = u(g);
+    report(name("random_access"), per_op(n, [&] () {
+        double v = 0;
+        for (int i : idx)
+            v += x[i];
+        sink = v;}), "ns");
+
+    report(name("iterate"), per_op(n, [&x] () {
+        double v = 0;
+        for (typename D::const_iterator b = x.begin(), e = x.end(); b != e; ++b)
+            v += *b;
+        sink = v;}), "ns");
+
+    report(name("queue"), per_op(n, [&x, n] () {
+        for (int i = 0; i != n; ++i) {
+            x.push_back(T(i));
+            x.pop_front();}}), "ns");}
+
+template <std::size_t B>
+void blocks_size () {
+    blocks_type<B, 0>();
+    blocks_type<B, 512>();
+    blocks_type<B, 1024>();
+    blocks_type<B, 4096>();
+    blocks_type<B, 16384>();}
+
+void bench_blocks () {
+    blocks_size<4>();
+    blocks_size<16>();
+    blocks_size<64>();
+    blocks_size<256>();
+    blocks_size<1024>();}
+
+// ------
+// tiered
+// ------
+
+/**
+ * @param n the number of elements
+ * insert then erase n / 10 elements at random positions of a container of n, then random access over it
+ */
+template <typename C>
+void tiered_type (const char* container, int n) {
+    std::vector<int> idx(n / 10);
+    std::mt19937 g(1);
+    for (std::size_t i = 0; i != idx.size(); ++i)
+        idx[i] = std::uniform_int_distribution<int>(0, n + int(i))(g);
+    char s[128];
+    C c;
+    for (int i = 0; i != n; ++i)
+        c.push_back(i);
+    long long t = now_ns();
+    for (std::size_t i = 0; i != idx.size(); ++i)
+        c.insert(c.begin() + idx[i], int(i));
+    std::snprintf(s, sizeof(s), "tiered.%s.n_%d.insert_random", container, n);
+    report(s, double(now_ns() - t) / idx.size(), "ns");
+    t = now_ns();
+    for (std::size_t i = idx.size(); i-- != 0;)
+        c.erase(c.begin() + idx[i]);
+    std::snprintf(s, sizeof(s), "tiered.%s.n_%d.erase_random", container, n);
+    report(s, double(now_ns() - t) / idx.size(), "ns");
+    std::uniform_int_distribution<int> u(0, n - 1);
+    for (std::size_t i = 0; i != idx.size(); ++i)
+        idx[i] = u(g);
+    t = now_ns();
+    long long x = 0;
+    for (int r = 0; r != 10; ++r)
+        for (std::size_t i = 0; i != idx.size(); ++i)
+            x += c[idx[i]];
+    sink = double(x);
+    std::snprintf(s, sizeof(s), "tiered.%s.n_%d.random_access", container, n);
+    report(s, double(now_ns() - t) / (10 * idx.size()), "ns");}
+
+/**
+ * my_tiered_deque against std::deque and my_deque as an ordered work list
+ */
+void bench_tiered () {
+    for (int n = 10000; n <= 1000000; n *= 10) {
+        tiered_type< std::deque<int> >("std_deque", n);
+        tiered_type< my_deque<int> >("my_deque", n);
+        tiered_type< my_tiered_deque<int> >("my_tiered_deque", n);}}
+
+// ----
+// huge
+// ----
+
+/**
+ * return the system's AnonHugePages in MB, or -1 where there is no /proc/meminfo
+ */
+double anon_huge_mb () {
+    std::FILE* f = std::fopen("/proc/meminfo", "r");
+    if (!f)
+        return -1;
+    char line[256];
+    double kb = -1;
+    while (std::fgets(line, sizeof(line), f))
+        if (std::sscanf(line, "AnonHugePages: %lf kB", &kb) == 1)
+            break;
+    std::fclose(f);
+    return kb / 1024;}
+
+/**
+ * @param container the name to report under
+ * @param a the allocator of the my_deque
+ * @param n the number of elements
+ * fill a my_deque<long> of n, then read it at random positions, xorshift generated so no index array competes for the TLB
+ */
+template <typename A>
+void huge_type (const char* container, const A& a, long long n) {
+    char s[128];
+    long long t = now_ns();
+    my_deque<long, A> c(a);
+    for (long long i = 0; i != n; ++i)
+        c.push_back(long(i));
+    std::snprintf(s, sizeof(s), "huge.%s.fill", container);
+    report(s, double(now_ns() - t) / n, "ns");
+    std::snprintf(s, sizeof(s), "huge.%s.anon_huge_pages", container);
+    report(s, anon_huge_mb(), "MB");
+    const long long k = 1 << 24;
+    unsigned long long r = 88172645463325252ull;
+    long x = 0;
+    t = now_ns();
+    for (long long i = 0; i != k; ++i) {
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        x += c[std::size_t(r % std::size_t(n))];}
+    sink = double(x);
+    std::snprintf(s, sizeof(s), "huge.%s.random_access", container);
+    report(s, double(now_ns() - t) / k, "ns");}
+
+/**
+ * random operator[] over a my_deque<long> of BENCH_HUGE_MB megabytes (default 1024),
+ * its blocks from std::allocator and then from a huge_page_arena, the only difference being the page size
+ * huge.thp is 1 when the arena's chunks were given MADV_HUGEPAGE, see /sys/kernel/mm/transparent_hugepage
+ */
+void bench_huge () {
+    const char* m = std::getenv("BENCH_HUGE_MB");
+    const long long mb = m ? std::atoll(m) : 1024;
+    const long long n = mb * (1 << 20) / static_cast<long long>(sizeof(long));
+    huge_type("std_allocator", std::allocator<long>(), n);
+    {
+    huge_page_arena h;
+    huge_type("huge_page_allocator", huge_page_allocator<long>(h), n);
+    report("huge.thp", h.huge(), "bool");
+    }
+    {
+    huge_page_arena h(std::size_t(64) << 20, true);
+    h.reserve(std::size_t(mb) << 20);
+    huge_type("huge_page_allocator_prefault", huge_page_allocator<long>(h), n);
+    }}
+
+// ----
+// main
+// ----
+
+struct benchmark {
+    const char* name;
+    void (*run) ();};
+
+const benchmark benchmarks[] = {
+    {"blocks", bench_blocks},
+    {"huge", bench_huge},
+    {"mapped", bench_mapped},
+    {"ops",  bench_ops},
+    {"parallel", bench_parallel},
+    {"simd", bench_simd},
+    {"spsc", bench_spsc},
+    {"tiered", bench_tiered},
+    {"window", bench_window},
+    {"ws",   bench_ws}};
+
+int main (int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--csv") == 0) {
+        csv = true;
+        --argc;
+        ++argv;}
+    for (const benchmark& b : benchmarks)
+        if (argc < 2 || std::strncmp(argv[1], b.name, std::strlen(argv[1])) == 0)
+            b.run();
+    return 0;}
@@ -10,14 +10,32 @@
 // includes
 // --------
 
-#include <algorithm> // copy, equal, lexicographical_compare, max, swap
+#include <algorithm> // copy, equal, fill, find_if, lexicographical_compare, max, move, move_backward, reverse, rotate, swap
+#include <atomic>    // atomic, memory_order
 #include <cassert>   // assert
-#include <iterator>  // iterator, bidirectional_iterator_tag
+#include <chrono>    // duration, milliseconds, steady_clock
+#include <condition_variable> // condition_variable
+#include <cstddef>   // ptrdiff_t
+#include <cstdint>   // uint32_t, uint64_t
+#include <cstring>   // memcpy, memmove
+#include <exception> // current_exception, exception_ptr, rethrow_exception
+#include <functional> // function
+#include <iterator>  // advance, begin, distance, end, iterator_traits, make_move_iterator, random_access_iterator_tag
 #include <memory>    // allocator
+#include <mutex>     // lock_guard, mutex, unique_lock
+#include <numeric>   // accumulate
 #include <stdexcept> // out_of_range
-#include <utility>   // !=, <=, >, >=
+#include <thread>    // thread, yield
+#include <type_traits> // enable_if, integral_constant, is_integral, is_trivially_copyable, is_trivially_destructible
+#include <utility>   // !=, <=, >, >=, forward, move, pair
+#include <vector>    // vector
 #include <iostream> 
 
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__) && !defined(DEQUE_NO_SIMD)
+#define DEQUE_SIMD_X86
+#include <immintrin.h> // SSE2 and AVX2 intrinsics for deque_kernels
+#endif
+
 using namespace std;
 // -----
 // using
@@ -28,23 +46,75 @@ using std::rel_ops::operator<=;
 using std::rel_ops::operator>;
 using std::rel_ops::operator>=;
 
+// ------------------------
+// is_trivially_relocatable
+// ------------------------
+
+/**
+ * true when a T can be moved to new storage with memmove and its old storage simply forgotten
+ * defaults to std::is_trivially_copyable, specialize it to opt a user type in
+ */
+template <typename T>
+struct is_trivially_relocatable :
+        std::integral_constant<bool, std::is_trivially_copyable<T>::value>
+    {};
+
+// ----------------------
+// uses_default_construct
+// ----------------------
+
+/**
+ * true when A's construct() and destroy() are plain placement new and destructor calls
+ * so they may be skipped in favor of memcpy/memmove, specialize it for allocators that only customize allocation
+ */
+template <typename A>
+struct uses_default_construct :
+        std::false_type
+    {};
+
+template <typename T>
+struct uses_default_construct< std::allocator<T> > :
+        std::true_type
+    {};
+
 // -------
 // destroy
 // -------
 
 template <typename A, typename BI>
-BI destroy (A& a, BI b, BI e) {
+BI destroy (A&, BI b, BI, std::true_type) {
+    return b;}
+
+template <typename A, typename BI>
+BI destroy (A& a, BI b, BI e, std::false_type) {
     while (b != e) {
         --e;
         a.destroy(&*e);}
     return b;}
 
+/**
+ * destroys [b, e) back to front
+ * nothing to do when the value type is trivially destructible
+ */
+template <typename A, typename BI>
+BI destroy (A& a, BI b, BI e) {
+    typedef typename std::iterator_traits<BI>::value_type value_type;
+    return destroy(a, b, e, std::integral_constant<bool,
+        std::is_trivially_destructible<value_type>::value && uses_default_construct<A>::value>());}
+
 // ------------------
 // uninitialized_copy
 // ------------------
 
 template <typename A, typename II, typename BI>
-BI uninitialized_copy (A& a, II b, II e, BI x) {
+BI uninitialized_copy (A&, II b, II e, BI x, std::true_type) {
+    const std::ptrdiff_t n = e - b;
+    if (n)
+        std::memcpy(static_cast<void*>(x), static_cast<const void*>(b), n * sizeof(*x));
+    return x + n;}
+
+template <typename A, typename II, typename BI>
+BI uninitialized_copy (A& a, II b, II e, BI x, std::false_type) {
     BI p = x;
     try {
         while (b != e) {
@@ -56,12 +126,30 @@ BI uninitialized_copy (A& a, II b, II e, BI x) {
         throw;}
     return x;}
 
+/**
+ * copy constructs [b, e) into the raw storage at x
+ * a single memcpy when both are pointers to the same trivially copyable type
+ */
+template <typename A, typename II, typename BI>
+BI uninitialized_copy (A& a, II b, II e, BI x) {
+    typedef typename std::iterator_traits<II>::value_type value_type;
+    typedef typename std::iterator_traits<BI>::value_type value_type2;
+    return uninitialized_copy(a, b, e, x, std::integral_constant<bool,
+        std::is_pointer<II>::value && std::is_pointer<BI>::value &&
+        std::is_same<value_type, value_type2>::value &&
+        std::is_trivially_copyable<value_type>::value && uses_default_construct<A>::value>());}
+
 // ------------------
 // uninitialized_fill
 // ------------------
 
 template <typename A, typename BI, typename U>
-BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
+BI uninitialized_fill (A&, BI b, BI e, const U& v, std::true_type) {
+    std::fill(b, e, v);
+    return e;}
+
+template <typename A, typename BI, typename U>
+BI uninitialized_fill (A& a, BI b, BI e, const U& v, std::false_type) {
     BI p = b;
     try {
         while (b != e) {
@@ -72,19 +160,628 @@ BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
         throw;}
     return e;}
 
+/**
+ * copy constructs v into the raw storage [b, e)
+ * a plain std::fill when b is a pointer to a trivially copyable type
+ */
+template <typename A, typename BI, typename U>
+BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
+    typedef typename std::iterator_traits<BI>::value_type value_type;
+    return uninitialized_fill(a, b, e, v, std::integral_constant<bool,
+        std::is_pointer<BI>::value && std::is_same<value_type, U>::value &&
+        std::is_trivially_copyable<value_type>::value && std::is_copy_assignable<value_type>::value &&
+        uses_default_construct<A>::value>());}
+
+
+// ------------
+// deque_growth
+// ------------
+
+/**
+ * growth policy for the block map of a my_deque
+ * Factor is how many times larger the map gets when it has to be reallocated
+ * FrontPercent is the share of the free map slots left in front of the used ones,
+ * 50 suits mixed workloads, higher suits push_front heavy ones, lower push_back heavy ones
+ */
+template <std::size_t Factor = 2, std::size_t FrontPercent = 50>
+struct deque_growth {
+    static_assert(Factor >= 1, "deque_growth: Factor must be at least 1");
+    static_assert((FrontPercent > 0) && (FrontPercent < 100), "deque_growth: FrontPercent must be in (0, 100)");
+
+    /**
+     * @param s the number of slots in the block map
+     * @param n the number of slots that must be added
+     * return the number of slots in the new block map
+     */
+    static std::size_t grow (std::size_t s, std::size_t n) {
+        return std::max(s * Factor, s + n) + 2;}
+
+    /**
+     * @param n the number of free slots in the block map
+     * return how many of them to leave in front of the used ones
+     */
+    static std::size_t front_slack (std::size_t n) {
+        return n * FrontPercent / 100;}};
+
+typedef deque_growth<2, 90> front_growth;
+typedef deque_growth<2, 10> back_growth;
+
+// ----------------
+// deque_block_size
+// ----------------
+
+/**
+ * the largest power of two no greater than N, 0 for 0
+ */
+template <std::size_t N>
+struct deque_floor_pow2 :
+        std::integral_constant<std::size_t, 2 * deque_floor_pow2<N / 2>::value>
+    {};
+
+template <>
+struct deque_floor_pow2<1> :
+        std::integral_constant<std::size_t, 1>
+    {};
+
+template <>
+struct deque_floor_pow2<0> :
+        std::integral_constant<std::size_t, 0>
+    {};
+
+/**
+ * log2 of N, for N a power of two
+ */
+template <std::size_t N>
+struct deque_log2 :
+        std::integral_constant<std::size_t, 1 + deque_log2<N / 2>::value>
+    {};
+
+template <>
+struct deque_log2<1> :
+        std::integral_constant<std::size_t, 0>
+    {};
+
+/**
+ * the number of elements in a block of a my_deque<T>
+ * the default spends about Bytes per block, rounded down to a power of two elements so that
+ * finding the block and slot of an index is a shift and a mask, and never fewer than Min elements,
+ * Min itself being a power of two
+ * specialize it to give a type another width; any width of at least 1 works, a power of two is fastest
+ */
+template <typename T, std::size_t Bytes = 4096, std::size_t Min = 16>
+struct deque_block_size :
+        std::integral_constant<std::size_t,
+            (sizeof(T) * Min >= Bytes) ? Min : deque_floor_pow2<Bytes / sizeof(T)>::value>
+    {};
+
+// --------
+// deque_op
+// --------
+
+/**
+ * the operations deque_stats<true> keeps a latency histogram for
+ */
+struct deque_op {
+	enum type {push_back, push_front, pop_back, pop_front, insert, erase, count};
+
+	static const char* name (type op) {
+		static const char* const names[] = {"push_back", "push_front", "pop_back", "pop_front", "insert", "erase"};
+		return names[op];}};
+
+// --------------
+// deque_no_stats
+// --------------
+
+/**
+ * the default stats policy of my_deque, every hook is empty and my_deque inherits it as an empty base,
+ * so it costs neither space nor time
+ */
+class deque_no_stats {
+	protected:
+		void stat_allocate (std::size_t) {}
+		void stat_deallocate (std::size_t) {}
+		void stat_relocate () {}
+		void stat_move (std::size_t) {}
+		void stat_size (std::size_t, std::size_t) {}
+
+        /**
+         * times one operation, see deque_latency<true>
+         */
+		struct stat_timer {
+			stat_timer (deque_no_stats&, deque_op::type) {}};};
+
+// -------------
+// deque_latency
+// -------------
+
+/**
+ * the latency half of deque_stats, nothing unless Latency is true
+ */
+template <bool Latency>
+class deque_latency {
+	protected:
+		struct stat_timer {
+			stat_timer (deque_latency&, deque_op::type) {}};
+
+		void dump_latency (std::ostream&) const {}};
+
+template <>
+class deque_latency<true> {
+	public:
+		static const std::size_t BUCKETS = 32;
+
+	private:
+		std::size_t _h[deque_op::count][BUCKETS];	// _h[op][k] counts operations that took [2^k, 2^(k+1)) ns
+		int         _depth;							// nesting of stat_timer, only the outermost records
+
+	public:
+		deque_latency () :
+				_depth(0) {
+			reset_latency();}
+
+        /**
+         * @param op a deque_op::type
+         * return the BUCKETS counts of op, bucket k counts calls that took [2^k, 2^(k+1)) ns
+         */
+		const std::size_t* histogram (deque_op::type op) const {
+			return _h[op];}
+
+		void reset_latency () {
+			std::fill(&_h[0][0], &_h[0][0] + deque_op::count * BUCKETS, std::size_t(0));}
+
+	protected:
+        /**
+         * times one public operation, operations it calls on the same deque are not recorded again
+         */
+		class stat_timer {
+			private:
+				deque_latency&                        _l;
+				deque_op::type                        _op;
+				std::chrono::steady_clock::time_point _t;
+
+			public:
+				stat_timer (deque_latency& l, deque_op::type op) :
+						_l(l), _op(op) {
+					if (_l._depth++ == 0)
+						_t = std::chrono::steady_clock::now();}
+
+				~stat_timer () {
+					if (--_l._depth == 0) {
+						unsigned long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _t).count();
+						std::size_t k = 0;
+						while ((ns >>= 1) && (k + 1 < BUCKETS))
+							++k;
+						++_l._h[_op][k];}}};
+
+		void dump_latency (std::ostream& out) const {
+			for (int op = 0; op != deque_op::count; ++op)
+				for (std::size_t k = 0; k != BUCKETS; ++k)
+					if (_h[op][k])
+						out << "latency." << deque_op::name(deque_op::type(op)) << ".le_" << (std::size_t(2) << k) << "ns " << _h[op][k] << "\n";}};
+
+// -----------
+// deque_stats
+// -----------
+
+/**
+ * a stats policy for my_deque, e.g. my_deque<T, std::allocator<T>, deque_growth<>, deque_stats<> >
+ * counts what the deque asks of its allocator, how often its block map is relocated, how many elements
+ * it moves to make room or close gaps, and the largest size and capacity it reached
+ * with Latency true it also keeps a log2 histogram of the time each push, pop, insert and erase took
+ * read it with my_deque::stats(), the counters belong to one deque and are not synchronized
+ */
+template <bool Latency = false>
+class deque_stats : public deque_latency<Latency> {
+	private:
+		std::size_t _allocations;
+		std::size_t _deallocations;
+		std::size_t _bytes;			// allocated over the deque's life
+		std::size_t _live;			// allocated now
+		std::size_t _relocations;
+		std::size_t _moves;
+		std::size_t _max_size;
+		std::size_t _max_capacity;
+
+	public:
+		deque_stats () :
+				_live(0) {
+			reset();}
+
+        /**
+         * return the number of allocate calls
+         */
+		std::size_t allocations () const {
+			return _allocations;}
+
+        /**
+         * return the number of bytes allocated over the deque's life
+         */
+		std::size_t bytes () const {
+			return _bytes;}
+
+		std::size_t deallocations () const {
+			return _deallocations;}
+
+        /**
+         * return the number of bytes allocated now
+         */
+		std::size_t live_bytes () const {
+			return _live;}
+
+		std::size_t max_capacity () const {
+			return _max_capacity;}
+
+		std::size_t max_size () const {
+			return _max_size;}
+
+        /**
+         * return the number of elements moved or relocated to open or close a gap, or moved one by one
+         * between deques whose allocators differ
+         */
+		std::size_t moves () const {
+			return _moves;}
+
+        /**
+         * return how many times the block map was recentered or reallocated
+         */
+		std::size_t relocations () const {
+			return _relocations;}
+
+        /**
+         * @param out an ostream
+         * write one "name value" line per counter
+         */
+		void dump (std::ostream& out) const {
+			out << "allocations "   << _allocations   << "\n"
+			    << "deallocations " << _deallocations << "\n"
+			    << "bytes "         << _bytes         << "\n"
+			    << "live_bytes "    << _live          << "\n"
+			    << "relocations "   << _relocations   << "\n"
+			    << "moves "         << _moves         << "\n"
+			    << "max_size "      << _max_size      << "\n"
+			    << "max_capacity "  << _max_capacity  << "\n";
+			this->dump_latency(out);}
+
+        /**
+         * zero the counters, live_bytes excepted
+         */
+		void reset () {
+			_allocations = _deallocations = _bytes = _relocations = _moves = _max_size = _max_capacity = 0;}
+
+	protected:
+		void stat_allocate (std::size_t n) {
+			++_allocations;
+			_bytes += n;
+			_live  += n;}
+
+		void stat_deallocate (std::size_t n) {
+			++_deallocations;
+			_live -= n;}
+
+		void stat_relocate () {
+			++_relocations;}
+
+		void stat_move (std::size_t n) {
+			_moves += n;}
+
+		void stat_size (std::size_t s, std::size_t c) {
+			_max_size     = std::max(_max_size, s);
+			_max_capacity = std::max(_max_capacity, c);}};
+
+// ----------
+// deque_span
+// ----------
+
+/**
+ * n contiguous elements starting at p, like C++20's std::span<T>
+ * my_deque::segments yields one per block a range touches, deque_span<const T> for a const deque
+ */
+template <typename T>
+class deque_span {
+	public:
+		typedef T           element_type;
+		typedef T*          pointer;
+		typedef T&          reference;
+		typedef T*          iterator;
+		typedef std::size_t size_type;
+
+	private:
+		pointer   _p;
+		size_type _n;
+
+	public:
+		deque_span () :
+				_p(0), _n(0) {}
+
+		deque_span (pointer p, size_type n) :
+				_p(p), _n(n) {}
+
+        /**
+         * @param that a deque_span<U>
+         * convert a span of T into a span of const T
+         */
+		template <typename U>
+		deque_span (const deque_span<U>& that, typename std::enable_if<std::is_convertible<U*, T*>::value>::type* = 0) :
+				_p(that.data()), _n(that.size()) {}
+
+		reference operator [] (size_type i) const {
+			assert(i < _n);
+			return _p[i];}
+
+		iterator begin () const {
+			return _p;}
+
+		iterator end () const {
+			return _p + _n;}
+
+		pointer data () const {
+			return _p;}
+
+		bool empty () const {
+			return !_n;}
+
+		size_type size () const {
+			return _n;}
+
+        /**
+         * return the size of the span in bytes, what memcpy or an iovec wants
+         */
+		size_type size_bytes () const {
+			return _n * sizeof(T);}};
+
+// ---------------------
+// deque_snapshot_header
+// ---------------------
+
+/**
+ * the first 64 bytes of a snapshot written by my_deque::save, followed by the elements, front first, as raw bytes
+ * 64 bytes so the elements of a mapped snapshot are aligned for any T
+ */
+struct deque_snapshot_header {
+	static const std::uint32_t VERSION = 1;
+
+	char          _magic[8];	// "MDQSNAP" and a 0
+	std::uint32_t _version;
+	std::uint32_t _size_of;		// sizeof(T)
+	std::uint64_t _n;			// number of elements
+	char          _reserved[40];
+
+        /**
+         * @param size_of the size of an element
+         * @param n the number of elements
+         * return the header of a snapshot of n elements
+         */
+	static deque_snapshot_header make (std::size_t size_of, std::size_t n) {
+		deque_snapshot_header h;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h._magic, "MDQSNAP", 8);
+		h._version = VERSION;
+		h._size_of = std::uint32_t(size_of);
+		h._n       = n;
+		return h;}
+
+        /**
+         * @param size_of the size of an element
+         * throw runtime_error unless this is a snapshot, of this version, of elements of that size
+         * return the number of elements
+         */
+	std::size_t check (std::size_t size_of) const {
+		if (std::memcmp(_magic, "MDQSNAP", 8) != 0)
+			throw std::runtime_error("deque snapshot: bad magic");
+		if (_version != VERSION)
+			throw std::runtime_error("deque snapshot: unknown version");
+		if (_size_of != size_of)
+			throw std::runtime_error("deque snapshot: elements of another size");
+		return std::size_t(_n);}};
+
+// -------------
+// my_block_pool
+// -------------
+
+/**
+ * free deque blocks of width elements of T, kept for reuse by any number of my_deque
+ * a free block holds the next one in its first bytes, so the pool itself allocates nothing
+ * at most limit() blocks are kept, the rest go back to the allocator
+ * a shared pool locks a mutex, an unshared one must only be used from one thread
+ */
+template < typename T, typename A = std::allocator<T> >
+class my_block_pool {
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef A										 allocator_type;
+		typedef typename allocator_type::size_type		 size_type;
+		typedef typename allocator_type::pointer		 pointer;
+
+	private:
+		// ----
+        // data
+        // ----
+
+		allocator_type _a;
+		std::mutex     _m;
+		pointer        _free;
+		size_type      _n;
+		size_type      _width;
+		size_type      _limit;
+		size_type      _hits;
+		size_type      _misses;
+		const bool     _shared;
+
+	public:
+		// ---------
+        // free list
+        // ---------
+
+        /**
+         * @param h the head of a free list
+         * @param p a free block, becomes the new head
+         */
+		static void link (pointer& h, pointer p) {
+			std::memcpy(static_cast<void*>(&*p), &h, sizeof(pointer));
+			h = p;}
+
+        /**
+         * @param h the head of a non empty free list
+         * return the head, which is unlinked
+         */
+		static pointer unlink (pointer& h) {
+			pointer p = h;
+			std::memcpy(&h, static_cast<const void*>(&*p), sizeof(pointer));
+			return p;}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param width a size_type, the number of elements in a block, my_deque<T, A>::block_width()
+         * @param limit a size_type, the most free blocks kept
+         * @param shared a bool, false when only one thread uses the pool
+         * @param a an allocator_type reference
+         */
+		my_block_pool (size_type width, size_type limit, bool shared = true, const allocator_type& a = allocator_type()) :
+				_a(a), _free(0), _n(0), _width(width), _limit(limit), _hits(0), _misses(0), _shared(shared) {
+			assert(width * sizeof(T) >= sizeof(pointer));}
+
+		my_block_pool (const my_block_pool&) = delete;
+
+		my_block_pool& operator = (const my_block_pool&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * every my_deque using the pool must be gone or detached
+         */
+		~my_block_pool () {
+			set_limit(0);}
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * return a free block, or 0 if there is none
+         */
+		pointer allocate () {
+			std::unique_lock<std::mutex> g(_m, std::defer_lock);
+			if (_shared)
+				g.lock();
+			if (!_n) {
+				++_misses;
+				return 0;}
+			++_hits;
+			--_n;
+			return unlink(_free);}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * @param p a block of width() elements from an allocator equal to get_allocator()
+         * return false if the pool is at its limit and did not take p
+         */
+		bool deallocate (pointer p) {
+			std::unique_lock<std::mutex> g(_m, std::defer_lock);
+			if (_shared)
+				g.lock();
+			if (_n == _limit)
+				return false;
+			link(_free, p);
+			++_n;
+			return true;}
+
+        // -------------
+        // get_allocator
+        // -------------
+
+		allocator_type get_allocator () const {
+			return _a;}
+
+        // ----
+        // hits
+        // ----
+
+        /**
+         * return how many allocate calls found a free block
+         */
+		size_type hits () const {
+			return _hits;}
+
+        // -----
+        // limit
+        // -----
+
+		size_type limit () const {
+			return _limit;}
+
+        // ------
+        // misses
+        // ------
+
+        /**
+         * return how many allocate calls found none
+         */
+		size_type misses () const {
+			return _misses;}
+
+        // ---------
+        // set_limit
+        // ---------
+
+        /**
+         * @param n a size_type
+         * keep at most n free blocks, releasing any beyond that
+         */
+		void set_limit (size_type n) {
+			std::unique_lock<std::mutex> g(_m, std::defer_lock);
+			if (_shared)
+				g.lock();
+			_limit = n;
+			while (_n > _limit) {
+				_a.deallocate(unlink(_free), _width);
+				--_n;}}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * return the number of free blocks held
+         */
+		size_type size () const {
+			return _n;}
+
+        // -----
+        // width
+        // -----
+
+		size_type width () const {
+			return _width;}};
 
 // -------
 // my_deque
 // -------
 
-template < typename T, typename A = std::allocator<T> >
-class my_deque {
+/**
+ * S is the stats policy, deque_no_stats or deque_stats<>, inherited privately so that an empty one takes no space
+ */
+template < typename T, typename A = std::allocator<T>, typename G = deque_growth<>, typename S = deque_no_stats >
+class my_deque : private S {
 	public:
 		// --------
         // typedefs
         // --------
 
 		typedef A										 allocator_type;
+		typedef G										 growth_policy;
+		typedef S										 stats_type;
 		typedef typename allocator_type::value_type		 value_type;	
 
 		typedef typename allocator_type::size_type		 size_type;
@@ -137,15 +834,47 @@ class my_deque {
 		// <your data>
 		allocator_type2 _a2; 
 		
-		pointer2 _out_b;	
-		pointer2 _out_e;	
-		pointer _b;		
-		pointer _e;		
+		pointer2 _out_b;	// first slot of the block map
+		pointer2 _out_e;	// one past the last slot of the block map
+		pointer2 _rb;		// first allocated block, [_rb, _b) are spare
+		pointer2 _b;		// block holding the front element
+		pointer2 _e;		// one past the block holding end()
+		pointer2 _re;		// one past the last allocated block, [_e, _re) are spare
+		size_type _f;		// offset of the front element in *_b
+		size_type _s;		// number of elements
+		size_type _nf;		// spare blocks pop_front keeps in front, set by reserve_front
+		size_type _nb;		// spare blocks pop_back keeps in back, set by reserve_back
+
+		struct block_cache {
+			pointer    _free;	// released blocks kept for reuse, see my_block_pool::link
+			size_type  _n;		// blocks in _free
+			size_type  _limit;	// most blocks kept in _free
+			size_type  _hits;	// blocks taken from _free or the pool
+			size_type  _misses;	// blocks taken from the allocator
+			my_block_pool<T, A>* _pool;};	// where blocks go past _limit and come from when _free is empty
+
+		block_cache _c;
+
+		// -----
+        // WIDTH
+        // -----
+
+		static const size_type WIDTH = deque_block_size<T>::value;
+
+		static_assert(WIDTH >= 1, "my_deque: deque_block_size must be at least 1");
 
-		pointer _af;		
-		pointer _uf;		
-		pointer _ue;	
-		pointer _ae;	
+		// -----
+        // SHIFT
+        // -----
+
+		static const bool      POW2  = (WIDTH & (WIDTH - 1)) == 0;
+		static const size_type SHIFT = POW2 ? deque_log2<POW2 ? WIDTH : 1>::value : 0;
+
+		// -----------
+        // BLOCK_CACHE
+        // -----------
+
+		static const size_type BLOCK_CACHE = 8;
 
 	private:
 		// -----
@@ -153,18 +882,184 @@ class my_deque {
         // -----
 
 		bool valid () const {			
-			return (!_af && !_uf && !_ue && !_ae) ||
-				((_af <= _uf) && (_uf <= _ue) && (_ue <= _ae));}
+			return (!_out_b && !_out_e && !_rb && !_b && !_e && !_re && !_f && !_s) ||
+				((_out_b <= _rb) && (_rb <= _b) && (_b < _e) && (_e <= _re) && (_re <= _out_e) && (_f < WIDTH) &&
+				 (_f + _s < (_e - _b) * WIDTH) && (_f + _s >= (_e - _b - 1) * WIDTH));}
+
+		// -------------
+        // block/slot_of
+        // -------------
+
+        /**
+         * @param j a size_type, a slot counted from the start of a block
+         * return how many whole blocks j is past that start, a shift when WIDTH is a power of two
+         */
+		static size_type block_of (size_type j) {
+			return POW2 ? (j >> SHIFT) : (j / WIDTH);}
+
+        /**
+         * @param j a size_type, a slot counted from the start of a block
+         * return j's slot within its block, a mask when WIDTH is a power of two
+         */
+		static size_type slot_of (size_type j) {
+			return POW2 ? (j & (WIDTH - 1)) : (j % WIDTH);}
+
+		// ----------
+        // create_map
+        // ----------
+
+        /**
+         * @param s a size_type
+         * allocate a block map and the blocks needed for s elements plus end()
+         * the elements themselves are left unconstructed
+         */
+		void create_map (size_type s) {
+			const size_type nodes = block_of(s) + 1;
+			const size_type n     = std::max(size_type(8), nodes + 2);
+			_out_b = _a2.allocate(n);
+			this->stat_allocate(n * sizeof(T*));
+			_out_e = _out_b + n;
+			_rb = _b = _e = _re = _out_b + std::min(n - nodes, size_type(growth_policy::front_slack(n - nodes)));
+			_f = _s = _nf = _nb = 0;
+			try {
+				while (_re != _b + nodes) {
+					*_re = acquire_block();
+					++_re;}}
+			catch (...) {
+				destroy_map();
+				throw;}
+			_e = _re;}
+
+		// -----------
+        // destroy_map
+        // -----------
+
+        /**
+         * deallocate every block and the block map
+         * the elements must already be destroyed
+         */
+		void destroy_map () {
+			if (_out_b) {
+				for (pointer2 p = _rb; p != _re; ++p)
+					release_block(*p);
+				_a2.deallocate(_out_b, _out_e - _out_b);
+				this->stat_deallocate((_out_e - _out_b) * sizeof(T*));}
+			_out_b = _out_e = _rb = _b = _e = _re = 0;
+			_f = _s = _nf = _nb = 0;}
+
+		// -----------
+        // block cache
+        // -----------
+
+		static block_cache new_cache (size_type limit = BLOCK_CACHE, my_block_pool<T, A>* pool = 0) {
+			block_cache c = {0, 0, limit, 0, 0, pool};
+			return c;}
+
+        /**
+         * return a block from the cache, else from the pool, else from the allocator
+         */
+		pointer acquire_block () {
+			if (_c._n) {
+				--_c._n;
+				++_c._hits;
+				return my_block_pool<T, A>::unlink(_c._free);}
+			if (_c._pool)
+				if (pointer p = _c._pool->allocate()) {
+					++_c._hits;
+					return p;}
+			++_c._misses;
+			pointer p = _a.allocate(WIDTH);
+			this->stat_allocate(WIDTH * sizeof(T));
+			return p;}
+
+        /**
+         * @param p a block, whose elements are already destroyed
+         * keep p in the cache, else in the pool, else deallocate it
+         */
+		void release_block (pointer p) {
+			if (_c._n < _c._limit) {
+				my_block_pool<T, A>::link(_c._free, p);
+				++_c._n;}
+			else if (!_c._pool || !_c._pool->deallocate(p)) {
+				_a.deallocate(p, WIDTH);
+				this->stat_deallocate(WIDTH * sizeof(T));}}
+
+        /**
+         * @param n a size_type
+         * release cached blocks until at most n are left, to the pool if there is one
+         */
+		void trim_cache (size_type n) {
+			while (_c._n > n) {
+				--_c._n;
+				pointer p = my_block_pool<T, A>::unlink(_c._free);
+				if (!_c._pool || !_c._pool->deallocate(p)) {
+					_a.deallocate(p, WIDTH);
+					this->stat_deallocate(WIDTH * sizeof(T));}}}
+
+		// --------------
+        // reallocate_map
+        // --------------
+
+        /**
+         * @param n a size_type
+         * @param front a bool
+         * make room for n more block pointers at the front or the back of the map
+         * recenters in place when the map is less than half full, otherwise grows it,
+         * both as directed by the growth policy
+         * only block pointers move, the elements stay where they are
+         */
+		void reallocate_map (size_type n, bool front) {
+			const size_type old_nodes = _re - _rb;
+			const size_type new_nodes = old_nodes + n;
+			const size_type old_size  = _out_e - _out_b;
+			const size_type i         = _b - _rb;
+			const size_type j         = _e - _rb;
+			pointer2 b;
+			this->stat_relocate();
+			if (old_size > 2 * new_nodes) {
+				b = _out_b + std::min(old_size - new_nodes, size_type(growth_policy::front_slack(old_size - new_nodes))) + (front ? n : 0);
+				if (b < _rb)
+					std::copy(_rb, _re, b);
+				else
+					std::copy_backward(_rb, _re, b + old_nodes);}
+			else {
+				const size_type new_size = growth_policy::grow(old_size, n);
+				pointer2 m = _a2.allocate(new_size);
+				this->stat_allocate(new_size * sizeof(T*));
+				b = m + std::min(new_size - new_nodes, size_type(growth_policy::front_slack(new_size - new_nodes))) + (front ? n : 0);
+				std::copy(_rb, _re, b);
+				_a2.deallocate(_out_b, old_size);
+				this->stat_deallocate(old_size * sizeof(T*));
+				_out_b = m;
+				_out_e = m + new_size;}
+			_rb = b;
+			_b  = b + i;
+			_e  = b + j;
+			_re = b + old_nodes;}
+
+		// -----------
+        // reserve_map
+        // -----------
+
+        /**
+         * @param n a size_type
+         * make sure n more blocks can be linked in after the last allocated block
+         */
+		void reserve_map_back (size_type n) {
+			if (n > size_type(_out_e - _re))
+				reallocate_map(n, false);}
 
-		// my_deque(my_deque& that, size_type s): _a(that._a), _a2(){
-        //     _uf = _af = _a.allocate(s);
-        //     _out_b = _out_e = 0;
-        //     _ue = _ae = _uf + s;
-        //     uninitialized_copy(_a, that.begin(), that.end(), begin());
-        //     assert(valid());
-        // }
+        /**
+         * @param n a size_type
+         * make sure n more blocks can be linked in before the first allocated block
+         */
+		void reserve_map_front (size_type n) {
+			if (n > size_type(_rb - _out_b))
+				reallocate_map(n, true);}
 
 	public:
+		class const_iterator;
+
 		// --------
         // iterator
         // --------
@@ -174,34 +1069,58 @@ class my_deque {
                 // typedefs
                 // --------
 
-				typedef std::bidirectional_iterator_tag   	iterator_category;
+				typedef std::random_access_iterator_tag   	iterator_category;
 				typedef typename my_deque::value_type	  	value_type;
 				typedef typename my_deque::difference_type 	difference_type;
-				typedef typename my_deque::pointer	  		pointer;
-				typedef typename my_deque::reference	  	reference;
+				typedef typename my_deque::pointer	pointer;
+				typedef typename my_deque::reference	reference;
 				typedef typename my_deque::size_type 	  	size_type;
 
+				friend class my_deque;
+				friend class my_deque::const_iterator;
+
 			public:
                 // -----------
                 // operator ==
                 // -----------
 
                 /**
-                 * @param lhs an iterator reference 
-                 * @param rhs an iterator reference
-                 * reutrn true if rhs and lhs are pointing the same location
+                 * @param lhs a iterator reference 
+                 * @param rhs a iterator reference
+                 * return true if rhs and lhs are pointing the same location
                  */
 				friend bool operator == (const iterator& lhs, const iterator& rhs) {
-					return lhs._d == rhs._d && lhs._p == rhs._p;}
+					return lhs._cur == rhs._cur;}
 
                 /**
-                 * @param lhs an iterator reference 
-                 * @param rhs an iterator reference
+                 * @param lhs a iterator reference 
+                 * @param rhs a iterator reference
                  * return true if lhs and rhs are not on the same location
                  */
 				friend bool operator != (const iterator& lhs, const iterator& rhs) {
 					return !(lhs == rhs);}
 
+                // ----------
+                // operator <
+                // ----------
+
+                /**
+                 * @param lhs a iterator reference 
+                 * @param rhs a iterator reference
+                 * return true if lhs is before rhs in the deque
+                 */
+				friend bool operator < (const iterator& lhs, const iterator& rhs) {
+					return (lhs._node == rhs._node) ? (lhs._cur < rhs._cur) : (lhs._node < rhs._node);}
+
+				friend bool operator > (const iterator& lhs, const iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const iterator& lhs, const iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const iterator& lhs, const iterator& rhs) {
+					return !(lhs < rhs);}
+
                 // ----------
                 // operator +
                 // ----------
@@ -214,6 +1133,9 @@ class my_deque {
 				friend iterator operator + (iterator lhs, difference_type rhs) {
 					return lhs += rhs;}
 
+				friend iterator operator + (difference_type lhs, iterator rhs) {
+					return rhs += lhs;}
+
                 // ----------
                 // operator -
                 // ----------
@@ -226,15 +1148,23 @@ class my_deque {
 				friend iterator operator - (iterator lhs, difference_type rhs) {
 					return lhs -= rhs;}
 
+                /**
+                 * @param lhs a iterator reference
+                 * @param rhs a iterator reference
+                 * return the number of elements from rhs to lhs
+                 */
+				friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+					return difference_type(WIDTH) * (lhs._node - rhs._node) + (lhs._cur - lhs._first) - (rhs._cur - rhs._first);}
+
 			private:
                 // ----
                 // data
                 // ----
 
-                // <your data>
-
-				my_deque* _d;
-				size_type _p;
+				pointer2 _node;		// slot of the current block in the block map
+				pointer  _cur;		// current element
+				pointer  _first;	// first element of the current block
+				pointer  _last;		// one past the last element of the current block
 
 			private:
                 // -----
@@ -242,21 +1172,41 @@ class my_deque {
                 // -----
 
 				bool valid () const {
-					return _p >= 0;}
+					return (!_node && !_cur && !_first && !_last) ||
+						((_first <= _cur) && (_cur < _last) && (_last - _first == difference_type(WIDTH)));}
+
+                // --------
+                // set_node
+                // --------
+
+                /**
+                 * @param node a pointer2
+                 * move onto the block in slot node, _cur is left for the caller to set
+                 */
+				void set_node (pointer2 node) {
+					_node  = node;
+					_first = *node;
+					_last  = _first + WIDTH;}
 
-			public:
                 // -----------
                 // constructor
                 // -----------
 
                 /**
-                 * construct an iterator for a my_deque object
+                 * @param node a pointer2
+                 * @param cur a pointer
+                 * construct an iterator to the element cur in the block at slot node
                  */
+				iterator (pointer2 node, pointer cur) :
+						_node(node), _cur(cur), _first(*node), _last(*node + WIDTH) {
+					assert(valid());}
 
-				iterator (my_deque* d, size_type i = 0) {
-					// <your code>
-					_d = d;
-					_p = i;
+			public:
+                /**
+                 * construct a singular iterator
+                 */
+				iterator () :
+						_node(0), _cur(0), _first(0), _last(0) {
 					assert(valid());}
 
                 // Default copy, destructor, and copy assignment.
@@ -272,9 +1222,7 @@ class my_deque {
                  * return reference to the value at iterator location
                  */
 				reference operator * () const {
-					// <your code>
-                    // dummy is just to be able to compile the skeleton, remove it                   
-					return (*_d)[_p];}
+					return *_cur;}
 
                 // -----------
                 // operator ->
@@ -284,7 +1232,18 @@ class my_deque {
                  * return pointer to the value at iterator location
                  */
 				pointer operator -> () const {
-					return &**this;}
+					return _cur;}
+
+                // -----------
+                // operator []
+                // -----------
+
+                /**
+                 * @param n a difference_type
+                 * return reference to the value n elements away
+                 */
+				reference operator [] (difference_type n) const {
+					return *(*this + n);}
 
                 // -----------
                 // operator ++
@@ -292,10 +1251,13 @@ class my_deque {
 
                 /**
                  * move the pointer to next element in my_deque
+                 * only steps onto the next block when the current one is used up
                  * return iterator reference 
                  */
 				iterator& operator ++ () {
-					++_p;
+					if (++_cur == _last) {
+						set_node(_node + 1);
+						_cur = _first;}
 					assert(valid());
 					return *this;}
 
@@ -316,10 +1278,14 @@ class my_deque {
 
                 /**
                  * move the pointer to previous element in my_deque
+                 * only steps onto the previous block when at the front of the current one
                  * return iterator reference 
                  */
 				iterator& operator -- () {
-					--_p;
+					if (_cur == _first) {
+						set_node(_node - 1);
+						_cur = _last;}
+					--_cur;
 					assert(valid());
 					return *this;}
 
@@ -344,7 +1310,14 @@ class my_deque {
                  * return reference to iterator
                  */
 				iterator& operator += (difference_type d) {
-					_p += d;
+					const difference_type w = WIDTH;
+					const difference_type i = d + (_cur - _first);
+					if ((i >= 0) && (i < w))
+						_cur += d;
+					else {
+						const difference_type n = (i > 0) ? difference_type(block_of(i)) : ~difference_type(block_of(~i));
+						set_node(_node + n);
+						_cur = _first + (i - n * w);}
 					assert(valid());
 					return *this;}
 
@@ -358,9 +1331,7 @@ class my_deque {
                  * return reference to iterator
                  */
 				iterator& operator -= (difference_type d) {
-					_p -= d;
-					assert(valid());
-					return *this;}};
+					return *this += -d;}};
 
 	public:
         // --------------
@@ -373,67 +1344,101 @@ class my_deque {
                 // typedefs
                 // --------
 
-				typedef std::bidirectional_iterator_tag    iterator_category;
-				typedef typename my_deque::value_type	   value_type;
-				typedef typename my_deque::difference_type difference_type;
-				typedef typename my_deque::const_pointer   pointer;
-				typedef typename my_deque::const_reference reference;
-				typedef typename my_deque::size_type 	   size_type;
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_deque::value_type	  	value_type;
+				typedef typename my_deque::difference_type 	difference_type;
+				typedef typename my_deque::const_pointer	pointer;
+				typedef typename my_deque::const_reference	reference;
+				typedef typename my_deque::size_type 	  	size_type;
+
+				friend class my_deque;
 
 			public:
-				// -----------
+                // -----------
                 // operator ==
                 // -----------
 
                 /**
-                 * @param lhs a const const_iterator reference 
-                 * @param rhs a const const_iterator reference 
-                 * return true if the lhs and rhs are pointing the same location
+                 * @param lhs a const_iterator reference 
+                 * @param rhs a const_iterator reference
+                 * return true if rhs and lhs are pointing the same location
                  */
-
 				friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
-					return lhs._d == rhs._d && lhs._p == rhs._p;}
+					return lhs._cur == rhs._cur;}
 
                 /**
-                 * @param lhs a const const_iterator reference 
-                 * @param rhs a const const_iterator reference 
-                 * return true if the lhs and rhs are not pointing the same location
+                 * @param lhs a const_iterator reference 
+                 * @param rhs a const_iterator reference
+                 * return true if lhs and rhs are not on the same location
                  */
 				friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
 					return !(lhs == rhs);}
 
+                // ----------
+                // operator <
+                // ----------
+
+                /**
+                 * @param lhs a const_iterator reference 
+                 * @param rhs a const_iterator reference
+                 * return true if lhs is before rhs in the deque
+                 */
+				friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs._node == rhs._node) ? (lhs._cur < rhs._cur) : (lhs._node < rhs._node);}
+
+				friend bool operator > (const const_iterator& lhs, const const_iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs < rhs);}
+
                 // ----------
                 // operator +
                 // ----------
 
                 /**
-                 * @param lhs a const_iterator 
-                 * @param rhs a difference_type
-                 * return lhs with the sum of lhs and rhs
+                 * @param lhs an const_iterator value
+                 * @param rhs a difference_type value
+                 * return the sum of two value to lhs
                  */
-				friend const_iterator operator + (const_iterator lhs, difference_type d) {
-					return lhs += d;}
+				friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+					return rhs += lhs;}
 
                 // ----------
                 // operator -
                 // ----------
 
                 /**
-                 * @param lhs a const_iterator 
-                 * @param rhs a difference_type
-                 * return lhs with the subtraction of lhs and rhs
+                 * @param lhs an const_iterator value
+                 * @param rhs a difference_type value
+                 * return the subtraction of two values to lhs.
+                 */
+				friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+                /**
+                 * @param lhs a const_iterator reference
+                 * @param rhs a const_iterator reference
+                 * return the number of elements from rhs to lhs
                  */
-				friend const_iterator operator - (const_iterator lhs, difference_type d) {
-					return lhs -= d;}
+				friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+					return difference_type(WIDTH) * (lhs._node - rhs._node) + (lhs._cur - lhs._first) - (rhs._cur - rhs._first);}
 
 			private:
                 // ----
                 // data
                 // ----
 
-                // <your data>
-				const my_deque*  _d;
-				size_type 	_p;
+				pointer2 _node;		// slot of the current block in the block map
+				pointer  _cur;		// current element
+				pointer  _first;	// first element of the current block
+				pointer  _last;		// one past the last element of the current block
 
 			private:
                 // -----
@@ -441,30 +1446,50 @@ class my_deque {
                 // -----
 
 				bool valid () const {
-					// <your code>
-					return _p >= 0;
-				}
+					return (!_node && !_cur && !_first && !_last) ||
+						((_first <= _cur) && (_cur < _last) && (_last - _first == difference_type(WIDTH)));}
+
+                // --------
+                // set_node
+                // --------
+
+                /**
+                 * @param node a pointer2
+                 * move onto the block in slot node, _cur is left for the caller to set
+                 */
+				void set_node (pointer2 node) {
+					_node  = node;
+					_first = *node;
+					_last  = _first + WIDTH;}
 
-			public:
                 // -----------
                 // constructor
                 // -----------
 
                 /**
-                 * @param d read-only pointer to the my_deque this iterator is associated
-                 * @param i int value which represents the index of the element this iterator will point to initially
+                 * @param node a pointer2
+                 * @param cur a pointer
+                 * construct an const_iterator to the element cur in the block at slot node
+                 */
+				const_iterator (pointer2 node, pointer cur) :
+						_node(node), _cur(cur), _first(*node), _last(*node + WIDTH) {
+					assert(valid());}
+
+			public:
+                /**
+                 * construct a singular const_iterator
                  */
-				const_iterator (const my_deque* d, size_type i){
-					// <your code>
-					_d = d;
-					_p = i;
+				const_iterator () :
+						_node(0), _cur(0), _first(0), _last(0) {
 					assert(valid());}
 
-                // const_iterator (const iterator& it){
-                //     // <your code>
-                //     _d = it._d;
-                //     _p = it._p;
-                //     assert(valid());}
+                /**
+                 * @param it an iterator
+                 * convert an iterator into a const_iterator to the same element
+                 */
+				const_iterator (const iterator& it) :
+						_node(it._node), _cur(it._cur), _first(it._first), _last(it._last) {
+					assert(valid());}
 
                 // Default copy, destructor, and copy assignment.
                 // const_iterator (const const_iterator&);
@@ -476,20 +1501,31 @@ class my_deque {
                 // ----------
 
                 /**
-                 * return reference to the value at iterator location
+                 * return reference to the value at const_iterator location
                  */
 				reference operator * () const {
-					return (*_d)[_p];}
+					return *_cur;}
 
                 // -----------
                 // operator ->
                 // -----------
 
                 /**
-                 * return pointer to the value at iterator location
+                 * return pointer to the value at const_iterator location
                  */
 				pointer operator -> () const {
-					return &**this;}
+					return _cur;}
+
+                // -----------
+                // operator []
+                // -----------
+
+                /**
+                 * @param n a difference_type
+                 * return reference to the value n elements away
+                 */
+				reference operator [] (difference_type n) const {
+					return *(*this + n);}
 
                 // -----------
                 // operator ++
@@ -497,14 +1533,17 @@ class my_deque {
 
                 /**
                  * move the pointer to next element in my_deque
+                 * only steps onto the next block when the current one is used up
                  * return const_iterator reference 
                  */
 				const_iterator& operator ++ () {
-					++_p;
+					if (++_cur == _last) {
+						set_node(_node + 1);
+						_cur = _first;}
 					assert(valid());
 					return *this;}
 
-                /**
+                 /**
                  * @param int is same as this
                  * increment this
                  * return const_iterator
@@ -515,20 +1554,23 @@ class my_deque {
 					assert(valid());
 					return x;}
 
-                 // -----------
+                // -----------
                 // operator --
                 // -----------
 
                 /**
                  * move the pointer to previous element in my_deque
+                 * only steps onto the previous block when at the front of the current one
                  * return const_iterator reference 
                  */
 				const_iterator& operator -- () {
-					--_p;
+					if (_cur == _first) {
+						set_node(_node - 1);
+						_cur = _last;}
+					--_cur;
 					assert(valid());
 					return *this;}
 
-                
                 /**
                  * @param int is same as this
                  * decrement this
@@ -549,8 +1591,15 @@ class my_deque {
                  * move the reference forward with d elements
                  * return reference to const_iterator
                  */
-				const_iterator& operator += (difference_type n) {
-					_p += n;
+				const_iterator& operator += (difference_type d) {
+					const difference_type w = WIDTH;
+					const difference_type i = d + (_cur - _first);
+					if ((i >= 0) && (i < w))
+						_cur += d;
+					else {
+						const difference_type n = (i > 0) ? difference_type(block_of(i)) : ~difference_type(block_of(~i));
+						set_node(_node + n);
+						_cur = _first + (i - n * w);}
 					assert(valid());
 					return *this;}
 
@@ -563,10 +1612,657 @@ class my_deque {
                  * move the reference backward with d elements
                  * return reference to const_iterator
                  */
-				const_iterator& operator -= (difference_type n) {
-					_p -= n;
-					assert(valid());
-					return *this;}};
+				const_iterator& operator -= (difference_type d) {
+					return *this += -d;}};
+
+	public:
+        // -------------
+        // segment_range
+        // -------------
+
+        /**
+         * the contiguous pieces of a range [b, e) of a my_deque, one deque_span per block it touches, in order
+         * P is pointer or const_pointer, see segments
+         */
+		template <typename P>
+		class segment_range {
+			public:
+				typedef deque_span<typename std::remove_pointer<P>::type> span_type;
+
+				class iterator {
+					public:
+						typedef std::forward_iterator_tag iterator_category;
+						typedef span_type                 value_type;
+						typedef std::ptrdiff_t            difference_type;
+						typedef const span_type*          pointer;
+						typedef span_type                 reference;
+
+						friend class segment_range;
+
+					public:
+						friend bool operator == (const iterator& lhs, const iterator& rhs) {
+							return lhs._cur == rhs._cur;}
+
+						friend bool operator != (const iterator& lhs, const iterator& rhs) {
+							return !(lhs == rhs);}
+
+					private:
+						pointer2 _node;		// slot of the block holding _cur
+						P        _cur;		// start of the current span
+						pointer2 _last;		// slot of the block holding _end
+						P        _end;		// one past the range, the current span is the last when _node is _last
+
+					private:
+						iterator (pointer2 node, P cur, pointer2 last, P end) :
+								_node(node), _cur(cur), _last(last), _end(end) {}
+
+					public:
+						iterator () :
+								_node(0), _cur(0), _last(0), _end(0) {}
+
+                        /**
+                         * return the span from the current position to the end of its block or of the range
+                         */
+						span_type operator * () const {
+							return span_type(_cur, ((_node == _last) ? _end : *_node + WIDTH) - _cur);}
+
+                        /**
+                         * step onto the next block, or onto end() after the last one
+                         */
+						iterator& operator ++ () {
+							if (_node == _last)
+								_cur = _end;
+							else
+								_cur = *++_node;
+							return *this;}
+
+						iterator operator ++ (int) {
+							iterator x = *this;
+							++(*this);
+							return x;}};
+
+			private:
+				iterator _b;
+
+			public:
+                /**
+                 * @param node the slot of the block holding the first element
+                 * @param cur the first element
+                 * @param last the slot of the block holding end
+                 * @param end one past the last element
+                 */
+				segment_range (pointer2 node, P cur, pointer2 last, P end) :
+						_b(node, cur, last, end) {}
+
+				iterator begin () const {
+					return _b;}
+
+				iterator end () const {
+					return iterator(_b._last, _b._end, _b._last, _b._end);}
+
+				bool empty () const {
+					return _b._cur == _b._end;}};
+
+	private:
+		// ----------
+        // relocation
+        // ----------
+
+		/**
+		 * true when elements may be shifted with memmove instead of move assignment
+		 */
+		typedef std::integral_constant<bool,
+			is_trivially_relocatable<value_type>::value && uses_default_construct<allocator_type>::value &&
+			std::is_nothrow_move_constructible<value_type>::value> relocatable;
+
+		// ---------
+        // grow/drop
+        // ---------
+
+        /**
+         * add one raw slot at the back
+         * when end() would fall off the last block, a spare block is put in use or a new one is allocated
+         */
+		void grow_back () {
+			if (!_out_b)
+				create_map(0);
+			if (_f + _s + 1 == (_e - _b) * WIDTH) {
+				if (_e == _re) {
+					reserve_map_back(1);
+					*_re = acquire_block();
+					++_re;}
+				++_e;}
+			++_s;
+			this->stat_size(_s, (_re - _rb) * WIDTH);}
+
+        /**
+         * add one raw slot at the front
+         * when the first block is full, a spare block is put in use or a new one is allocated
+         */
+		void grow_front () {
+			if (!_out_b)
+				create_map(0);
+			if (_f == 0) {
+				if (_b == _rb) {
+					reserve_map_front(1);
+					*(_rb - 1) = acquire_block();
+					--_rb;}
+				--_b;
+				_f = WIDTH;}
+			--_f;
+			++_s;
+			this->stat_size(_s, (_re - _rb) * WIDTH);}
+
+        /**
+         * forget the back slot, whose element is already destroyed or relocated
+         * once the last block no longer holds end() it becomes a spare,
+         * and the farthest spare is released if that leaves more than reserve_back asked for
+         */
+		void drop_back () {
+			if (slot_of(_f + _s) == 0) {
+				--_e;
+				if (size_type(_re - _e) > _nb) {
+					--_re;
+					release_block(*_re);}}
+			--_s;}
+
+        /**
+         * forget the front slot, whose element is already destroyed or relocated
+         * once the first block is emptied it becomes a spare,
+         * and the farthest spare is released if that leaves more than reserve_front asked for
+         */
+		void drop_front () {
+			--_s;
+			if (++_f == WIDTH) {
+				++_b;
+				if (size_type(_b - _rb) > _nf) {
+					release_block(*_rb);
+					++_rb;}
+				_f = 0;}}
+
+        /**
+         * @param n a size_type
+         * add n raw slots at the back, putting spare blocks in use and allocating the rest at once
+         */
+		void grow_back (size_type n) {
+			if (!_out_b)
+				create_map(0);
+			const size_type k = block_of(_f + _s + n) + 1;
+			if (k > size_type(_re - _b)) {
+				reserve_map_back(k - (_re - _b));
+				while (_re != _b + k) {
+					*_re = acquire_block();
+					++_re;}}
+			_e = _b + k;
+			_s += n;
+			this->stat_size(_s, (_re - _rb) * WIDTH);}
+
+        /**
+         * @param n a size_type
+         * add n raw slots at the front, putting spare blocks in use and allocating the rest at once
+         */
+		void grow_front (size_type n) {
+			if (!_out_b)
+				create_map(0);
+			if (n > _f) {
+				const size_type k = block_of(n - _f - 1) + 1;
+				if (k > size_type(_b - _rb)) {
+					reserve_map_front(k - (_b - _rb));
+					while (_rb != _b - k) {
+						*(_rb - 1) = acquire_block();
+						--_rb;}}
+				_b -= k;
+				_f += k * WIDTH;}
+			_f -= n;
+			_s += n;
+			this->stat_size(_s, (_re - _rb) * WIDTH);}
+
+        /**
+         * @param n a size_type
+         * forget the n back slots, whose elements are already destroyed or relocated
+         * emptied blocks become spares, released beyond what reserve_back asked for
+         */
+		void drop_back (size_type n) {
+			_s -= n;
+			_e = _b + block_of(_f + _s) + 1;
+			while (size_type(_re - _e) > _nb) {
+				--_re;
+				release_block(*_re);}}
+
+        /**
+         * @param n a size_type
+         * forget the n front slots, whose elements are already destroyed or relocated
+         * emptied blocks become spares, released beyond what reserve_front asked for
+         */
+		void drop_front (size_type n) {
+			_s -= n;
+			_f += n;
+			_b += block_of(_f);
+			_f = slot_of(_f);
+			while (size_type(_b - _rb) > _nf) {
+				release_block(*_rb);
+				++_rb;}}
+
+		// ------
+        // blocks
+        // ------
+
+        /**
+         * @param b a forward iterator
+         * @param x an iterator
+         * @param e an iterator
+         * copy constructs e - x values read from b into the raw slots [x, e), one block at a time
+         * return b advanced past the values read
+         */
+		template <typename II>
+		II uninitialized_copy_blocks (II b, iterator x, iterator e) {
+			iterator p = x;
+			try {
+				while (x != e) {
+					const difference_type k = std::min(e - x, x._last - x._cur);
+					II m = b;
+					std::advance(m, k);
+					uninitialized_copy(_a, b, m, x._cur);
+					b = m;
+					x += k;}}
+			catch (...) {
+				destroy_blocks(p, x);
+				throw;}
+			return b;}
+
+        /**
+         * @param b a const_iterator
+         * @param e a const_iterator
+         * @param x an iterator
+         * copy constructs [b, e) into the raw slots at x, one contiguous run at a time
+         * return the end of the constructed range
+         */
+		iterator uninitialized_copy_blocks (const_iterator b, const_iterator e, iterator x) {
+			iterator p = x;
+			try {
+				while (b != e) {
+					const difference_type k = std::min(e - b, std::min(b._last - b._cur, x._last - x._cur));
+					uninitialized_copy(_a, b._cur, b._cur + k, x._cur);
+					b += k;
+					x += k;}}
+			catch (...) {
+				destroy_blocks(p, x);
+				throw;}
+			return x;}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * @param v a const_reference
+         * copy constructs v into the raw slots [b, e), one block at a time
+         */
+		void uninitialized_fill_blocks (iterator b, iterator e, const_reference v) {
+			iterator p = b;
+			try {
+				while (b != e) {
+					const difference_type k = std::min(e - b, b._last - b._cur);
+					uninitialized_fill(_a, b._cur, b._cur + k, v);
+					b += k;}}
+			catch (...) {
+				destroy_blocks(p, b);
+				throw;}}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * destroys [b, e), one block at a time
+         */
+		void destroy_blocks (iterator b, iterator e) {
+			if (std::is_trivially_destructible<value_type>::value && uses_default_construct<allocator_type>::value)
+				return;
+			while (b != e) {
+				const difference_type k = std::min(e - b, b._last - b._cur);
+				destroy(_a, b._cur, b._cur + k);
+				b += k;}}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * @param x an iterator, no later than b
+         * memmove [b, e) down onto x, front to back, one contiguous run at a time
+         * the slots left behind are raw
+         */
+		void relocate_forward (iterator b, iterator e, iterator x) {
+			this->stat_move(e - b);
+			while (b != e) {
+				const difference_type k = std::min(e - b, std::min(b._last - b._cur, x._last - x._cur));
+				std::memmove(static_cast<void*>(x._cur), static_cast<const void*>(b._cur), k * sizeof(value_type));
+				b += k;
+				x += k;}}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * @param x an iterator, the end of the destination, no earlier than e
+         * memmove [b, e) up so that it ends at x, back to front, one contiguous run at a time
+         * the slots left behind are raw
+         */
+		void relocate_backward (iterator b, iterator e, iterator x) {
+			this->stat_move(e - b);
+			const difference_type w = WIDTH;
+			while (e != b) {
+				const difference_type i = (e._cur == e._first) ? w : (e._cur - e._first);
+				const difference_type j = (x._cur == x._first) ? w : (x._cur - x._first);
+				const difference_type k = std::min(e - b, std::min(i, j));
+				e -= k;
+				x -= k;
+				std::memmove(static_cast<void*>(x._cur), static_cast<const void*>(e._cur), k * sizeof(value_type));}}
+
+        // -----------
+        // erase_shift
+        // -----------
+
+        /**
+         * @param p an iterator, neither the first nor the last element
+         * remove *p by relocating the shorter side one slot toward it
+         */
+		void erase_shift (iterator p, std::true_type) {
+			_a.destroy(&*p);
+			if (p - begin() < end() - p - 1) {
+				relocate_backward(begin(), p, p + 1);
+				drop_front();}
+			else {
+				relocate_forward(p + 1, end(), p);
+				drop_back();}}
+
+        /**
+         * @param p an iterator, neither the first nor the last element
+         * remove *p by move assigning the shorter side one slot toward it
+         */
+		void erase_shift (iterator p, std::false_type) {
+			if (p - begin() < end() - p - 1) {
+				this->stat_move(p - begin());
+				std::move_backward(begin(), p, p + 1);
+				pop_front();}
+			else {
+				this->stat_move(end() - (p + 1));
+				std::move(p + 1, end(), p);
+				pop_back();}}
+
+        // ------------
+        // insert_shift
+        // ------------
+
+        /**
+         * @param i a difference_type, neither 0 nor size()
+         * @param x a value_type rvalue reference
+         * open a raw slot at index i by relocating the shorter side one slot away from it, then move x into it
+         * return iterator to the new element
+         */
+		iterator insert_shift (difference_type i, value_type&& x, std::true_type) {
+			if (i < difference_type(size()) - i) {
+				grow_front();
+				relocate_forward(begin() + 1, begin() + (i + 1), begin());}
+			else {
+				grow_back();
+				relocate_backward(begin() + i, end() - 1, end());}
+			iterator p = begin() + i;
+			_a.construct(&*p, std::move(x));
+			return p;}
+
+        /**
+         * @param i a difference_type, neither 0 nor size()
+         * @param x a value_type rvalue reference
+         * move the end element on the shorter side into a new slot, move assign the rest of that side one slot away from i,
+         * then move x into index i
+         * return iterator to the new element
+         */
+		iterator insert_shift (difference_type i, value_type&& x, std::false_type) {
+			if (i < difference_type(size()) - i) {
+				emplace_front(std::move(front()));
+				this->stat_move(i);
+				std::move(begin() + 2, begin() + (i + 1), begin() + 1);}
+			else {
+				emplace_back(std::move(back()));
+				this->stat_move(end() - (begin() + i) - 1);
+				std::move_backward(begin() + i, end() - 2, end() - 1);}
+			iterator p = begin() + i;
+			*p = std::move(x);
+			return p;}
+
+		// ------
+        // ranges
+        // ------
+
+		template <typename II>
+		void append_range (II b, II e, std::input_iterator_tag) {
+			while (b != e) {
+				emplace_back(*b);
+				++b;}}
+
+        /**
+         * constructs the whole range into raw slots opened in one step
+         */
+		template <typename FI>
+		void append_range (FI b, FI e, std::forward_iterator_tag) {
+			const size_type n = std::distance(b, e);
+			if (n == 0)
+				return;
+			grow_back(n);
+			try {
+				uninitialized_copy_blocks(b, end() - n, end());}
+			catch (...) {
+				drop_back(n);
+				throw;}}
+
+		template <typename II>
+		void prepend_range (II b, II e, std::input_iterator_tag) {
+			size_type n = 0;
+			while (b != e) {
+				emplace_front(*b);
+				++b;
+				++n;}
+			std::reverse(begin(), begin() + n);}
+
+        /**
+         * constructs the whole range into raw slots opened in one step
+         */
+		template <typename FI>
+		void prepend_range (FI b, FI e, std::forward_iterator_tag) {
+			const size_type n = std::distance(b, e);
+			if (n == 0)
+				return;
+			grow_front(n);
+			try {
+				uninitialized_copy_blocks(b, begin(), begin() + n);}
+			catch (...) {
+				drop_front(n);
+				throw;}}
+
+        /**
+         * prepends or appends the range, whichever side of i is shorter, then rotates it into place
+         */
+		template <typename II>
+		void insert_range (size_type i, II b, II e, std::input_iterator_tag, std::false_type) {
+			const size_type n = size();
+			if (i < n - i) {
+				prepend_range(b, e, typename std::iterator_traits<II>::iterator_category());
+				const size_type k = size() - n;
+				this->stat_move(i);
+				std::rotate(begin(), begin() + k, begin() + (k + i));}
+			else {
+				append_range(b, e, typename std::iterator_traits<II>::iterator_category());
+				this->stat_move(n - i);
+				std::rotate(begin() + i, begin() + n, end());}}
+
+		template <typename II>
+		void insert_range (size_type i, II b, II e, std::input_iterator_tag, std::true_type) {
+			insert_range(i, b, e, std::input_iterator_tag(), std::false_type());}
+
+        /**
+         * relocates the shorter side of i once to open a raw gap, then constructs the range into it
+         */
+		template <typename FI>
+		void insert_range (size_type i, FI b, FI e, std::forward_iterator_tag, std::true_type) {
+			const size_type n = std::distance(b, e);
+			if (n == 0)
+				return;
+			if (i < size() - i) {
+				grow_front(n);
+				iterator p = begin() + i;
+				relocate_forward(begin() + n, p + n, begin());
+				try {
+					uninitialized_copy_blocks(b, p, p + n);}
+				catch (...) {
+					relocate_backward(begin(), p, p + n);
+					drop_front(n);
+					throw;}
+				return;}
+			grow_back(n);
+			iterator p = begin() + i;
+			relocate_backward(p, end() - n, end());
+			try {
+				uninitialized_copy_blocks(b, p, p + n);}
+			catch (...) {
+				relocate_forward(p + n, end(), p);
+				drop_back(n);
+				throw;}}
+
+        /**
+         * @param i a size_type
+         * @param n a size_type
+         * @param v a const_reference, not an element of the deque
+         * relocates the shorter side of i once to open a raw gap, then fills it
+         */
+		void insert_fill (size_type i, size_type n, const_reference v, std::true_type) {
+			if (i < size() - i) {
+				grow_front(n);
+				iterator p = begin() + i;
+				relocate_forward(begin() + n, p + n, begin());
+				try {
+					uninitialized_fill_blocks(p, p + n, v);}
+				catch (...) {
+					relocate_backward(begin(), p, p + n);
+					drop_front(n);
+					throw;}
+				return;}
+			grow_back(n);
+			iterator p = begin() + i;
+			relocate_backward(p, end() - n, end());
+			try {
+				uninitialized_fill_blocks(p, p + n, v);}
+			catch (...) {
+				relocate_forward(p + n, end(), p);
+				drop_back(n);
+				throw;}}
+
+        /**
+         * @param i a size_type
+         * @param n a size_type
+         * @param v a const_reference, not an element of the deque
+         * fills n raw slots on the shorter side of i, then rotates them into place
+         */
+		void insert_fill (size_type i, size_type n, const_reference v, std::false_type) {
+			const size_type m = size();
+			if (i < m - i) {
+				grow_front(n);
+				try {
+					uninitialized_fill_blocks(begin(), begin() + n, v);}
+				catch (...) {
+					drop_front(n);
+					throw;}
+				this->stat_move(i);
+				std::rotate(begin(), begin() + n, begin() + (n + i));
+				return;}
+			grow_back(n);
+			try {
+				uninitialized_fill_blocks(end() - n, end(), v);}
+			catch (...) {
+				drop_back(n);
+				throw;}
+			this->stat_move(size() - i);
+			std::rotate(begin() + i, begin() + m, end());}
+
+        /**
+         * @param b an iterator, not begin()
+         * @param e an iterator, not end()
+         * destroy [b, e) and relocate the shorter side over it in one pass
+         */
+		void erase_range (iterator b, iterator e, std::true_type) {
+			const size_type n = e - b;
+			destroy_blocks(b, e);
+			if (b - begin() < end() - e) {
+				relocate_backward(begin(), b, e);
+				drop_front(n);}
+			else {
+				relocate_forward(e, end(), b);
+				drop_back(n);}}
+
+        /**
+         * @param b an iterator, not begin()
+         * @param e an iterator, not end()
+         * move assign the shorter side over [b, e) in one pass, then destroy the leftovers at that end
+         */
+		void erase_range (iterator b, iterator e, std::false_type) {
+			const size_type n = e - b;
+			if (b - begin() < end() - e) {
+				this->stat_move(b - begin());
+				std::move_backward(begin(), b, e);
+				pop_front_n(n);}
+			else {
+				this->stat_move(end() - e);
+				std::move(e, end(), b);
+				pop_back_n(n);}}
+
+        /**
+         * @param w an iterator at an element to remove
+         * @param l an iterator, the elements of (w, l) are tested with p
+         * @param m an iterator, the elements of [m, end()) are kept untested
+         * @param p a predicate
+         * move every kept element from (w, end()) toward the front over the removed ones, once each,
+         * then destroy the leftovers at the back, releasing the blocks they emptied
+         * if p throws, the gap left so far is erased and every untested element is kept
+         * return how many elements were removed
+         */
+		template <typename P>
+		size_type compact_front (iterator w, iterator l, iterator m, P& p) {
+			const iterator h = w;
+			iterator r = w;
+			try {
+				for (++r; r < l; ++r)
+					if (!p(*r)) {
+						*w = std::move(*r);
+						++w;}}
+			catch (...) {
+				erase(w, r);
+				throw;}
+			this->stat_move((w - h) + (end() - m));
+			w = std::move(m, end(), w);
+			const size_type n = end() - w;
+			pop_back_n(n);
+			return n;}
+
+        /**
+         * @param w an iterator at an element to remove
+         * @param f an iterator, the elements of (f, w) are tested with p, last first
+         * @param m an iterator, the elements of [begin(), m) are kept untested
+         * @param p a predicate
+         * the mirror of compact_front, moving the kept elements of [begin(), w) toward the back
+         * and destroying the leftovers at the front
+         * return how many elements were removed
+         */
+		template <typename P>
+		size_type compact_back (iterator w, iterator f, iterator m, P& p) {
+			const iterator h = w;
+			iterator r = w;
+			try {
+				for (--r; f < r; --r)
+					if (!p(*r)) {
+						*w = std::move(*r);
+						--w;}}
+			catch (...) {
+				erase(r + 1, w + 1);
+				throw;}
+			this->stat_move((h - w) + (m - begin()));
+			w = std::move_backward(begin(), m, w + 1);
+			const size_type n = w - begin();
+			pop_front_n(n);
+			return n;}
 
 	public:
         // ------------
@@ -575,20 +2271,21 @@ class my_deque {
 
         /**
          * @param a an allocator_type reference
-         * set inner,outer array, capacity to size 0
+         * set the block map to null and size to 0, nothing is allocated until the first push
          */
 
-		explicit my_deque (const allocator_type& a = allocator_type()){
-			// <your code>	
-			_a = a;
-            _out_b = 0;
-            _out_e = 0;
-            _e = 0;
-            _b = 0;
-            _ue = 0;
-            _uf = 0;
-            _ae = 0;
-            _af = 0;
+		explicit my_deque (const allocator_type& a = allocator_type())
+			: _a(a), _a2(a), _c(new_cache()) {
+			_out_b = 0;
+			_out_e = 0;
+			_rb = 0;
+			_b = 0;
+			_e = 0;
+			_re = 0;
+			_f = 0;
+			_s = 0;
+			_nf = 0;
+			_nb = 0;
 			assert(valid());}
 
         /**
@@ -598,44 +2295,74 @@ class my_deque {
          * construct an instance with s, v, a given value.
          */
 		explicit my_deque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type())
-			: _a(a), _a2() {
-			// <your code>
-			size_type WIDTH = 50;
-			size_type num_arrays = s / WIDTH + (s % WIDTH? 1 : 0);
-			_out_b = _a2.allocate(num_arrays);
-
-			for (size_type i = 0; i < num_arrays; ++i) {
-				_out_b[i] = _a.allocate(WIDTH);
-			}
-
-			_out_e = _out_b + num_arrays;
-			_b = _out_b[0];
-			size_type offset = WIDTH - (WIDTH * num_arrays - s);
-
-			_e = _out_b[num_arrays - 1] + offset;
-
-			for (size_type i = 0; i < num_arrays; ++i) {
-				_a.deallocate(_out_b[i], WIDTH);
-			}
-
-			_a2.deallocate(_out_b, num_arrays);
-			_af = _uf = _a.allocate(s);
-			_ue = _ae = _uf + s;
-			uninitialized_fill(_a, begin(), end(), v);
+			: _a(a), _a2(a), _c(new_cache()) {
+			create_map(s);
+			try {
+				uninitialized_fill_blocks(begin(), begin() + s, v);}
+			catch (...) {
+				destroy_map();
+				throw;}
+			_s = s;
 			assert(valid());}
         
         /**
          * @param that is a my_deque reference 
          * copy constructor that constrcut a new instance with my_deque content
+         * the copy starts with an empty block cache of the same limit and the same pool
          */
 		my_deque (const my_deque& that) 
-			: _a(that._a) {
-			_a2 = allocator_type2();
-			_out_b = _out_e = 0;
-			_b = _e;
-			_af = _uf = _a.allocate(that.size());
-			_ue = _ae = _uf + that.size();
-			uninitialized_copy(_a, that.begin(), that.end(), begin()); 
+			: S(), _a(that._a), _a2(that._a2), _c(new_cache(that._c._limit, that._c._pool)) {
+			create_map(that.size());
+			try {
+				uninitialized_copy_blocks(that.begin(), that.end(), begin());}
+			catch (...) {
+				destroy_map();
+				throw;}
+			_s = that.size();
+			assert(valid());}
+
+        /**
+         * @param that is a my_deque rvalue reference
+         * move constructor that takes over the block map of that, no element is touched
+         */
+		my_deque (my_deque&& that) noexcept
+			: S(), _a(std::move(that._a)), _a2(std::move(that._a2)), _c(that._c) {
+			_out_b = that._out_b;
+			_out_e = that._out_e;
+			_rb = that._rb;
+			_b = that._b;
+			_e = that._e;
+			_re = that._re;
+			_f = that._f;
+			_s = that._s;
+			_nf = that._nf;
+			_nb = that._nb;
+			that._out_b = that._out_e = that._rb = that._b = that._e = that._re = 0;
+			that._f = that._s = that._nf = that._nb = 0;
+			that._c = new_cache(_c._limit, _c._pool);
+			assert(valid());}
+
+        /**
+         * @param that is a my_deque rvalue reference
+         * @param a an allocator_type reference
+         * move constructor with a given allocator
+         * takes over the block map of that when the allocators compare equal, otherwise moves element by element
+         */
+		my_deque (my_deque&& that, const allocator_type& a)
+			: _a(a), _a2(a), _c(new_cache()) {
+			if (_a == that._a) {
+				_out_b = _out_e = _rb = _b = _e = _re = 0;
+				_f = _s = _nf = _nb = 0;
+				swap(that);}
+			else {
+				create_map(that.size());
+				this->stat_move(that.size());
+				try {
+					uninitialized_copy(_a, std::make_move_iterator(that.begin()), std::make_move_iterator(that.end()), begin());}
+				catch (...) {
+					destroy_map();
+					throw;}
+				_s = that.size();}
 			assert(valid());}
 
         // ----------
@@ -643,12 +2370,12 @@ class my_deque {
         // ----------
 
         /**
-         * deallocate the my_deque
+         * destroy the elements, then deallocate the blocks and the block map
          */
 		~my_deque () {
-			if (_af) {
-				clear();
-				_a.deallocate(_af, (_ae - _af));}
+			destroy_blocks(begin(), end());
+			destroy_map();
+			trim_cache(0);
 			assert(valid());}
 
         // ----------
@@ -667,14 +2394,31 @@ class my_deque {
 				std::copy(rhs.begin(), rhs.end(), begin());
 			else if (rhs.size() < size()) {
 				std::copy(rhs.begin(), rhs.end(), begin());
-				resize(rhs.size());}	
-			else if ((unsigned)rhs.size() <= (unsigned)(_ae - _uf)) {
-				std::copy(rhs.begin(), rhs.begin() + size(), begin());
-				_ue = &(*uninitialized_copy(_a, rhs.begin() + size(), rhs.end(), end()));}
+				pop_back_n(size() - rhs.size());}	
 			else {
-				clear();
-				my_deque x(rhs);
+				std::copy(rhs.begin(), rhs.begin() + size(), begin());
+				append_range(rhs.begin() + size(), rhs.end());}
+			assert(valid());
+			return *this;}
+
+        /**
+         * @param rhs a my_deque rvalue reference
+         * move my_deque instance
+         * takes over the block map of rhs when the allocators compare equal, otherwise move assigns element by element
+         * return my_deque reference
+         */
+		my_deque& operator = (my_deque&& rhs) {
+			if (this == &rhs)
+				return *this;
+			if (_a == rhs._a) {
+				my_deque x(std::move(rhs));
 				swap(x);}
+			else {
+				const size_type n = std::min(size(), rhs.size());
+				this->stat_move(rhs.size());
+				std::move(rhs.begin(), rhs.begin() + n, begin());
+				pop_back_n(size() - n);
+				append_range(std::make_move_iterator(rhs.begin() + n), std::make_move_iterator(rhs.end()));}
 			assert(valid());
 			return *this;}
 
@@ -688,13 +2432,8 @@ class my_deque {
          * return reference of where it is
          */
 		reference operator [] (size_type n) {
-			if(_uf == 0){
-				pointer r;
-				*r = 0;
-				return *r;
-			}
-			pointer r = _uf + n;
-			return *r;}
+			const size_type i = _f + n;
+			return _b[block_of(i)][slot_of(i)];}
 
         /**
          * @param index a size_type
@@ -704,26 +2443,86 @@ class my_deque {
 		const_reference operator [] (size_type n) const {
 			return const_cast<my_deque*>(this)->operator[](n);}
 
-        // --
-        // at
-        // --
+        // ------------
+        // append_range
+        // ------------
 
         /**
-         * @param index a size_type
-         * index the position in the deque 
-         * throw out_of_range exception if access if not in the range
-         * return reference to value of my_deque
+         * @param b an input iterator
+         * @param e an input iterator
+         * add [b, e) at the back of the deque
+         * with forward iterators the blocks are allocated once and no element is moved
          */
-		reference at (size_type index) throw (std:: out_of_range){
-			// <your code>
-			if (index >= size())
-				throw std::out_of_range("Deque");
-			return (*this)[index];}
+		template <typename II>
+		void append_range (II b, II e) {
+			append_range(b, e, typename std::iterator_traits<II>::iterator_category());
+			assert(valid());}
 
         /**
-         * @param index a size_type
-         * index the position in the deque 
-         * throw out_of_range exception if access if not in the range
+         * @param r a range
+         * add the elements of r at the back of the deque
+         */
+		template <typename R>
+		void append_range (const R& r) {
+			append_range(std::begin(r), std::end(r));}
+
+        // ------
+        // assign
+        // ------
+
+        /**
+         * @param b an input iterator
+         * @param e an input iterator
+         * replace the contents with [b, e), assigning over the existing elements first
+         */
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type assign (II b, II e) {
+			iterator x = begin();
+			const iterator y = end();
+			while ((b != e) && (x != y)) {
+				*x = *b;
+				++x;
+				++b;}
+			if (b == e)
+				pop_back_n(y - x);
+			else
+				append_range(b, e);
+			assert(valid());}
+
+        /**
+         * @param n a size_type
+         * @param v a const_reference
+         * replace the contents with n copies of v, assigning over the existing elements first
+         */
+		void assign (size_type n, const_reference v) {
+			if (n <= size()) {
+				std::fill(begin(), begin() + n, v);
+				pop_back_n(size() - n);}
+			else {
+				std::fill(begin(), end(), v);
+				insert(end(), n - size(), v);}
+			assert(valid());}
+
+        // --
+        // at
+        // --
+
+        /**
+         * @param index a size_type
+         * index the position in the deque 
+         * throw out_of_range exception if access if not in the range
+         * return reference to value of my_deque
+         */
+		reference at (size_type index) throw (std:: out_of_range){
+			// <your code>
+			if (index >= size())
+				throw std::out_of_range("Deque");
+			return (*this)[index];}
+
+        /**
+         * @param index a size_type
+         * index the position in the deque 
+         * throw out_of_range exception if access if not in the range
          * return const_reference to value of my_deque
          */
 		const_reference at (size_type index) const {
@@ -740,7 +2539,7 @@ class my_deque {
          */
 		reference back () {
 			assert(! empty());
-			return *(_ue - 1);}
+			return (*this)[_s - 1];}
 
         /**
          * return const_reference to last element in deque
@@ -756,13 +2555,84 @@ class my_deque {
          * return reference to first element in deque
          */
 		iterator begin () {
-			return iterator(this, 0);}
+			if (!_out_b)
+				return iterator();
+			return iterator(_b, *_b + _f);}
 
         /**
          * return const_reference to first element in deque
          */
 		const_iterator begin () const {
-			return const_iterator(this, 0);}
+			if (!_out_b)
+				return const_iterator();
+			return const_iterator(_b, *_b + _f);}
+
+        // -----------
+        // block cache
+        // -----------
+
+        /**
+         * return the most released blocks this deque keeps for reuse, BLOCK_CACHE unless set_block_cache changed it
+         */
+		size_type block_cache_limit () const {
+			return _c._limit;}
+
+        /**
+         * return the number of released blocks this deque holds for reuse
+         */
+		size_type block_cache_size () const {
+			return _c._n;}
+
+        /**
+         * return how many blocks were taken from the cache or the pool instead of the allocator
+         */
+		size_type block_hits () const {
+			return _c._hits;}
+
+        /**
+         * return how many blocks were taken from the allocator
+         */
+		size_type block_misses () const {
+			return _c._misses;}
+
+        /**
+         * return the pool set by set_block_pool, or 0
+         */
+		my_block_pool<T, A>* block_pool () const {
+			return _c._pool;}
+
+        /**
+         * return the number of elements in a block, what a my_block_pool for this deque must be built with
+         */
+		static size_type block_width () {
+			return WIDTH;}
+
+        // --------
+        // capacity
+        // --------
+
+        /**
+         * return how many elements the deque can hold without allocating,
+         * its size plus its front and back headroom
+         */
+		size_type capacity () const {
+			return size() + front_capacity() + back_capacity();}
+
+        /**
+         * return how many push_front calls can be made without allocating
+         */
+		size_type front_capacity () const {
+			if (!_out_b)
+				return 0;
+			return _f + (_b - _rb) * WIDTH;}
+
+        /**
+         * return how many push_back calls can be made without allocating
+         */
+		size_type back_capacity () const {
+			if (!_out_b)
+				return 0;
+			return (_re - _b) * WIDTH - (_f + _s) - 1;}
 
         // -----
         // clear
@@ -793,13 +2663,19 @@ class my_deque {
          * return iterator to value at the end of deque
          */
 		iterator end () {
-			return iterator(this, size());}
+			if (!_out_b)
+				return iterator();
+			const size_type j = _f + _s;
+			return iterator(_b + block_of(j), _b[block_of(j)] + slot_of(j));}
 
          /**
          * return const_iterator to the end of deque
          */
 		const_iterator end () const {
-			return const_iterator(this, size());}
+			if (!_out_b)
+				return const_iterator();
+			const size_type j = _f + _s;
+			return const_iterator(_b + block_of(j), _b[block_of(j)] + slot_of(j));}
 
         // -----
         // erase
@@ -808,17 +2684,76 @@ class my_deque {
         /**
          * @param iterator a iterator
          * remove value at iterator location from deque
-         * every element will move forward
-         * return next loation of iterator
+         * the elements on the shorter side of it move one slot toward it
+         * return iterator to the element that followed it
          */
 		iterator erase (iterator p) {
-			if(p == end() - 1)
+			typename S::stat_timer t(*this, deque_op::erase);
+			const difference_type i = p - begin();
+			if (p == end() - 1)
 				pop_back();
-			else {
-				std::copy(p+1, end(), p);
-				resize(size()-1);}
+			else if (i == 0)
+				pop_front();
+			else
+				erase_shift(p, relocatable());
+			assert(valid());
+			return begin() + i;}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * remove [b, e) from the deque, shifting the shorter side over them in one pass
+         * return iterator to the element that followed the erased ones
+         */
+		iterator erase (iterator b, iterator e) {
+			typename S::stat_timer t(*this, deque_op::erase);
+			const difference_type i = b - begin();
+			if (e == end())
+				pop_back_n(e - b);
+			else if (b == begin())
+				pop_front_n(e - b);
+			else if (b != e)
+				erase_range(b, e, relocatable());
 			assert(valid());
-			return iterator(this);}
+			return begin() + i;}
+
+        // ----------------
+        // for_each_segment
+        // ----------------
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * @param f a function taking a deque_span<T>
+         * call f once per contiguous piece of [b, e), in order, e.g. to memcpy, checksum or vectorize a block at a time
+         * return f
+         */
+		template <typename F>
+		F for_each_segment (iterator b, iterator e, F f) {
+			const segment_range<pointer> r = segments(b, e);
+			for (typename segment_range<pointer>::iterator i = r.begin(); i != r.end(); ++i)
+				f(*i);
+			return f;}
+
+		template <typename F>
+		F for_each_segment (const_iterator b, const_iterator e, F f) const {
+			const segment_range<const_pointer> r = segments(b, e);
+			for (typename segment_range<const_pointer>::iterator i = r.begin(); i != r.end(); ++i)
+				f(*i);
+			return f;}
+
+        /**
+         * @param f a function taking a deque_span<T>
+         * call f once per contiguous piece of the deque, in order
+         * return f
+         */
+		template <typename F>
+		F for_each_segment (F f) {
+			return for_each_segment(begin(), end(), f);}
+
+		template <typename F>
+		F for_each_segment (F f) const {
+			return for_each_segment(begin(), end(), f);}
 
         // -----
         // front
@@ -828,8 +2763,8 @@ class my_deque {
          * return reference to value at the front of the deque
          */
 		reference front () {
-			// <your code>
-			return *(_uf);}
+			assert(! empty());
+			return (*this)[0];}
 
         /**
          * return const_reference to value at the front of the deque
@@ -837,6 +2772,34 @@ class my_deque {
 		const_reference front () const {
 			return const_cast<my_deque*>(this)->front();}
 
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * @param p an iterator
+         * @param args the arguments for value_type's constructor
+         * construct a value in front of p
+         * push the elements on the shorter side of p away from it, moving them
+         * or relocating them with memmove when value_type is trivially relocatable
+         * return iterator to where the value is
+         */
+		template <typename... Args>
+		iterator emplace (iterator p, Args&&... args) {
+			typename S::stat_timer t(*this, deque_op::insert);
+			if (p == end()) {
+				emplace_back(std::forward<Args>(args)...);
+				p = end() - 1;}
+			else if (p == begin()) {
+				emplace_front(std::forward<Args>(args)...);
+				p = begin();}
+			else {
+				const difference_type i = p - begin();
+				value_type x(std::forward<Args>(args)...);
+				p = insert_shift(i, std::move(x), relocatable());}
+			assert(valid());
+			return p;}
+
         // ------
         // insert
         // ------
@@ -845,22 +2808,88 @@ class my_deque {
          * @param iterator an iterator
          * @param const_reference
          * insert value at given position
-         * push the remaining elements backward in the deque
+         * push the elements on the shorter side of it away from it
          * return iterator to where the value is
          */
 		iterator insert (iterator p, const_reference v) {
-			if(p == end())
-				push_back(v);
-			else {
-				resize(size()+1);
-				iterator it = end();
-                while(it != p-1){
-                    *it = *(it-1);
-                    it--; 
-                }
-                *p = v;}
+			return emplace(p, v);}
+
+        /**
+         * @param iterator an iterator
+         * @param v a value_type rvalue reference
+         * insert value at given position by moving it in
+         * return iterator to where the value is
+         */
+		iterator insert (iterator p, value_type&& v) {
+			return emplace(p, std::move(v));}
+
+        /**
+         * @param p an iterator
+         * @param n a size_type
+         * @param v a const_reference
+         * insert n copies of v in front of p, growing once and shifting the shorter side once
+         * return iterator to the first inserted value
+         */
+		iterator insert (iterator p, size_type n, const_reference v) {
+			typename S::stat_timer t(*this, deque_op::insert);
+			const difference_type i = p - begin();
+			if (n != 0) {
+				const value_type x(v);
+				if (i == 0) {
+					grow_front(n);
+					try {
+						uninitialized_fill_blocks(begin(), begin() + n, x);}
+					catch (...) {
+						drop_front(n);
+						throw;}}
+				else
+					insert_fill(i, n, x, relocatable());}
+			assert(valid());
+			return begin() + i;}
+
+        /**
+         * @param p an iterator
+         * @param b an input iterator
+         * @param e an input iterator
+         * insert [b, e) in front of p
+         * with forward iterators it grows once and shifts the shorter side once
+         * return iterator to the first inserted value
+         */
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value, iterator>::type insert (iterator p, II b, II e) {
+			typename S::stat_timer t(*this, deque_op::insert);
+			const difference_type i = p - begin();
+			if (i == 0)
+				prepend_range(b, e);
+			else if (p == end())
+				append_range(b, e);
+			else
+				insert_range(i, b, e, typename std::iterator_traits<II>::iterator_category(), relocatable());
 			assert(valid());
-			return iterator(this);}
+			return begin() + i;}
+
+        // ----
+        // load
+        // ----
+
+        /**
+         * @param in an istream, positioned at a snapshot written by save
+         * replace the elements with the snapshot's, read straight into blocks allocated for exactly that many
+         * throws runtime_error, leaving the deque empty, when in does not hold a whole snapshot of this T
+         */
+		void load (std::istream& in) {
+			static_assert(std::is_trivially_copyable<T>::value, "my_deque::load: T must be trivially copyable");
+			deque_snapshot_header h;
+			if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)))
+				throw std::runtime_error("deque snapshot: short header");
+			const size_type n = h.check(sizeof(T));
+			clear();
+			const size_type k = write_spans(n, [&in] (deque_span<T> s) {
+				in.read(reinterpret_cast<char*>(s.data()), s.size_bytes());
+				return size_type(in.gcount()) / sizeof(T);});
+			if (k != n) {
+				clear();
+				throw std::runtime_error("deque snapshot: short data");}}
 
         // ---
         // pop
@@ -868,18 +2897,107 @@ class my_deque {
 
         /**
          * remove element of the back of the deque
+         * the last block is released once it no longer holds end()
          */
 		void pop_back () {
+			typename S::stat_timer t(*this, deque_op::pop_back);
 			assert(!empty());
-			resize(size() - 1);
+			_a.destroy(&back());
+			drop_back();
 			assert(valid());}
         
         /**
          * remove element of the front of the deque
+         * the first block is released once it is emptied
          */
 		void pop_front () {
-			destroy(_a, begin(), begin()+1);
-			++_uf;
+			typename S::stat_timer t(*this, deque_op::pop_front);
+			assert(!empty());
+			_a.destroy(&front());
+			drop_front();
+			assert(valid());}
+
+        /**
+         * @param n a size_type
+         * remove the last n elements, destroying them a block at a time
+         */
+		void pop_back_n (size_type n) {
+			typename S::stat_timer t(*this, deque_op::pop_back);
+			assert(n <= size());
+			if (n != 0) {
+				destroy_blocks(end() - n, end());
+				drop_back(n);}
+			assert(valid());}
+
+        /**
+         * @param n a size_type
+         * remove the first n elements, destroying them a block at a time
+         */
+		void pop_front_n (size_type n) {
+			typename S::stat_timer t(*this, deque_op::pop_front);
+			assert(n <= size());
+			if (n != 0) {
+				destroy_blocks(begin(), begin() + n);
+				drop_front(n);}
+			assert(valid());}
+
+        // -------------
+        // prepend_range
+        // -------------
+
+        /**
+         * @param b an input iterator
+         * @param e an input iterator
+         * add [b, e) at the front of the deque, keeping its order
+         * with forward iterators the blocks are allocated once and no element is moved
+         */
+		template <typename II>
+		void prepend_range (II b, II e) {
+			prepend_range(b, e, typename std::iterator_traits<II>::iterator_category());
+			assert(valid());}
+
+        /**
+         * @param r a range
+         * add the elements of r at the front of the deque, keeping their order
+         */
+		template <typename R>
+		void prepend_range (const R& r) {
+			prepend_range(std::begin(r), std::end(r));}
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * @param args the arguments for value_type's constructor
+         * construct a value in place at the back of the deque
+         * never moves existing elements, at most a new block is linked in after the last one
+         */
+		template <typename... Args>
+		void emplace_back (Args&&... args) {
+			typename S::stat_timer t(*this, deque_op::push_back);
+			grow_back();
+			try {
+				_a.construct(&back(), std::forward<Args>(args)...);}
+			catch (...) {
+				drop_back();
+				throw;}
+			assert(valid());}
+
+        /**
+         * @param args the arguments for value_type's constructor
+         * construct a value in place at the front of the deque
+         * never moves existing elements, at most a new block is linked in before the first one
+         */
+		template <typename... Args>
+		void emplace_front (Args&&... args) {
+			typename S::stat_timer t(*this, deque_op::push_front);
+			grow_front();
+			try {
+				_a.construct(&front(), std::forward<Args>(args)...);}
+			catch (...) {
+				drop_front();
+				throw;}
 			assert(valid());}
 
         // ----
@@ -890,18 +3008,109 @@ class my_deque {
          * add element of the back of the deque
          */
 		void push_back (const_reference v) {
-			resize(size() + 1, v);
-			assert(valid());}
+			emplace_back(v);}
+
+        /**
+         * add element of the back of the deque by moving it in
+         */
+		void push_back (value_type&& v) {
+			emplace_back(std::move(v));}
 
         /**
          * add element of the front of the deque
          */
 		void push_front (const_reference v) {
-			if (_af == _uf) {
-				resize(size() + 1);
-				pop_back();}	
-			--_uf;
-			_a.construct(&*begin(), v);	
+			emplace_front(v);}
+
+        /**
+         * add element of the front of the deque by moving it in
+         */
+		void push_front (value_type&& v) {
+			emplace_front(std::move(v));}
+
+        // ---------
+        // remove_if
+        // ---------
+
+        /**
+         * @param p a predicate taking a const_reference, called once per element, front to back
+         * remove the elements p holds for in one pass, where erase(p) in a loop would shift the tail once per element:
+         * each kept element after the first removed one is moved once toward the front,
+         * then the leftovers at the back are destroyed and the blocks they emptied released
+         * if p throws, the elements already removed are gone and the rest are kept, in order
+         * return how many elements were removed
+         */
+		template <typename P>
+		size_type remove_if (P p) {
+			typename S::stat_timer t(*this, deque_op::erase);
+			const iterator w = std::find_if(begin(), end(), p);
+			if (w == end())
+				return 0;
+			const size_type n = compact_front(w, end(), end(), p);
+			assert(valid());
+			return n;}
+
+        /**
+         * @param p a predicate taking a const_reference, called once per element, in no particular order
+         * remove the elements p holds for in one pass, as remove_if, but shift toward whichever end moves fewer:
+         * the first and the last element to remove are found from both ends, then the kept elements past the first
+         * move toward the front, or those before the last move toward the back, whichever side of them is shorter
+         * return how many elements were removed
+         */
+		template <typename P>
+		size_type remove_if_shorter (P p) {
+			typename S::stat_timer t(*this, deque_op::erase);
+			const iterator f = std::find_if(begin(), end(), p);
+			if (f == end())
+				return 0;
+			iterator l = end();
+			do
+				--l;
+			while ((l != f) && !p(*l));
+			const size_type n = (end() - l - 1 < f - begin()) ?
+				compact_front(f, l, l + 1, p) :
+				compact_back(l, f, f, p);
+			assert(valid());
+			return n;}
+
+        // -------
+        // reserve
+        // -------
+
+        /**
+         * @param n a size_type
+         * allocate spare blocks so that n push_back calls can be made without allocating
+         * pops keep this headroom until shrink_to_fit
+         */
+		void reserve_back (size_type n) {
+			if (!_out_b)
+				create_map(0);
+			const size_type c = back_capacity();
+			if (n > c) {
+				const size_type k = block_of(n - c - 1) + 1;
+				reserve_map_back(k);
+				for (size_type i = 0; i != k; ++i) {
+					*_re = acquire_block();
+					++_re;}}
+			_nb = std::max(_nb, size_type(_re - _e));
+			assert(valid());}
+
+        /**
+         * @param n a size_type
+         * allocate spare blocks so that n push_front calls can be made without allocating
+         * pops keep this headroom until shrink_to_fit
+         */
+		void reserve_front (size_type n) {
+			if (!_out_b)
+				create_map(0);
+			const size_type c = front_capacity();
+			if (n > c) {
+				const size_type k = block_of(n - c - 1) + 1;
+				reserve_map_front(k);
+				for (size_type i = 0; i != k; ++i) {
+					*(_rb - 1) = acquire_block();
+					--_rb;}}
+			_nf = std::max(_nf, size_type(_b - _rb));
 			assert(valid());}
 
         // ------
@@ -914,27 +3123,131 @@ class my_deque {
          * resize the deque to given size.
          */
 		void resize (size_type s, const_reference v = value_type()) {
-			// <your code>
-			if (s == size())
-				return;
 			if (s < size())
-				_ue = &*destroy(_a, begin() + s, end());
-			else if ((unsigned)s <= (unsigned)(_ue -_af) && (unsigned)s <= (unsigned)(_ae - _uf))
-				_ue = &*uninitialized_fill(_a, end(), begin() + s, v);
-			else {	
-				size_type capacity = std::max(s, 2 * size());
-				size_type temp1 = (capacity - s) / 2;
-				if (temp1 == 0) {
-					capacity += 3;}
-				temp1 = (capacity - s) / 2;
-				size_type temp2 = (capacity - s) % 2? temp1 + 1: temp1;
-				my_deque x(capacity, v);
-				std::copy(begin(), end(), x.begin()+temp1);
-				destroy(x._a, x.begin(), x.begin()+temp1);
-				destroy(x._a, x.end()-temp2, x.end());
-				x._uf += temp1;
-				x._ue -= temp2;
-				swap(x);}
+				pop_back_n(size() - s);
+			else if (s > size())
+				insert(end(), s - size(), v);
+			assert(valid());}
+
+        // ----
+        // save
+        // ----
+
+        /**
+         * @param out an ostream
+         * write a deque_snapshot_header, then the elements a block at a time, for load or a my_deque_snapshot to read
+         * throws runtime_error when out fails
+         */
+		void save (std::ostream& out) const {
+			static_assert(std::is_trivially_copyable<T>::value, "my_deque::save: T must be trivially copyable");
+			const deque_snapshot_header h = deque_snapshot_header::make(sizeof(T), size());
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+			for_each_segment([&out] (deque_span<const T> s) {
+				out.write(reinterpret_cast<const char*>(s.data()), s.size_bytes());});
+			if (!out)
+				throw std::runtime_error("deque snapshot: write failed");}
+
+        // --------
+        // segments
+        // --------
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * return the contiguous pieces of [b, e) as a range of deque_span<T>, at most one per block
+         * the spans stay valid as long as b and e would
+         */
+		segment_range<pointer> segments (iterator b, iterator e) {
+			return segment_range<pointer>(b._node, b._cur, e._node, e._cur);}
+
+		segment_range<const_pointer> segments (const_iterator b, const_iterator e) const {
+			return segment_range<const_pointer>(b._node, b._cur, e._node, e._cur);}
+
+        /**
+         * return the contiguous pieces of the deque as a range of deque_span<T>
+         */
+		segment_range<pointer> segments () {
+			return segments(begin(), end());}
+
+		segment_range<const_pointer> segments () const {
+			return segments(begin(), end());}
+
+        // ---------------
+        // set_block_cache
+        // ---------------
+
+        /**
+         * @param n a size_type
+         * keep at most n released blocks for reuse, releasing any beyond that
+         * a deque that swings between near empty and n blocks full then makes no allocator calls
+         */
+		void set_block_cache (size_type n) {
+			_c._limit = n;
+			trim_cache(n);}
+
+        // --------------
+        // set_block_pool
+        // --------------
+
+        /**
+         * @param p a my_block_pool with block_width() and an allocator equal to this one, or 0
+         * blocks past the block cache limit go to p, and blocks come from p when the cache is empty
+         * p must outlive this deque or be detached with set_block_pool(0) first
+         */
+		void set_block_pool (my_block_pool<T, A>* p) {
+			assert(!p || ((p->width() == WIDTH) && (p->get_allocator() == _a)));
+			_c._pool = p;}
+
+        // -----------------
+        // thread_block_pool
+        // -----------------
+
+        /**
+         * return an unshared pool private to the calling thread, which keeps up to 64 blocks
+         * a deque using it must only push and pop on that thread, and be gone before the thread ends
+         */
+		static my_block_pool<T, A>& thread_block_pool () {
+			static thread_local my_block_pool<T, A> p(WIDTH, 64, false);
+			return p;}
+
+        // -------------
+        // shrink_to_fit
+        // -------------
+
+        /**
+         * release the spare and cached blocks, drop the reserved headroom and trim the block map to the blocks in use
+         * released blocks go to the block pool if there is one
+         * an empty deque gives back everything
+         */
+		void shrink_to_fit () {
+			if (!_out_b) {
+				trim_cache(0);
+				return;}
+			_nf = _nb = 0;
+			if (empty()) {
+				destroy_map();
+				trim_cache(0);
+				return;}
+			while (_rb != _b) {
+				release_block(*_rb);
+				++_rb;}
+			while (_re != _e) {
+				--_re;
+				release_block(*_re);}
+			trim_cache(0);
+			const size_type nodes = _e - _b;
+			const size_type n     = nodes + 2;
+			if (size_type(_out_e - _out_b) > n) {
+				pointer2 m = _a2.allocate(n);
+				this->stat_allocate(n * sizeof(T*));
+				this->stat_relocate();
+				std::copy(_b, _e, m + 1);
+				_a2.deallocate(_out_b, _out_e - _out_b);
+				this->stat_deallocate((_out_e - _out_b) * sizeof(T*));
+				_out_b = m;
+				_out_e = m + n;
+				_rb = _b = m + 1;
+				_e = _re = _b + nodes;}
 			assert(valid());}
 
         // ----
@@ -945,7 +3258,21 @@ class my_deque {
          * reutrn size of deque
          */
 		size_type size () const {
-			return _ue - _uf;}
+			return _s;}
+
+        // -----
+        // stats
+        // -----
+
+        /**
+         * return the stats policy, e.g. stats().allocations() or stats().dump(std::cout) with deque_stats<>
+         * the stats stay with this deque, copies, moves and swaps do not carry them
+         */
+		const stats_type& stats () const {
+			return *this;}
+
+		stats_type& stats () {
+			return *this;}
 
         // ----
         // swap
@@ -957,15 +3284,5116 @@ class my_deque {
          */
 		void swap (my_deque& that) {
 			if (_a == that._a) {
-				std::swap(_af, that._af);
-				std::swap(_uf, that._uf);
-				std::swap(_ue, that._ue);
-				std::swap(_ae, that._ae);}
-			else {
-				my_deque x(*this);
-				*this = that;
-				that = x;}
-			assert(valid());}};
+				std::swap(_out_b, that._out_b);
+				std::swap(_out_e, that._out_e);
+				std::swap(_rb, that._rb);
+				std::swap(_b, that._b);
+				std::swap(_e, that._e);
+				std::swap(_re, that._re);
+				std::swap(_f, that._f);
+				std::swap(_s, that._s);
+				std::swap(_nf, that._nf);
+				std::swap(_nb, that._nb);
+				std::swap(_c, that._c);}
+			else {
+				my_deque x(std::move(*this));
+				*this = std::move(that);
+				that = std::move(x);}
+			assert(valid());}
+
+        // -----------
+        // write_spans
+        // -----------
+
+        /**
+         * @param n a size_type
+         * @param f a function taking a deque_span<T> of raw slots and returning how many of them it constructed
+         * let a producer fill up to n slots at the back in place, a block at a time, e.g. with memcpy or read
+         * f is handed the raw slots after end() in order and must construct a prefix of each span,
+         * placement new or, for a trivially copyable T, writing the bytes; it stops early by returning less than size()
+         * what f constructed belongs to the deque even if a later call throws
+         * return the number of elements appended
+         */
+		template <typename F>
+		size_type write_spans (size_type n, F f) {
+			typename S::stat_timer t(*this, deque_op::push_back);
+			if (!n)
+				return 0;
+			const size_type s = _s;
+			grow_back(n);
+			size_type k = 0;
+			try {
+				while (k != n) {
+					const size_type j = _f + s + k;
+					const size_type m = std::min(WIDTH - slot_of(j), n - k);
+					const size_type w = f(deque_span<value_type>(_b[block_of(j)] + slot_of(j), m));
+					assert(w <= m);
+					k += w;
+					if (w != m)
+						break;}}
+			catch (...) {
+				drop_back(n - k);
+				throw;}
+			drop_back(n - k);
+			assert(valid());
+			return k;}};
+
+template <typename T, typename A, typename G, typename S>
+const typename my_deque<T, A, G, S>::size_type my_deque<T, A, G, S>::WIDTH;
+
+template <typename T, typename A, typename G, typename S>
+const bool my_deque<T, A, G, S>::POW2;
+
+template <typename T, typename A, typename G, typename S>
+const typename my_deque<T, A, G, S>::size_type my_deque<T, A, G, S>::SHIFT;
+
+template <typename T, typename A, typename G, typename S>
+const typename my_deque<T, A, G, S>::size_type my_deque<T, A, G, S>::BLOCK_CACHE;
+
+/**
+ * @param d a my_deque
+ * @param p a predicate
+ * remove the elements of d that p holds for, in one pass, see my_deque::remove_if
+ * return how many elements were removed
+ */
+template <typename T, typename A, typename G, typename S, typename P>
+typename my_deque<T, A, G, S>::size_type erase_if (my_deque<T, A, G, S>& d, P p) {
+	return d.remove_if(p);}
+
+// ----------
+// deque_simd
+// ----------
+
+/**
+ * the instruction set deque_kernels use, detected once from the CPU
+ * set_level lowers it, to compare paths in tests and benchmarks; it never goes above what the CPU has
+ */
+struct deque_simd {
+	enum level {scalar, sse2, avx2};
+
+	static level detect () {
+#ifdef DEQUE_SIMD_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return avx2;
+		return sse2;
+#else
+		return scalar;
+#endif
+		}
+
+	static level active () {
+		return level(current().load(std::memory_order_relaxed));}
+
+        /**
+         * @param l a level
+         * use at most l from now on
+         * return the level actually in use
+         */
+	static level set_level (level l) {
+		const level c = std::min(l, detect());
+		current().store(c, std::memory_order_relaxed);
+		return c;}
+
+	static const char* name (level l) {
+		static const char* const names[] = {"scalar", "sse2", "avx2"};
+		return names[l];}
+
+	private:
+		static std::atomic<int>& current () {
+			static std::atomic<int> l(detect());
+			return l;}};
+
+// -------------
+// deque_kernels
+// -------------
+
+/**
+ * the loops the deque_sum family runs over one contiguous segment, plain C++ for any arithmetic T
+ * min and max want n > 0, find returns n when v is missing
+ */
+template <typename T>
+struct deque_scalar_kernels {
+	static T sum (deque_simd::level, const T* p, std::size_t n, T s) {
+		for (std::size_t i = 0; i != n; ++i)
+			s += p[i];
+		return s;}
+
+	static T min (deque_simd::level, const T* p, std::size_t n) {
+		T m = p[0];
+		for (std::size_t i = 1; i != n; ++i)
+			if (p[i] < m)
+				m = p[i];
+		return m;}
+
+	static T max (deque_simd::level, const T* p, std::size_t n) {
+		T m = p[0];
+		for (std::size_t i = 1; i != n; ++i)
+			if (m < p[i])
+				m = p[i];
+		return m;}
+
+	static std::size_t find (deque_simd::level, const T* p, std::size_t n, T v) {
+		std::size_t i = 0;
+		while ((i != n) && !(p[i] == v))
+			++i;
+		return i;}
+
+	static std::size_t count (deque_simd::level, const T* p, std::size_t n, T v) {
+		std::size_t c = 0;
+		for (std::size_t i = 0; i != n; ++i)
+			c += (p[i] == v);
+		return c;}
+
+        /**
+         * y[i] = a * x[i] + y[i]
+         */
+	static void axpy (deque_simd::level, T a, const T* x, T* y, std::size_t n) {
+		for (std::size_t i = 0; i != n; ++i)
+			y[i] = a * x[i] + y[i];}};
+
+/**
+ * deque_scalar_kernels picked by the level passed in
+ * deque_kernels<double> and deque_kernels<int> add SSE2 and AVX2 versions, other types stay scalar
+ */
+template <typename T>
+struct deque_kernels : deque_scalar_kernels<T> {};
+
+#ifdef DEQUE_SIMD_X86
+/**
+ * doubles, four per AVX2 step and two per SSE2 step
+ * sum adds in lanes, so it can round differently from std::accumulate; min and max leave NaN unspecified
+ */
+template <>
+struct deque_kernels<double> : deque_scalar_kernels<double> {
+	typedef deque_scalar_kernels<double> scalar_kernels;
+
+	// ----
+	// AVX2
+	// ----
+
+	__attribute__((target("avx2")))
+	static double hsum (__m256d a) {
+		const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+		return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));}
+
+	__attribute__((target("avx2")))
+	static double sum_avx2 (const double* p, std::size_t n, double s) {
+		__m256d a = _mm256_setzero_pd();
+		__m256d b = _mm256_setzero_pd();
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			a = _mm256_add_pd(a, _mm256_loadu_pd(p + i));
+			b = _mm256_add_pd(b, _mm256_loadu_pd(p + i + 4));}
+		if (i + 4 <= n) {
+			a = _mm256_add_pd(a, _mm256_loadu_pd(p + i));
+			i += 4;}
+		s += hsum(_mm256_add_pd(a, b));
+		for (; i != n; ++i)
+			s += p[i];
+		return s;}
+
+	__attribute__((target("avx2")))
+	static double min_avx2 (const double* p, std::size_t n) {
+		__m256d m = _mm256_set1_pd(p[0]);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			m = _mm256_min_pd(m, _mm256_loadu_pd(p + i));
+		__m128d h = _mm_min_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+		double r = _mm_cvtsd_f64(_mm_min_sd(h, _mm_unpackhi_pd(h, h)));
+		for (; i != n; ++i)
+			r = (p[i] < r) ? p[i] : r;
+		return r;}
+
+	__attribute__((target("avx2")))
+	static double max_avx2 (const double* p, std::size_t n) {
+		__m256d m = _mm256_set1_pd(p[0]);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			m = _mm256_max_pd(m, _mm256_loadu_pd(p + i));
+		__m128d h = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+		double r = _mm_cvtsd_f64(_mm_max_sd(h, _mm_unpackhi_pd(h, h)));
+		for (; i != n; ++i)
+			r = (r < p[i]) ? p[i] : r;
+		return r;}
+
+	__attribute__((target("avx2")))
+	static std::size_t find_avx2 (const double* p, std::size_t n, double v) {
+		const __m256d w = _mm256_set1_pd(v);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const int k = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(p + i), w, _CMP_EQ_OQ));
+			if (k)
+				return i + __builtin_ctz(k);}
+		while ((i != n) && !(p[i] == v))
+			++i;
+		return i;}
+
+	__attribute__((target("avx2")))
+	static std::size_t count_avx2 (const double* p, std::size_t n, double v) {
+		const __m256d w = _mm256_set1_pd(v);
+		__m256i c = _mm256_setzero_si256();
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			c = _mm256_sub_epi64(c, _mm256_castpd_si256(_mm256_cmp_pd(_mm256_loadu_pd(p + i), w, _CMP_EQ_OQ)));
+		long long l[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(l), c);
+		std::size_t r = l[0] + l[1] + l[2] + l[3];
+		for (; i != n; ++i)
+			r += (p[i] == v);
+		return r;}
+
+	__attribute__((target("avx2")))
+	static void axpy_avx2 (double a, const double* x, double* y, std::size_t n) {
+		const __m256d w = _mm256_set1_pd(a);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			_mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_mul_pd(w, _mm256_loadu_pd(x + i)), _mm256_loadu_pd(y + i)));
+		for (; i != n; ++i)
+			y[i] = a * x[i] + y[i];}
+
+	// ----
+	// SSE2
+	// ----
+
+	static double sum_sse2 (const double* p, std::size_t n, double s) {
+		__m128d a = _mm_setzero_pd();
+		__m128d b = _mm_setzero_pd();
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			a = _mm_add_pd(a, _mm_loadu_pd(p + i));
+			b = _mm_add_pd(b, _mm_loadu_pd(p + i + 2));}
+		a = _mm_add_pd(a, b);
+		s += _mm_cvtsd_f64(_mm_add_sd(a, _mm_unpackhi_pd(a, a)));
+		for (; i != n; ++i)
+			s += p[i];
+		return s;}
+
+	static double min_sse2 (const double* p, std::size_t n) {
+		__m128d m = _mm_set1_pd(p[0]);
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+			m = _mm_min_pd(m, _mm_loadu_pd(p + i));
+		double r = _mm_cvtsd_f64(_mm_min_sd(m, _mm_unpackhi_pd(m, m)));
+		if (i != n)
+			r = (p[i] < r) ? p[i] : r;
+		return r;}
+
+	static double max_sse2 (const double* p, std::size_t n) {
+		__m128d m = _mm_set1_pd(p[0]);
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+			m = _mm_max_pd(m, _mm_loadu_pd(p + i));
+		double r = _mm_cvtsd_f64(_mm_max_sd(m, _mm_unpackhi_pd(m, m)));
+		if (i != n)
+			r = (r < p[i]) ? p[i] : r;
+		return r;}
+
+	static std::size_t find_sse2 (const double* p, std::size_t n, double v) {
+		const __m128d w = _mm_set1_pd(v);
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2) {
+			const int k = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(p + i), w));
+			if (k)
+				return i + __builtin_ctz(k);}
+		if ((i != n) && !(p[i] == v))
+			++i;
+		return i;}
+
+	static std::size_t count_sse2 (const double* p, std::size_t n, double v) {
+		const __m128d w = _mm_set1_pd(v);
+		__m128i c = _mm_setzero_si128();
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+			c = _mm_sub_epi64(c, _mm_castpd_si128(_mm_cmpeq_pd(_mm_loadu_pd(p + i), w)));
+		long long l[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(l), c);
+		std::size_t r = l[0] + l[1];
+		if (i != n)
+			r += (p[i] == v);
+		return r;}
+
+	static void axpy_sse2 (double a, const double* x, double* y, std::size_t n) {
+		const __m128d w = _mm_set1_pd(a);
+		std::size_t i = 0;
+		for (; i + 2 <= n; i += 2)
+			_mm_storeu_pd(y + i, _mm_add_pd(_mm_mul_pd(w, _mm_loadu_pd(x + i)), _mm_loadu_pd(y + i)));
+		if (i != n)
+			y[i] = a * x[i] + y[i];}
+
+	// --------
+	// dispatch
+	// --------
+
+	static double sum (deque_simd::level l, const double* p, std::size_t n, double s) {
+		switch (l) {
+			case deque_simd::avx2: return sum_avx2(p, n, s);
+			case deque_simd::sse2: return sum_sse2(p, n, s);
+			default:               return scalar_kernels::sum(l, p, n, s);}}
+
+	static double min (deque_simd::level l, const double* p, std::size_t n) {
+		switch (l) {
+			case deque_simd::avx2: return min_avx2(p, n);
+			case deque_simd::sse2: return min_sse2(p, n);
+			default:               return scalar_kernels::min(l, p, n);}}
+
+	static double max (deque_simd::level l, const double* p, std::size_t n) {
+		switch (l) {
+			case deque_simd::avx2: return max_avx2(p, n);
+			case deque_simd::sse2: return max_sse2(p, n);
+			default:               return scalar_kernels::max(l, p, n);}}
+
+	static std::size_t find (deque_simd::level l, const double* p, std::size_t n, double v) {
+		switch (l) {
+			case deque_simd::avx2: return find_avx2(p, n, v);
+			case deque_simd::sse2: return find_sse2(p, n, v);
+			default:               return scalar_kernels::find(l, p, n, v);}}
+
+	static std::size_t count (deque_simd::level l, const double* p, std::size_t n, double v) {
+		switch (l) {
+			case deque_simd::avx2: return count_avx2(p, n, v);
+			case deque_simd::sse2: return count_sse2(p, n, v);
+			default:               return scalar_kernels::count(l, p, n, v);}}
+
+	static void axpy (deque_simd::level l, double a, const double* x, double* y, std::size_t n) {
+		switch (l) {
+			case deque_simd::avx2: axpy_avx2(a, x, y, n); break;
+			case deque_simd::sse2: axpy_sse2(a, x, y, n); break;
+			default:               scalar_kernels::axpy(l, a, x, y, n);}}};
+
+/**
+ * ints, eight per AVX2 step and four per SSE2 step
+ * sum wraps like the lanes do; SSE2 has no 32 bit multiply, so axpy there stays scalar
+ */
+template <>
+struct deque_kernels<int> : deque_scalar_kernels<int> {
+	typedef deque_scalar_kernels<int> scalar_kernels;
+
+	// ----
+	// AVX2
+	// ----
+
+	__attribute__((target("avx2")))
+	static int hsum (__m256i a) {
+		__m128i h = _mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(h);}
+
+	__attribute__((target("avx2")))
+	static int sum_avx2 (const int* p, std::size_t n, int s) {
+		__m256i a = _mm256_setzero_si256();
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			a = _mm256_add_epi32(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+		unsigned r = unsigned(s) + unsigned(hsum(a));
+		for (; i != n; ++i)
+			r += unsigned(p[i]);
+		return int(r);}
+
+	__attribute__((target("avx2")))
+	static int min_avx2 (const int* p, std::size_t n) {
+		__m256i m = _mm256_set1_epi32(p[0]);
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			m = _mm256_min_epi32(m, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+		int l[8];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(l), m);
+		int r = *std::min_element(l, l + 8);
+		for (; i != n; ++i)
+			r = std::min(r, p[i]);
+		return r;}
+
+	__attribute__((target("avx2")))
+	static int max_avx2 (const int* p, std::size_t n) {
+		__m256i m = _mm256_set1_epi32(p[0]);
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			m = _mm256_max_epi32(m, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+		int l[8];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(l), m);
+		int r = *std::max_element(l, l + 8);
+		for (; i != n; ++i)
+			r = std::max(r, p[i]);
+		return r;}
+
+	__attribute__((target("avx2")))
+	static std::size_t find_avx2 (const int* p, std::size_t n, int v) {
+		const __m256i w = _mm256_set1_epi32(v);
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			const __m256i c = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), w);
+			const int k = _mm256_movemask_ps(_mm256_castsi256_ps(c));
+			if (k)
+				return i + __builtin_ctz(k);}
+		while ((i != n) && (p[i] != v))
+			++i;
+		return i;}
+
+	__attribute__((target("avx2")))
+	static std::size_t count_avx2 (const int* p, std::size_t n, int v) {
+		const __m256i w = _mm256_set1_epi32(v);
+		__m256i c = _mm256_setzero_si256();
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8)
+			c = _mm256_sub_epi32(c, _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), w));
+		std::size_t r = unsigned(hsum(c));
+		for (; i != n; ++i)
+			r += (p[i] == v);
+		return r;}
+
+	__attribute__((target("avx2")))
+	static void axpy_avx2 (int a, const int* x, int* y, std::size_t n) {
+		const __m256i w = _mm256_set1_epi32(a);
+		std::size_t i = 0;
+		for (; i + 8 <= n; i += 8) {
+			const __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(y + i), _mm256_add_epi32(_mm256_mullo_epi32(w, u), v));}
+		for (; i != n; ++i)
+			y[i] = a * x[i] + y[i];}
+
+	// ----
+	// SSE2
+	// ----
+
+	static int hsum (__m128i h) {
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(h);}
+
+	static int sum_sse2 (const int* p, std::size_t n, int s) {
+		__m128i a = _mm_setzero_si128();
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			a = _mm_add_epi32(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+		unsigned r = unsigned(s) + unsigned(hsum(a));
+		for (; i != n; ++i)
+			r += unsigned(p[i]);
+		return int(r);}
+
+	/**
+	 * SSE2 has no pminsd/pmaxsd, so min and max select through a compare mask
+	 */
+	static int min_sse2 (const int* p, std::size_t n) {
+		__m128i m = _mm_set1_epi32(p[0]);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			const __m128i k = _mm_cmplt_epi32(v, m);
+			m = _mm_or_si128(_mm_and_si128(k, v), _mm_andnot_si128(k, m));}
+		int l[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(l), m);
+		int r = *std::min_element(l, l + 4);
+		for (; i != n; ++i)
+			r = std::min(r, p[i]);
+		return r;}
+
+	static int max_sse2 (const int* p, std::size_t n) {
+		__m128i m = _mm_set1_epi32(p[0]);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+			const __m128i k = _mm_cmpgt_epi32(v, m);
+			m = _mm_or_si128(_mm_and_si128(k, v), _mm_andnot_si128(k, m));}
+		int l[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(l), m);
+		int r = *std::max_element(l, l + 4);
+		for (; i != n; ++i)
+			r = std::max(r, p[i]);
+		return r;}
+
+	static std::size_t find_sse2 (const int* p, std::size_t n, int v) {
+		const __m128i w = _mm_set1_epi32(v);
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			const __m128i c = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), w);
+			const int k = _mm_movemask_ps(_mm_castsi128_ps(c));
+			if (k)
+				return i + __builtin_ctz(k);}
+		while ((i != n) && (p[i] != v))
+			++i;
+		return i;}
+
+	static std::size_t count_sse2 (const int* p, std::size_t n, int v) {
+		const __m128i w = _mm_set1_epi32(v);
+		__m128i c = _mm_setzero_si128();
+		std::size_t i = 0;
+		for (; i + 4 <= n; i += 4)
+			c = _mm_sub_epi32(c, _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), w));
+		std::size_t r = unsigned(hsum(c));
+		for (; i != n; ++i)
+			r += (p[i] == v);
+		return r;}
+
+	// --------
+	// dispatch
+	// --------
+
+	static int sum (deque_simd::level l, const int* p, std::size_t n, int s) {
+		switch (l) {
+			case deque_simd::avx2: return sum_avx2(p, n, s);
+			case deque_simd::sse2: return sum_sse2(p, n, s);
+			default:               return scalar_kernels::sum(l, p, n, s);}}
+
+	static int min (deque_simd::level l, const int* p, std::size_t n) {
+		switch (l) {
+			case deque_simd::avx2: return min_avx2(p, n);
+			case deque_simd::sse2: return min_sse2(p, n);
+			default:               return scalar_kernels::min(l, p, n);}}
+
+	static int max (deque_simd::level l, const int* p, std::size_t n) {
+		switch (l) {
+			case deque_simd::avx2: return max_avx2(p, n);
+			case deque_simd::sse2: return max_sse2(p, n);
+			default:               return scalar_kernels::max(l, p, n);}}
+
+	static std::size_t find (deque_simd::level l, const int* p, std::size_t n, int v) {
+		switch (l) {
+			case deque_simd::avx2: return find_avx2(p, n, v);
+			case deque_simd::sse2: return find_sse2(p, n, v);
+			default:               return scalar_kernels::find(l, p, n, v);}}
+
+	static std::size_t count (deque_simd::level l, const int* p, std::size_t n, int v) {
+		switch (l) {
+			case deque_simd::avx2: return count_avx2(p, n, v);
+			case deque_simd::sse2: return count_sse2(p, n, v);
+			default:               return scalar_kernels::count(l, p, n, v);}}
+
+	static void axpy (deque_simd::level l, int a, const int* x, int* y, std::size_t n) {
+		if (l == deque_simd::avx2)
+			axpy_avx2(a, x, y, n);
+		else
+			scalar_kernels::axpy(l, a, x, y, n);}};
+#endif
+
+// ---------------
+// deque numerics
+// ---------------
+
+/**
+ * the functions below run deque_kernels over each contiguous segment of a container with segments(b, e),
+ * such as my_deque, so a block at a time is summed, searched or scaled with the widest instructions the CPU has
+ */
+
+/**
+ * @param d a container
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * return the sum of [b, e), value_type() when empty
+ */
+template <typename D>
+typename D::value_type deque_sum (const D& d, typename D::const_iterator b, typename D::const_iterator e) {
+	typedef typename D::value_type T;
+	const deque_simd::level l = deque_simd::active();
+	T s = T();
+	d.for_each_segment(b, e, [&] (deque_span<const T> x) {
+		s = deque_kernels<T>::sum(l, x.data(), x.size(), s);});
+	return s;}
+
+template <typename D>
+typename D::value_type deque_sum (const D& d) {
+	return deque_sum(d, d.begin(), d.end());}
+
+/**
+ * @param d a container
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * return the smallest and the largest value in [b, e), which must not be empty
+ */
+template <typename D>
+std::pair<typename D::value_type, typename D::value_type> deque_minmax (const D& d, typename D::const_iterator b, typename D::const_iterator e) {
+	typedef typename D::value_type T;
+	assert(b != e);
+	const deque_simd::level l = deque_simd::active();
+	std::pair<T, T> r(*b, *b);
+	d.for_each_segment(b, e, [&] (deque_span<const T> x) {
+		r.first  = std::min(r.first, deque_kernels<T>::min(l, x.data(), x.size()));
+		r.second = std::max(r.second, deque_kernels<T>::max(l, x.data(), x.size()));});
+	return r;}
+
+template <typename D>
+std::pair<typename D::value_type, typename D::value_type> deque_minmax (const D& d) {
+	return deque_minmax(d, d.begin(), d.end());}
+
+/**
+ * @param d a container
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * return the smallest value in [b, e), which must not be empty
+ */
+template <typename D>
+typename D::value_type deque_min (const D& d, typename D::const_iterator b, typename D::const_iterator e) {
+	typedef typename D::value_type T;
+	assert(b != e);
+	const deque_simd::level l = deque_simd::active();
+	T m = *b;
+	d.for_each_segment(b, e, [&] (deque_span<const T> x) {
+		m = std::min(m, deque_kernels<T>::min(l, x.data(), x.size()));});
+	return m;}
+
+template <typename D>
+typename D::value_type deque_min (const D& d) {
+	return deque_min(d, d.begin(), d.end());}
+
+/**
+ * @param d a container
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * return the largest value in [b, e), which must not be empty
+ */
+template <typename D>
+typename D::value_type deque_max (const D& d, typename D::const_iterator b, typename D::const_iterator e) {
+	typedef typename D::value_type T;
+	assert(b != e);
+	const deque_simd::level l = deque_simd::active();
+	T m = *b;
+	d.for_each_segment(b, e, [&] (deque_span<const T> x) {
+		m = std::max(m, deque_kernels<T>::max(l, x.data(), x.size()));});
+	return m;}
+
+template <typename D>
+typename D::value_type deque_max (const D& d) {
+	return deque_max(d, d.begin(), d.end());}
+
+/**
+ * @param d a container
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * @param v a value
+ * return the first position in [b, e) equal to v, or e
+ */
+template <typename D>
+typename D::const_iterator deque_find (const D& d, typename D::const_iterator b, typename D::const_iterator e, const typename D::value_type& v) {
+	typedef typename D::value_type T;
+	const deque_simd::level l = deque_simd::active();
+	const auto r = d.segments(b, e);
+	std::size_t k = 0;
+	for (auto i = r.begin(); i != r.end(); ++i) {
+		const deque_span<const T> x = *i;
+		const std::size_t j = deque_kernels<T>::find(l, x.data(), x.size(), v);
+		if (j != x.size())
+			return b + (k + j);
+		k += x.size();}
+	return e;}
+
+template <typename D>
+typename D::const_iterator deque_find (const D& d, const typename D::value_type& v) {
+	return deque_find(d, d.begin(), d.end(), v);}
+
+/**
+ * @param d a container
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * @param v a value
+ * return how many values in [b, e) equal v
+ */
+template <typename D>
+std::size_t deque_count (const D& d, typename D::const_iterator b, typename D::const_iterator e, const typename D::value_type& v) {
+	typedef typename D::value_type T;
+	const deque_simd::level l = deque_simd::active();
+	std::size_t c = 0;
+	d.for_each_segment(b, e, [&] (deque_span<const T> x) {
+		c += deque_kernels<T>::count(l, x.data(), x.size(), v);});
+	return c;}
+
+template <typename D>
+std::size_t deque_count (const D& d, const typename D::value_type& v) {
+	return deque_count(d, d.begin(), d.end(), v);}
+
+/**
+ * @param x a container
+ * @param b a const_iterator of x
+ * @param e a const_iterator of x
+ * @param y a container
+ * @param c an iterator of y, followed by at least e - b values
+ * @param f a function taking a const T* of a piece of [b, e), a T* of the matching piece after c and their length
+ * call f over both ranges a common contiguous piece at a time, in order
+ */
+template <typename D, typename F>
+void deque_zip_segments (const D& x, typename D::const_iterator b, typename D::const_iterator e, D& y, typename D::iterator c, F f) {
+	typedef typename D::value_type T;
+	const auto rx = x.segments(b, e);
+	const auto ry = y.segments(c, c + (e - b));
+	auto j = ry.begin();
+	deque_span<T> t;
+	for (auto i = rx.begin(); i != rx.end(); ++i) {
+		deque_span<const T> s = *i;
+		while (!s.empty()) {
+			if (t.empty())
+				t = *j++;
+			const std::size_t n = std::min(s.size(), t.size());
+			f(s.data(), t.data(), n);
+			s = deque_span<const T>(s.data() + n, s.size() - n);
+			t = deque_span<T>(t.data() + n, t.size() - n);}}}
+
+/**
+ * @param x a container
+ * @param y a container with at least x.size() values
+ * @param f a function taking a const T* of a piece of x, a T* of the matching piece of y and their length
+ */
+template <typename D, typename F>
+void deque_zip_segments (const D& x, D& y, F f) {
+	assert(x.size() <= y.size());
+	deque_zip_segments(x, x.begin(), x.end(), y, y.begin(), f);}
+
+/**
+ * @param d a container
+ * @param f a function from T to T
+ * replace every value v of d with f(v), a contiguous segment at a time so the compiler can vectorize f
+ */
+template <typename D, typename F>
+void deque_transform (D& d, F f) {
+	typedef typename D::value_type T;
+	d.for_each_segment([&] (deque_span<T> x) {
+		T* const p = x.data();
+		const std::size_t n = x.size();
+		for (std::size_t i = 0; i != n; ++i)
+			p[i] = f(p[i]);});}
+
+/**
+ * @param x a container
+ * @param y a container with at least x.size() values
+ * @param f a function from T to T
+ * y[i] = f(x[i]) for every i of x
+ */
+template <typename D, typename F>
+void deque_transform (const D& x, D& y, F f) {
+	deque_zip_segments(x, y, [&] (const typename D::value_type* p, typename D::value_type* q, std::size_t n) {
+		for (std::size_t i = 0; i != n; ++i)
+			q[i] = f(p[i]);});}
+
+/**
+ * @param a a value
+ * @param x a container
+ * @param y a container with at least x.size() values
+ * y[i] = a * x[i] + y[i] for every i of x
+ */
+template <typename D>
+void deque_axpy (const typename D::value_type& a, const D& x, D& y) {
+	typedef typename D::value_type T;
+	const deque_simd::level l = deque_simd::active();
+	deque_zip_segments(x, y, [&] (const T* p, T* q, std::size_t n) {
+		deque_kernels<T>::axpy(l, a, p, q, n);});}
+
+// ------------
+// ring policies
+// ------------
+
+/**
+ * push_back/push_front on a full my_ring_deque drop the element at the other end
+ */
+struct ring_overwrite {
+    static const bool overwrite = true;};
+
+/**
+ * push_back/push_front on a full my_ring_deque leave it unchanged and return false
+ */
+struct ring_reject {
+    static const bool overwrite = false;};
+
+// -------------
+// my_ring_deque
+// -------------
+
+/**
+ * a double ended queue of at most N elements in one ring buffer allocated at construction
+ * N must be a power of two so that wrapping around is a mask
+ * nothing is allocated after construction and push/pop never relocate
+ * P decides what push_back/push_front do when the ring is full, see ring_overwrite and ring_reject
+ * inserting anywhere else when full throws length_error
+ */
+template < typename T, std::size_t N, typename P = ring_reject, typename A = std::allocator<T> >
+class my_ring_deque {
+	static_assert((N != 0) && ((N & (N - 1)) == 0), "my_ring_deque: N must be a power of two");
+
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef A										 allocator_type;
+		typedef P										 policy_type;
+		typedef typename allocator_type::value_type		 value_type;	
+
+		typedef typename allocator_type::size_type		 size_type;
+		typedef typename allocator_type::difference_type difference_type;
+
+		typedef typename allocator_type::pointer		 pointer;	
+		typedef typename allocator_type::const_pointer	 const_pointer;
+
+		typedef typename allocator_type::reference		 reference;
+		typedef typename allocator_type::const_reference const_reference;
 
+	public:
+		// -----------
+        // operator ==
+        // -----------
+
+        /**
+         * @param lhs a my_ring_deque reference to the left of operator 
+         * @param rhs a my_ring_deque reference to the right of operator 
+         * return true if contents of lhs and rhs are equal, else false
+         */
+		friend bool operator == (const my_ring_deque& lhs, const my_ring_deque& rhs) {
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        // ----------
+        // operator <
+        // ----------
+
+        /**
+         * @param lhs a my_ring_deque reference to the left of operator 
+         * @param rhs a my_ring_deque reference to the right of operator         
+         * return true if rhs lexicographically greater than lhs
+         */
+		friend bool operator < (const my_ring_deque& lhs, const my_ring_deque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+	private:
+		// ----
+        // data
+        // ----
+
+		static const size_type MASK = N - 1;
+
+		allocator_type _a;
+		pointer   _p;	// the N slots of the ring
+		size_type _h;	// slot of the front element
+		size_type _s;	// number of elements
+
+	private:
+		// -----
+        // valid
+        // -----
+
+		bool valid () const {
+			return _p && (_h < N) && (_s <= N);}
+
+        /**
+         * @param i a size_type
+         * return the address of the slot i positions after the front, wrapping around
+         */
+		pointer slot (size_type i) const {
+			return _p + ((_h + i) & MASK);}
+
+        /**
+         * @param n a size_type
+         * throw length_error if n more elements do not fit
+         */
+		void check_room (size_type n) const {
+			if (n > N - _s)
+				throw std::length_error("my_ring_deque");}
+
+	public:
+		class const_iterator;
+
+		// --------
+        // iterator
+        // --------
+
+		class iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_ring_deque::value_type	  	value_type;
+				typedef typename my_ring_deque::difference_type 	difference_type;
+				typedef typename my_ring_deque::pointer	pointer;
+				typedef typename my_ring_deque::reference	reference;
+
+				friend class my_ring_deque;
+				friend class my_ring_deque::const_iterator;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const iterator& lhs, const iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._i == rhs._i);}
+
+				friend bool operator != (const iterator& lhs, const iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const iterator& lhs, const iterator& rhs) {
+					return lhs._i < rhs._i;}
+
+				friend bool operator > (const iterator& lhs, const iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const iterator& lhs, const iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const iterator& lhs, const iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend iterator operator + (iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend iterator operator + (difference_type lhs, iterator rhs) {
+					return rhs += lhs;}
+
+				friend iterator operator - (iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+					return lhs._i - rhs._i;}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				my_ring_deque* _d;	// the ring
+				difference_type _i;	// index from the front
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the ring this iterator walks
+                 * @param i the index of the element from the front
+                 */
+				iterator (my_ring_deque* d = 0, difference_type i = 0) :
+						_d(d), _i(i)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return (*_d)[_i];}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return (*_d)[_i + n];}
+
+				iterator& operator ++ () {
+					++_i;
+					return *this;}
+
+				iterator operator ++ (int) {
+					iterator x = *this;
+					++_i;
+					return x;}
+
+				iterator& operator -- () {
+					--_i;
+					return *this;}
+
+				iterator operator -- (int) {
+					iterator x = *this;
+					--_i;
+					return x;}
+
+				iterator& operator += (difference_type d) {
+					_i += d;
+					return *this;}
+
+				iterator& operator -= (difference_type d) {
+					_i -= d;
+					return *this;}};
+
+        // --------------
+        // const_iterator
+        // --------------
+
+		class const_iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_ring_deque::value_type	  	value_type;
+				typedef typename my_ring_deque::difference_type 	difference_type;
+				typedef typename my_ring_deque::const_pointer	pointer;
+				typedef typename my_ring_deque::const_reference	reference;
+
+				friend class my_ring_deque;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._i == rhs._i);}
+
+				friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._i < rhs._i;}
+
+				friend bool operator > (const const_iterator& lhs, const const_iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+					return rhs += lhs;}
+
+				friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._i - rhs._i;}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				const my_ring_deque* _d;	// the ring
+				difference_type _i;	// index from the front
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the ring this const_iterator walks
+                 * @param i the index of the element from the front
+                 */
+				const_iterator (const my_ring_deque* d = 0, difference_type i = 0) :
+						_d(d), _i(i)
+					{}
+
+                /**
+                 * @param it an iterator
+                 * convert an iterator into a const_iterator to the same element
+                 */
+				const_iterator (const iterator& it) :
+						_d(it._d), _i(it._i)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return (*_d)[_i];}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return (*_d)[_i + n];}
+
+				const_iterator& operator ++ () {
+					++_i;
+					return *this;}
+
+				const_iterator operator ++ (int) {
+					const_iterator x = *this;
+					++_i;
+					return x;}
+
+				const_iterator& operator -- () {
+					--_i;
+					return *this;}
+
+				const_iterator operator -- (int) {
+					const_iterator x = *this;
+					--_i;
+					return x;}
+
+				const_iterator& operator += (difference_type d) {
+					_i += d;
+					return *this;}
+
+				const_iterator& operator -= (difference_type d) {
+					_i -= d;
+					return *this;}};
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param a an allocator_type reference
+         * allocate the N slots of the ring, this is the only allocation it makes
+         */
+		explicit my_ring_deque (const allocator_type& a = allocator_type()) :
+				_a(a), _p(_a.allocate(N)), _h(0), _s(0) {
+			assert(valid());}
+
+        /**
+         * @param s a size_type, at most N
+         * @param v a const_reference 
+         * @param a an allocator_type reference
+         * construct a ring holding s copies of v
+         */
+		explicit my_ring_deque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) :
+				_a(a), _p(0), _h(0), _s(0) {
+			if (s > N)
+				throw std::length_error("my_ring_deque");
+			_p = _a.allocate(N);
+			try {
+				uninitialized_fill(_a, _p, _p + s, v);}
+			catch (...) {
+				_a.deallocate(_p, N);
+				throw;}
+			_s = s;
+			assert(valid());}
+
+        /**
+         * @param that a my_ring_deque reference
+         * copy constructor, the copy starts at slot 0
+         */
+		my_ring_deque (const my_ring_deque& that) :
+				_a(that._a), _p(_a.allocate(N)), _h(0), _s(0) {
+			try {
+				const size_type k = std::min(that._s, N - that._h);
+				uninitialized_copy(_a, that._p + that._h, that._p + that._h + k, _p);
+				try {
+					uninitialized_copy(_a, that._p, that._p + (that._s - k), _p + k);}
+				catch (...) {
+					destroy(_a, _p, _p + k);
+					throw;}}
+			catch (...) {
+				_a.deallocate(_p, N);
+				throw;}
+			_s = that._s;
+			assert(valid());}
+
+        /**
+         * @param that a my_ring_deque rvalue reference
+         * move constructor, takes over the slots of that and leaves it a fresh empty ring
+         */
+		my_ring_deque (my_ring_deque&& that) :
+				_a(that._a), _p(that._p), _h(that._h), _s(that._s) {
+			that._p = that._a.allocate(N);
+			that._h = that._s = 0;
+			assert(valid());}
+
+        // ----------
+        // destructor
+        // ----------
+
+		~my_ring_deque () {
+			clear();
+			_a.deallocate(_p, N);}
+
+        // ----------
+        // operator =
+        // ----------
+
+        /**
+         * @param rhs a my_ring_deque reference
+         * copy assignment, never allocates
+         */
+		my_ring_deque& operator = (const my_ring_deque& rhs) {
+			if (this != &rhs)
+				assign(rhs.begin(), rhs.end());
+			return *this;}
+
+        /**
+         * @param rhs a my_ring_deque rvalue reference
+         * move assignment, swaps the slots when the allocators compare equal
+         */
+		my_ring_deque& operator = (my_ring_deque&& rhs) {
+			if (this != &rhs) {
+				if (_a == rhs._a) {
+					clear();
+					swap(rhs);}
+				else
+					assign(std::make_move_iterator(rhs.begin()), std::make_move_iterator(rhs.end()));}
+			return *this;}
+
+        // -----------
+        // operator []
+        // -----------
+
+		reference operator [] (size_type n) {
+			return *slot(n);}
+
+		const_reference operator [] (size_type n) const {
+			return *slot(n);}
+
+        // --
+        // at
+        // --
+
+		reference at (size_type n) {
+			if (n >= size())
+				throw std::out_of_range("my_ring_deque");
+			return (*this)[n];}
+
+		const_reference at (size_type n) const {
+			if (n >= size())
+				throw std::out_of_range("my_ring_deque");
+			return (*this)[n];}
+
+        // ------
+        // assign
+        // ------
+
+        /**
+         * @param b an input iterator
+         * @param e an input iterator
+         * replace the contents with [b, e), throws length_error if it does not fit
+         */
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type assign (II b, II e) {
+			clear();
+			insert(end(), b, e);}
+
+		void assign (size_type n, const_reference v) {
+			check_room(n > _s ? n - _s : 0);
+			const value_type x(v);
+			clear();
+			insert(end(), n, x);}
+
+        // ----
+        // back
+        // ----
+
+		reference back () {
+			assert(!empty());
+			return *slot(_s - 1);}
+
+		const_reference back () const {
+			assert(!empty());
+			return *slot(_s - 1);}
+
+        // -----
+        // begin
+        // -----
+
+		iterator begin () {
+			return iterator(this, 0);}
+
+		const_iterator begin () const {
+			return const_iterator(this, 0);}
+
+        // --------
+        // capacity
+        // --------
+
+        /**
+         * return N, the fixed capacity
+         */
+		size_type capacity () const {
+			return N;}
+
+        // -----
+        // clear
+        // -----
+
+		void clear () {
+			pop_back_n(_s);}
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * @param args the arguments for value_type's constructor
+         * construct a value at the back, when full the policy either drops the front or rejects it
+         * return false if the value was rejected
+         */
+		template <typename... Args>
+		bool emplace_back (Args&&... args) {
+			if (_s == N) {
+				if (!policy_type::overwrite)
+					return false;
+				value_type x(std::forward<Args>(args)...);
+				_a.destroy(_p + _h);
+				_h = (_h + 1) & MASK;
+				--_s;
+				_a.construct(slot(_s), std::move(x));}
+			else
+				_a.construct(slot(_s), std::forward<Args>(args)...);
+			++_s;
+			assert(valid());
+			return true;}
+
+        /**
+         * @param args the arguments for value_type's constructor
+         * construct a value at the front, when full the policy either drops the back or rejects it
+         * return false if the value was rejected
+         */
+		template <typename... Args>
+		bool emplace_front (Args&&... args) {
+			if (_s == N) {
+				if (!policy_type::overwrite)
+					return false;
+				value_type x(std::forward<Args>(args)...);
+				--_s;
+				_a.destroy(slot(_s));
+				_a.construct(_p + ((_h - 1) & MASK), std::move(x));}
+			else
+				_a.construct(_p + ((_h - 1) & MASK), std::forward<Args>(args)...);
+			_h = (_h - 1) & MASK;
+			++_s;
+			assert(valid());
+			return true;}
+
+        /**
+         * @param p an iterator
+         * @param args the arguments for value_type's constructor
+         * construct a value in front of p, shifting whichever side is shorter
+         * throws length_error when full
+         * return iterator to the new element
+         */
+		template <typename... Args>
+		iterator emplace (iterator p, Args&&... args) {
+			check_room(1);
+			const size_type i = p - begin();
+			if (i == _s)
+				emplace_back(std::forward<Args>(args)...);
+			else if (i == 0)
+				emplace_front(std::forward<Args>(args)...);
+			else {
+				value_type x(std::forward<Args>(args)...);
+				if (i < _s - i) {
+					emplace_front(std::move(front()));
+					std::move(begin() + 2, begin() + (i + 1), begin() + 1);}
+				else {
+					emplace_back(std::move(back()));
+					std::move_backward(begin() + i, end() - 2, end() - 1);}
+				(*this)[i] = std::move(x);}
+			assert(valid());
+			return begin() + i;}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return !_s;}
+
+        // ---
+        // end
+        // ---
+
+		iterator end () {
+			return iterator(this, _s);}
+
+		const_iterator end () const {
+			return const_iterator(this, _s);}
+
+        // -----
+        // erase
+        // -----
+
+        /**
+         * @param p an iterator
+         * remove *p, shifting whichever side is shorter
+         * return iterator to the element that followed it
+         */
+		iterator erase (iterator p) {
+			return erase(p, p + 1);}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * remove [b, e), shifting whichever side is shorter
+         * return iterator to the element that followed them
+         */
+		iterator erase (iterator b, iterator e) {
+			const size_type i = b - begin();
+			const size_type n = e - b;
+			if (i < _s - i - n) {
+				std::move_backward(begin(), b, e);
+				pop_front_n(n);}
+			else {
+				std::move(e, end(), b);
+				pop_back_n(n);}
+			assert(valid());
+			return begin() + i;}
+
+        // -----
+        // front
+        // -----
+
+		reference front () {
+			assert(!empty());
+			return _p[_h];}
+
+		const_reference front () const {
+			assert(!empty());
+			return _p[_h];}
+
+        // ----
+        // full
+        // ----
+
+		bool full () const {
+			return _s == N;}
+
+        // ------
+        // insert
+        // ------
+
+		iterator insert (iterator p, const_reference v) {
+			return emplace(p, v);}
+
+		iterator insert (iterator p, value_type&& v) {
+			return emplace(p, std::move(v));}
+
+        /**
+         * @param p an iterator
+         * @param n a size_type
+         * @param v a const_reference
+         * insert n copies of v in front of p, throws length_error if they do not fit
+         * return iterator to the first inserted value
+         */
+		iterator insert (iterator p, size_type n, const_reference v) {
+			check_room(n);
+			const size_type i = p - begin();
+			const size_type m = _s;
+			const value_type x(v);
+			try {
+				for (size_type k = 0; k != n; ++k)
+					emplace_back(x);}
+			catch (...) {
+				pop_back_n(_s - m);
+				throw;}
+			std::rotate(begin() + i, begin() + m, end());
+			assert(valid());
+			return begin() + i;}
+
+        /**
+         * @param p an iterator
+         * @param b an input iterator
+         * @param e an input iterator
+         * insert [b, e) in front of p, throws length_error if it does not fit
+         * return iterator to the first inserted value
+         */
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value, iterator>::type insert (iterator p, II b, II e) {
+			const size_type i = p - begin();
+			const size_type m = _s;
+			try {
+				while (b != e) {
+					check_room(1);
+					emplace_back(*b);
+					++b;}}
+			catch (...) {
+				pop_back_n(_s - m);
+				throw;}
+			std::rotate(begin() + i, begin() + m, end());
+			assert(valid());
+			return begin() + i;}
+
+        // ---
+        // pop
+        // ---
+
+		void pop_back () {
+			assert(!empty());
+			--_s;
+			_a.destroy(slot(_s));}
+
+		void pop_front () {
+			assert(!empty());
+			_a.destroy(_p + _h);
+			_h = (_h + 1) & MASK;
+			--_s;}
+
+        /**
+         * @param n a size_type
+         * remove the last n elements
+         */
+		void pop_back_n (size_type n) {
+			assert(n <= _s);
+			if (!std::is_trivially_destructible<value_type>::value)
+				for (size_type k = 0; k != n; ++k)
+					_a.destroy(slot(_s - 1 - k));
+			_s -= n;}
+
+        /**
+         * @param n a size_type
+         * remove the first n elements
+         */
+		void pop_front_n (size_type n) {
+			assert(n <= _s);
+			if (!std::is_trivially_destructible<value_type>::value)
+				for (size_type k = 0; k != n; ++k)
+					_a.destroy(slot(k));
+			_h = (_h + n) & MASK;
+			_s -= n;}
+
+        // ----
+        // push
+        // ----
+
+        /**
+         * add v at the back, see emplace_back
+         */
+		bool push_back (const_reference v) {
+			return emplace_back(v);}
+
+		bool push_back (value_type&& v) {
+			return emplace_back(std::move(v));}
+
+        /**
+         * add v at the front, see emplace_front
+         */
+		bool push_front (const_reference v) {
+			return emplace_front(v);}
+
+		bool push_front (value_type&& v) {
+			return emplace_front(std::move(v));}
+
+        // ------
+        // resize
+        // ------
+
+        /**
+         * @param s a size_type, at most N
+         * @param v a const_reference
+         * resize the ring to s elements, throws length_error if s is more than N
+         */
+		void resize (size_type s, const_reference v = value_type()) {
+			if (s > N)
+				throw std::length_error("my_ring_deque");
+			if (s < _s)
+				pop_back_n(_s - s);
+			else
+				insert(end(), s - _s, v);}
+
+        // ----
+        // size
+        // ----
+
+		size_type size () const {
+			return _s;}
+
+        // ----
+        // swap
+        // ----
+
+        /**
+         * @param that a my_ring_deque reference
+         * swap the slots when the allocators compare equal, otherwise the elements
+         */
+		void swap (my_ring_deque& that) {
+			if (_a == that._a) {
+				std::swap(_p, that._p);
+				std::swap(_h, that._h);
+				std::swap(_s, that._s);}
+			else {
+				my_ring_deque x(std::move(*this));
+				*this = std::move(that);
+				that = std::move(x);}}};
+
+template <typename T, std::size_t N, typename P, typename A>
+const typename my_ring_deque<T, N, P, A>::size_type my_ring_deque<T, N, P, A>::MASK;
+
+// --------------
+// my_small_deque
+// --------------
+
+/**
+ * a double ended queue that keeps up to N elements in a ring inside the object
+ * and moves them to a my_deque on the heap once it would hold more
+ * it stays on the heap until clear() or shrink_to_fit() finds it small again
+ * a deque that never holds more than N elements never allocates
+ */
+template < typename T, std::size_t N, typename A = std::allocator<T> >
+class my_small_deque {
+	static_assert(N != 0, "my_small_deque: N must not be 0");
+
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef A										 allocator_type;
+		typedef typename allocator_type::value_type		 value_type;	
+
+		typedef typename allocator_type::size_type		 size_type;
+		typedef typename allocator_type::difference_type difference_type;
+
+		typedef typename allocator_type::pointer		 pointer;	
+		typedef typename allocator_type::const_pointer	 const_pointer;
+
+		typedef typename allocator_type::reference		 reference;
+		typedef typename allocator_type::const_reference const_reference;
+
+		typedef my_deque<T, A> heap_type;
+
+	public:
+		// -----------
+        // operator ==
+        // -----------
+
+        /**
+         * @param lhs a my_small_deque reference to the left of operator 
+         * @param rhs a my_small_deque reference to the right of operator 
+         * return true if contents of lhs and rhs are equal, else false
+         */
+		friend bool operator == (const my_small_deque& lhs, const my_small_deque& rhs) {
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        // ----------
+        // operator <
+        // ----------
+
+        /**
+         * @param lhs a my_small_deque reference to the left of operator 
+         * @param rhs a my_small_deque reference to the right of operator         
+         * return true if rhs lexicographically greater than lhs
+         */
+		friend bool operator < (const my_small_deque& lhs, const my_small_deque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+	private:
+		// ----
+        // data
+        // ----
+
+		typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type _r[N];	// the inline ring
+		size_type _h;		// slot of the front element in _r
+		size_type _s;		// number of elements in _r
+		heap_type _d;		// the elements once there are more than N
+		bool      _heap;	// true when the elements are in _d
+
+	private:
+		// -----
+        // valid
+        // -----
+
+		bool valid () const {
+			return (_h < N) && (_s <= N) && (!_heap ? _d.empty() : !_s);}
+
+        /**
+         * @param i a size_type
+         * return the address of the inline slot i positions after the front, wrapping around
+         */
+		pointer slot (size_type i) const {
+			i += _h;
+			if (i >= N)
+				i -= N;
+			return reinterpret_cast<pointer>(const_cast<typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type*>(_r + i));}
+
+        /**
+         * destroy the inline elements
+         */
+		void clear_inline () {
+			if (!std::is_trivially_destructible<value_type>::value)
+				for (size_type i = 0; i != _s; ++i)
+					slot(i)->~value_type();
+			_h = _s = 0;}
+
+        /**
+         * @param k a size_type, how many elements are about to be added
+         * move the inline elements to the heap if k more would not fit inline
+         */
+		void make_room (size_type k) {
+			if (!_heap && (k > N - _s))
+				spill(k);}
+
+        /**
+         * @param k a size_type, how many elements are about to be added
+         * move the inline elements to the heap, copying them if moving could throw
+         */
+		void spill (size_type k) {
+			_d.reserve_back(_s + k);
+			try {
+				for (size_type i = 0; i != _s; ++i)
+					_d.push_back(std::move_if_noexcept(*slot(i)));}
+			catch (...) {
+				_d.clear();
+				throw;}
+			clear_inline();
+			_heap = true;}
+
+        /**
+         * move the elements back inline if they fit
+         */
+		void unspill () {
+			if (_heap && (_d.size() <= N)) {
+				_h = 0;
+				try {
+					for (; _s != _d.size(); ++_s)
+						::new (static_cast<void*>(slot(_s))) value_type(std::move_if_noexcept(_d[_s]));}
+				catch (...) {
+					clear_inline();
+					throw;}
+				_d.clear();
+				_heap = false;}}
+
+        /**
+         * @param that a my_small_deque rvalue reference
+         * take the elements of that, which is left empty
+         */
+		void take (my_small_deque&& that) {
+			if (that._heap) {
+				_d = std::move(that._d);
+				_heap = true;
+				that._heap = false;}
+			else {
+				for (; _s != that._s; ++_s)
+					::new (static_cast<void*>(slot(_s))) value_type(std::move(*that.slot(_s)));
+				that.clear_inline();}}
+
+	public:
+		class const_iterator;
+
+		// --------
+        // iterator
+        // --------
+
+		class iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_small_deque::value_type	  	value_type;
+				typedef typename my_small_deque::difference_type 	difference_type;
+				typedef typename my_small_deque::pointer	pointer;
+				typedef typename my_small_deque::reference	reference;
+
+				friend class my_small_deque;
+				friend class my_small_deque::const_iterator;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const iterator& lhs, const iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._i == rhs._i);}
+
+				friend bool operator != (const iterator& lhs, const iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const iterator& lhs, const iterator& rhs) {
+					return lhs._i < rhs._i;}
+
+				friend bool operator > (const iterator& lhs, const iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const iterator& lhs, const iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const iterator& lhs, const iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend iterator operator + (iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend iterator operator + (difference_type lhs, iterator rhs) {
+					return rhs += lhs;}
+
+				friend iterator operator - (iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+					return lhs._i - rhs._i;}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				my_small_deque* _d;	// the deque
+				difference_type _i;	// index from the front
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the ring this iterator walks
+                 * @param i the index of the element from the front
+                 */
+				iterator (my_small_deque* d = 0, difference_type i = 0) :
+						_d(d), _i(i)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return (*_d)[_i];}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return (*_d)[_i + n];}
+
+				iterator& operator ++ () {
+					++_i;
+					return *this;}
+
+				iterator operator ++ (int) {
+					iterator x = *this;
+					++_i;
+					return x;}
+
+				iterator& operator -- () {
+					--_i;
+					return *this;}
+
+				iterator operator -- (int) {
+					iterator x = *this;
+					--_i;
+					return x;}
+
+				iterator& operator += (difference_type d) {
+					_i += d;
+					return *this;}
+
+				iterator& operator -= (difference_type d) {
+					_i -= d;
+					return *this;}};
+
+        // --------------
+        // const_iterator
+        // --------------
+
+		class const_iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_small_deque::value_type	  	value_type;
+				typedef typename my_small_deque::difference_type 	difference_type;
+				typedef typename my_small_deque::const_pointer	pointer;
+				typedef typename my_small_deque::const_reference	reference;
+
+				friend class my_small_deque;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._i == rhs._i);}
+
+				friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._i < rhs._i;}
+
+				friend bool operator > (const const_iterator& lhs, const const_iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+					return rhs += lhs;}
+
+				friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._i - rhs._i;}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				const my_small_deque* _d;	// the deque
+				difference_type _i;	// index from the front
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the ring this const_iterator walks
+                 * @param i the index of the element from the front
+                 */
+				const_iterator (const my_small_deque* d = 0, difference_type i = 0) :
+						_d(d), _i(i)
+					{}
+
+                /**
+                 * @param it an iterator
+                 * convert an iterator into a const_iterator to the same element
+                 */
+				const_iterator (const iterator& it) :
+						_d(it._d), _i(it._i)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return (*_d)[_i];}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return (*_d)[_i + n];}
+
+				const_iterator& operator ++ () {
+					++_i;
+					return *this;}
+
+				const_iterator operator ++ (int) {
+					const_iterator x = *this;
+					++_i;
+					return x;}
+
+				const_iterator& operator -- () {
+					--_i;
+					return *this;}
+
+				const_iterator operator -- (int) {
+					const_iterator x = *this;
+					--_i;
+					return x;}
+
+				const_iterator& operator += (difference_type d) {
+					_i += d;
+					return *this;}
+
+				const_iterator& operator -= (difference_type d) {
+					_i -= d;
+					return *this;}};
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param a an allocator_type reference, used once the elements move to the heap
+         */
+		explicit my_small_deque (const allocator_type& a = allocator_type()) :
+				_h(0), _s(0), _d(a), _heap(false) {
+			assert(valid());}
+
+        /**
+         * @param s a size_type
+         * @param v a const_reference 
+         * @param a an allocator_type reference
+         * construct s copies of v, inline if s is at most N
+         */
+		explicit my_small_deque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) :
+				_h(0), _s(0), _d(a), _heap(false) {
+			insert(end(), s, v);
+			assert(valid());}
+
+        /**
+         * @param that a my_small_deque reference
+         * copy constructor, the copy is inline if that has at most N elements
+         */
+		my_small_deque (const my_small_deque& that) :
+				_h(0), _s(0), _heap(false) {
+			if (that.size() > N) {
+				_d = that._d;
+				_heap = true;}
+			else
+				try {
+					for (; _s != that.size(); ++_s)
+						::new (static_cast<void*>(slot(_s))) value_type(that[_s]);}
+				catch (...) {
+					clear_inline();
+					throw;}
+			assert(valid());}
+
+        /**
+         * @param that a my_small_deque rvalue reference
+         * move constructor, takes over the heap of that, or moves its inline elements one by one
+         */
+		my_small_deque (my_small_deque&& that) :
+				_h(0), _s(0), _heap(false) {
+			take(std::move(that));
+			assert(valid());}
+
+        // ----------
+        // destructor
+        // ----------
+
+		~my_small_deque () {
+			clear_inline();}
+
+        // ----------
+        // operator =
+        // ----------
+
+		my_small_deque& operator = (const my_small_deque& rhs) {
+			if (this != &rhs)
+				assign(rhs.begin(), rhs.end());
+			return *this;}
+
+		my_small_deque& operator = (my_small_deque&& rhs) {
+			if (this != &rhs) {
+				clear();
+				take(std::move(rhs));}
+			assert(valid());
+			return *this;}
+
+        // -----------
+        // operator []
+        // -----------
+
+		reference operator [] (size_type n) {
+			return _heap ? _d[n] : *slot(n);}
+
+		const_reference operator [] (size_type n) const {
+			return _heap ? _d[n] : *slot(n);}
+
+        // --
+        // at
+        // --
+
+		reference at (size_type n) {
+			if (n >= size())
+				throw std::out_of_range("my_small_deque");
+			return (*this)[n];}
+
+		const_reference at (size_type n) const {
+			if (n >= size())
+				throw std::out_of_range("my_small_deque");
+			return (*this)[n];}
+
+        // ------
+        // assign
+        // ------
+
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type assign (II b, II e) {
+			clear();
+			insert(end(), b, e);}
+
+		void assign (size_type n, const_reference v) {
+			const value_type x(v);
+			clear();
+			insert(end(), n, x);}
+
+        // ----
+        // back
+        // ----
+
+		reference back () {
+			assert(!empty());
+			return _heap ? _d.back() : *slot(_s - 1);}
+
+		const_reference back () const {
+			assert(!empty());
+			return _heap ? _d.back() : *slot(_s - 1);}
+
+        // -----
+        // begin
+        // -----
+
+		iterator begin () {
+			return iterator(this, 0);}
+
+		const_iterator begin () const {
+			return const_iterator(this, 0);}
+
+        // -----
+        // clear
+        // -----
+
+        /**
+         * destroy every element, the deque is inline again afterwards
+         * blocks the heap already has are kept for the next overflow, see shrink_to_fit
+         */
+		void clear () {
+			if (_heap) {
+				_d.clear();
+				_heap = false;}
+			else
+				clear_inline();
+			assert(valid());}
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * @param args the arguments for value_type's constructor
+         * construct a value at the back, moving everything to the heap if the inline ring is full
+         */
+		template <typename... Args>
+		void emplace_back (Args&&... args) {
+			if (_heap)
+				_d.emplace_back(std::forward<Args>(args)...);
+			else if (_s == N) {
+				value_type x(std::forward<Args>(args)...);
+				spill(1);
+				_d.push_back(std::move(x));}
+			else {
+				::new (static_cast<void*>(slot(_s))) value_type(std::forward<Args>(args)...);
+				++_s;}
+			assert(valid());}
+
+        /**
+         * @param args the arguments for value_type's constructor
+         * construct a value at the front, moving everything to the heap if the inline ring is full
+         */
+		template <typename... Args>
+		void emplace_front (Args&&... args) {
+			if (_heap)
+				_d.emplace_front(std::forward<Args>(args)...);
+			else if (_s == N) {
+				value_type x(std::forward<Args>(args)...);
+				spill(1);
+				_d.push_front(std::move(x));}
+			else {
+				const size_type h = _h ? _h - 1 : N - 1;
+				::new (static_cast<void*>(_r + h)) value_type(std::forward<Args>(args)...);
+				_h = h;
+				++_s;}
+			assert(valid());}
+
+        /**
+         * @param p an iterator
+         * @param args the arguments for value_type's constructor
+         * construct a value in front of p, inline by shifting whichever side is shorter
+         * return iterator to the new element
+         */
+		template <typename... Args>
+		iterator emplace (iterator p, Args&&... args) {
+			const size_type i = p - begin();
+			const size_type s = size();
+			if (i == s)
+				emplace_back(std::forward<Args>(args)...);
+			else if (i == 0)
+				emplace_front(std::forward<Args>(args)...);
+			else {
+				value_type x(std::forward<Args>(args)...);
+				make_room(1);
+				if (_heap)
+					_d.emplace(_d.begin() + i, std::move(x));
+				else {
+					if (i < s - i) {
+						emplace_front(std::move(front()));
+						std::move(begin() + 2, begin() + (i + 1), begin() + 1);}
+					else {
+						emplace_back(std::move(back()));
+						std::move_backward(begin() + i, end() - 2, end() - 1);}
+					(*this)[i] = std::move(x);}}
+			assert(valid());
+			return begin() + i;}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return !size();}
+
+        // ---
+        // end
+        // ---
+
+		iterator end () {
+			return iterator(this, size());}
+
+		const_iterator end () const {
+			return const_iterator(this, size());}
+
+        // -----
+        // erase
+        // -----
+
+        /**
+         * @param p an iterator
+         * remove *p
+         * return iterator to the element that followed it
+         */
+		iterator erase (iterator p) {
+			return erase(p, p + 1);}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * remove [b, e), inline by shifting whichever side is shorter
+         * return iterator to the element that followed them
+         */
+		iterator erase (iterator b, iterator e) {
+			const size_type i = b - begin();
+			const size_type n = e - b;
+			if (_heap)
+				_d.erase(_d.begin() + i, _d.begin() + (i + n));
+			else if (i < _s - i - n) {
+				std::move_backward(begin(), b, e);
+				pop_front_n(n);}
+			else {
+				std::move(e, end(), b);
+				pop_back_n(n);}
+			assert(valid());
+			return begin() + i;}
+
+        // -----
+        // front
+        // -----
+
+		reference front () {
+			assert(!empty());
+			return _heap ? _d.front() : *slot(0);}
+
+		const_reference front () const {
+			assert(!empty());
+			return _heap ? _d.front() : *slot(0);}
+
+        // ------
+        // insert
+        // ------
+
+		iterator insert (iterator p, const_reference v) {
+			return emplace(p, v);}
+
+		iterator insert (iterator p, value_type&& v) {
+			return emplace(p, std::move(v));}
+
+        /**
+         * @param p an iterator
+         * @param n a size_type
+         * @param v a const_reference
+         * insert n copies of v in front of p
+         * return iterator to the first inserted value
+         */
+		iterator insert (iterator p, size_type n, const_reference v) {
+			const size_type i = p - begin();
+			const value_type x(v);
+			make_room(n);
+			if (_heap)
+				_d.insert(_d.begin() + i, n, x);
+			else {
+				const size_type m = _s;
+				try {
+					for (size_type k = 0; k != n; ++k)
+						emplace_back(x);}
+				catch (...) {
+					pop_back_n(_s - m);
+					throw;}
+				std::rotate(begin() + i, begin() + m, end());}
+			assert(valid());
+			return begin() + i;}
+
+        /**
+         * @param p an iterator
+         * @param b an input iterator
+         * @param e an input iterator
+         * insert [b, e) in front of p
+         * return iterator to the first inserted value
+         */
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value, iterator>::type insert (iterator p, II b, II e) {
+			const size_type i = p - begin();
+			if (_heap)
+				_d.insert(_d.begin() + i, b, e);
+			else {
+				const size_type m = size();
+				try {
+					for (; b != e; ++b)
+						emplace_back(*b);}
+				catch (...) {
+					pop_back_n(size() - m);
+					throw;}
+				std::rotate(begin() + i, begin() + m, end());}
+			assert(valid());
+			return begin() + i;}
+
+        // ---------
+        // is_inline
+        // ---------
+
+        /**
+         * return true if the elements are inside the object
+         */
+		bool is_inline () const {
+			return !_heap;}
+
+        // ---
+        // pop
+        // ---
+
+		void pop_back () {
+			assert(!empty());
+			if (_heap)
+				_d.pop_back();
+			else {
+				--_s;
+				slot(_s)->~value_type();}}
+
+		void pop_front () {
+			assert(!empty());
+			if (_heap)
+				_d.pop_front();
+			else {
+				slot(0)->~value_type();
+				_h = (_h + 1 == N) ? 0 : _h + 1;
+				--_s;}}
+
+        /**
+         * @param n a size_type
+         * remove the last n elements
+         */
+		void pop_back_n (size_type n) {
+			assert(n <= size());
+			if (_heap)
+				_d.pop_back_n(n);
+			else
+				for (; n != 0; --n)
+					pop_back();}
+
+        /**
+         * @param n a size_type
+         * remove the first n elements
+         */
+		void pop_front_n (size_type n) {
+			assert(n <= size());
+			if (_heap)
+				_d.pop_front_n(n);
+			else
+				for (; n != 0; --n)
+					pop_front();}
+
+        // ----
+        // push
+        // ----
+
+		void push_back (const_reference v) {
+			emplace_back(v);}
+
+		void push_back (value_type&& v) {
+			emplace_back(std::move(v));}
+
+		void push_front (const_reference v) {
+			emplace_front(v);}
+
+		void push_front (value_type&& v) {
+			emplace_front(std::move(v));}
+
+        // ------
+        // resize
+        // ------
+
+		void resize (size_type s, const_reference v = value_type()) {
+			if (s < size())
+				pop_back_n(size() - s);
+			else
+				insert(end(), s - size(), v);}
+
+        // -------------
+        // shrink_to_fit
+        // -------------
+
+        /**
+         * move the elements back inline if they fit, and release what the heap no longer needs
+         */
+		void shrink_to_fit () {
+			unspill();
+			_d.shrink_to_fit();
+			assert(valid());}
+
+        // ----
+        // size
+        // ----
+
+		size_type size () const {
+			return _heap ? _d.size() : _s;}
+
+        // ----
+        // swap
+        // ----
+
+        /**
+         * @param that a my_small_deque reference
+         * swaps the heaps when both are on the heap, otherwise moves the elements
+         */
+		void swap (my_small_deque& that) {
+			if (_heap && that._heap)
+				_d.swap(that._d);
+			else {
+				my_small_deque x(std::move(*this));
+				*this = std::move(that);
+				that = std::move(x);}
+			assert(valid());}};
+
+// ---------------
+// my_tiered_deque
+// ---------------
+
+/**
+ * a double ended queue for ordered work lists, where inserts and erases in the middle are as common as at the ends
+ * the elements live in blocks of L slots, L a power of two, each block a ring with its own front slot;
+ * every block but the first and the last is full, so operator [] is a shift and a mask
+ * an insert or erase in the middle shifts at most L elements inside one block and then rotates each block
+ * between it and the nearer end by one slot, O(1) per block, for O(L + n / L) in all
+ * L follows sqrt(n): it doubles once n passes 2 L^2 and halves once n drops below L^2 / 8,
+ * each time moving every element to new blocks, so push and pop at either end stay O(1) amortized
+ * any insert or erase, and a push or pop that changes L, invalidates references to elements
+ */
+template < typename T, typename A = std::allocator<T> >
+class my_tiered_deque {
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef A										 allocator_type;
+		typedef typename allocator_type::value_type		 value_type;	
+
+		typedef typename allocator_type::size_type		 size_type;
+		typedef typename allocator_type::difference_type difference_type;
+
+		typedef typename allocator_type::pointer		 pointer;	
+		typedef typename allocator_type::const_pointer	 const_pointer;
+
+		typedef typename allocator_type::reference		 reference;
+		typedef typename allocator_type::const_reference const_reference;
+
+	public:
+		// -----------
+        // operator ==
+        // -----------
+
+        /**
+         * @param lhs a my_tiered_deque reference to the left of operator 
+         * @param rhs a my_tiered_deque reference to the right of operator 
+         * return true if contents of lhs and rhs are equal, else false
+         */
+		friend bool operator == (const my_tiered_deque& lhs, const my_tiered_deque& rhs) {
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        // ----------
+        // operator <
+        // ----------
+
+        /**
+         * @param lhs a my_tiered_deque reference to the left of operator 
+         * @param rhs a my_tiered_deque reference to the right of operator         
+         * return true if rhs lexicographically greater than lhs
+         */
+		friend bool operator < (const my_tiered_deque& lhs, const my_tiered_deque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+	private:
+		// ----
+        // data
+        // ----
+
+		struct block {
+			pointer   _p;	// the L slots
+			size_type _h;};	// slot of the block's first element
+
+		typedef typename allocator_type::template rebind<block>::other allocator_type2;
+		typedef my_deque<block, allocator_type2>                       map_type;
+
+		static const size_type MIN_SHIFT = 4;
+
+		allocator_type _a;
+		map_type  _m;	// the blocks, front to back
+		size_type _k;	// log2 of L
+		size_type _f;	// elements in the first block, all of them when there is one block
+		size_type _s;	// number of elements
+
+	private:
+		// -----
+        // valid
+        // -----
+
+		bool valid () const {
+			return (_k >= MIN_SHIFT) && (_m.empty() == !_s) && (_f <= _s) && (_f <= width()) &&
+				(_m.empty() || ((_f != 0) && (back_count() != 0) && (back_count() <= width()) &&
+				                ((_m.size() != 1) || (_f == _s))));}
+
+        /**
+         * return L, the number of slots in a block
+         */
+		size_type width () const {
+			return size_type(1) << _k;}
+
+		size_type mask () const {
+			return width() - 1;}
+
+        /**
+         * return the number of elements in the last block, _f when there is one
+         */
+		size_type back_count () const {
+			return (_m.size() == 1) ? _f : _s - _f - (_m.size() - 2) * width();}
+
+        /**
+         * @param k a size_type, a block
+         * return the number of elements in block k
+         */
+		size_type count (size_type k) const {
+			if (k == 0)
+				return _f;
+			if (k == _m.size() - 1)
+				return back_count();
+			return width();}
+
+        /**
+         * @param k a size_type, a block
+         * @param r a size_type, a position in it
+         * return the address of the slot r positions after the front of block k, wrapping around
+         */
+		pointer slot (size_type k, size_type r) const {
+			const block& b = _m[k];
+			return b._p + ((b._h + r) & mask());}
+
+        /**
+         * @param i a size_type, an index
+         * @param k set to the block of index i
+         * @param r set to its position in that block
+         */
+		void locate (size_type i, size_type& k, size_type& r) const {
+			if (i < _f) {
+				k = 0;
+				r = i;}
+			else {
+				i -= _f;
+				k = 1 + (i >> _k);
+				r = i & mask();}}
+
+        /**
+         * @param h a size_type, the slot the block's first element goes in
+         * return a block of L raw slots
+         */
+		block make_block (size_type h) {
+			block b = {_a.allocate(width()), h};
+			return b;}
+
+		void free_block (const block& b) {
+			_a.deallocate(b._p, width());}
+
+        /**
+         * @param h a size_type
+         * @param args the arguments for value_type's constructor
+         * add a block at the back and construct a value at its slot h
+         */
+		template <typename... Args>
+		void push_block_back (size_type h, Args&&... args) {
+			_m.push_back(make_block(h));
+			try {
+				_a.construct(_m.back()._p + h, std::forward<Args>(args)...);}
+			catch (...) {
+				free_block(_m.back());
+				_m.pop_back();
+				throw;}}
+
+        /**
+         * @param h a size_type
+         * @param args the arguments for value_type's constructor
+         * add a block at the front and construct a value at its slot h
+         */
+		template <typename... Args>
+		void push_block_front (size_type h, Args&&... args) {
+			_m.push_front(make_block(h));
+			try {
+				_a.construct(_m.front()._p + h, std::forward<Args>(args)...);}
+			catch (...) {
+				free_block(_m.front());
+				_m.pop_front();
+				throw;}}
+
+        /**
+         * @param i a size_type, neither 0 nor size()
+         * @param x a value_type, moved in at index i
+         * make room by shifting the elements from i on toward the back: inside i's block if it has a free slot,
+         * otherwise its last element is carried into the next block, whose front slot takes it while its own last
+         * element is carried on, until a block with a free slot or a new last block takes the carry
+         */
+		void insert_back (size_type i, value_type& x) {
+			size_type k, r;
+			locate(i, k, r);
+			const size_type c = count(k);
+			const size_type m = _m.size();
+			if (c < width()) {
+				pointer p = slot(k, c);
+				_a.construct(p, std::move(*slot(k, c - 1)));
+				for (size_type t = c - 1; t != r; --t)
+					*slot(k, t) = std::move(*slot(k, t - 1));
+				*slot(k, r) = std::move(x);
+				if (k == 0)
+					++_f;
+				return;}
+			value_type carry(std::move(*slot(k, c - 1)));
+			for (size_type t = c - 1; t != r; --t)
+				*slot(k, t) = std::move(*slot(k, t - 1));
+			*slot(k, r) = std::move(x);
+			for (size_type j = k + 1; j != m; ++j) {
+				block& b = _m[j];
+				const size_type h = (b._h - 1) & mask();
+				if (count(j) < width()) {
+					_a.construct(b._p + h, std::move(carry));
+					b._h = h;
+					return;}
+				b._h = h;
+				std::swap(carry, b._p[h]);}
+			push_block_back(0, std::move(carry));}
+
+        /**
+         * @param i a size_type, neither 0 nor size()
+         * @param x a value_type, moved in at index i
+         * make room by shifting the elements before i toward the front, the mirror image of insert_back,
+         * with the first block, or a new first block, taking the last carry
+         */
+		void insert_front (size_type i, value_type& x) {
+			size_type k, r;
+			locate(i, k, r);
+			if ((k == 0) && (_f < width())) {
+				block& b = _m.front();
+				const size_type h = (b._h - 1) & mask();
+				_a.construct(b._p + h, std::move((r == 0) ? x : b._p[b._h]));
+				b._h = h;
+				if (r != 0) {
+					for (size_type t = 1; t != r; ++t)
+						*slot(0, t) = std::move(*slot(0, t + 1));
+					*slot(0, r) = std::move(x);}
+				++_f;
+				return;}
+			value_type carry(std::move((r == 0) ? x : *slot(k, 0)));
+			if (r != 0) {
+				for (size_type t = 1; t != r; ++t)
+					*slot(k, t - 1) = std::move(*slot(k, t));
+				*slot(k, r - 1) = std::move(x);}
+			for (size_type j = k; j-- != 0;) {
+				block& b = _m[j];
+				if ((j == 0) && (_f < width())) {
+					_a.construct(slot(0, _f), std::move(carry));
+					++_f;
+					return;}
+				std::swap(carry, b._p[b._h]);
+				b._h = (b._h + 1) & mask();}
+			push_block_front(0, std::move(carry));
+			_f = 1;}
+
+        /**
+         * @param i a size_type
+         * remove the element at index i by shifting the elements after it toward the front:
+         * inside i's block, then each later block gives its first element to the block before it
+         */
+		void erase_back (size_type i) {
+			size_type k, r;
+			locate(i, k, r);
+			const size_type c = count(k);
+			const size_type m = _m.size();
+			const size_type n = back_count();
+			for (size_type t = r + 1; t != c; ++t)
+				*slot(k, t - 1) = std::move(*slot(k, t));
+			pointer hole = slot(k, c - 1);
+			for (size_type j = k + 1; j != m; ++j) {
+				block& b = _m[j];
+				pointer p = b._p + b._h;
+				*hole = std::move(*p);
+				hole = p;
+				b._h = (b._h + 1) & mask();}
+			_a.destroy(hole);
+			--_s;
+			if (m == 1)
+				--_f;
+			if (n == 1) {
+				free_block(_m.back());
+				_m.pop_back();}}
+
+        /**
+         * @param i a size_type
+         * remove the element at index i by shifting the elements before it toward the back,
+         * the mirror image of erase_back
+         */
+		void erase_front (size_type i) {
+			size_type k, r;
+			locate(i, k, r);
+			for (size_type t = r; t != 0; --t)
+				*slot(k, t) = std::move(*slot(k, t - 1));
+			pointer hole = slot(k, 0);
+			if (k == 0) {
+				_a.destroy(hole);
+				block& b = _m.front();
+				b._h = (b._h + 1) & mask();}
+			else {
+				for (size_type j = k - 1; j != 0; --j) {
+					block& b = _m[j];
+					b._h = (b._h - 1) & mask();
+					pointer p = b._p + b._h;
+					*hole = std::move(*p);
+					hole = p;}
+				pointer p = slot(0, _f - 1);
+				*hole = std::move(*p);
+				_a.destroy(p);}
+			--_f;
+			--_s;
+			if (_f == 0) {
+				free_block(_m.front());
+				_m.pop_front();
+				_f = std::min(width(), _s);}}
+
+        /**
+         * double L once n passes 2 L^2
+         */
+		void grow () {
+			if (_s > 2 * width() * width())
+				retier(_k + 1);}
+
+        /**
+         * halve L once n drops below L^2 / 8
+         */
+		void shrink () {
+			if ((_k > MIN_SHIFT) && (_s < width() * width() / 8))
+				retier(_k - 1);}
+
+        /**
+         * @param k a size_type, the new log2 of L
+         * move every element to blocks of 2^k slots, copying them if moving could throw
+         */
+		void retier (size_type k) {
+			my_tiered_deque x(_a);
+			x._k = k;
+			for (size_type i = 0; i != _s; ++i)
+				x.emplace_back(std::move_if_noexcept((*this)[i]));
+			swap(x);}
+
+	public:
+		class const_iterator;
+
+		// --------
+        // iterator
+        // --------
+
+		class iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_tiered_deque::value_type	  	value_type;
+				typedef typename my_tiered_deque::difference_type 	difference_type;
+				typedef typename my_tiered_deque::pointer	pointer;
+				typedef typename my_tiered_deque::reference	reference;
+
+				friend class my_tiered_deque;
+				friend class my_tiered_deque::const_iterator;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const iterator& lhs, const iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._i == rhs._i);}
+
+				friend bool operator != (const iterator& lhs, const iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const iterator& lhs, const iterator& rhs) {
+					return lhs._i < rhs._i;}
+
+				friend bool operator > (const iterator& lhs, const iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const iterator& lhs, const iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const iterator& lhs, const iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend iterator operator + (iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend iterator operator + (difference_type lhs, iterator rhs) {
+					return rhs += lhs;}
+
+				friend iterator operator - (iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+					return lhs._i - rhs._i;}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				my_tiered_deque* _d;	// the deque
+				difference_type _i;	// index from the front
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the deque this iterator walks
+                 * @param i the index of the element from the front
+                 */
+				iterator (my_tiered_deque* d = 0, difference_type i = 0) :
+						_d(d), _i(i)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return (*_d)[_i];}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return (*_d)[_i + n];}
+
+				iterator& operator ++ () {
+					++_i;
+					return *this;}
+
+				iterator operator ++ (int) {
+					iterator x = *this;
+					++_i;
+					return x;}
+
+				iterator& operator -- () {
+					--_i;
+					return *this;}
+
+				iterator operator -- (int) {
+					iterator x = *this;
+					--_i;
+					return x;}
+
+				iterator& operator += (difference_type d) {
+					_i += d;
+					return *this;}
+
+				iterator& operator -= (difference_type d) {
+					_i -= d;
+					return *this;}};
+
+        // --------------
+        // const_iterator
+        // --------------
+
+		class const_iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag   	iterator_category;
+				typedef typename my_tiered_deque::value_type	  	value_type;
+				typedef typename my_tiered_deque::difference_type 	difference_type;
+				typedef typename my_tiered_deque::const_pointer	pointer;
+				typedef typename my_tiered_deque::const_reference	reference;
+
+				friend class my_tiered_deque;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._i == rhs._i);}
+
+				friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._i < rhs._i;}
+
+				friend bool operator > (const const_iterator& lhs, const const_iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+					return rhs += lhs;}
+
+				friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._i - rhs._i;}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				const my_tiered_deque* _d;	// the deque
+				difference_type _i;	// index from the front
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the deque this const_iterator walks
+                 * @param i the index of the element from the front
+                 */
+				const_iterator (const my_tiered_deque* d = 0, difference_type i = 0) :
+						_d(d), _i(i)
+					{}
+
+                /**
+                 * @param it an iterator
+                 * convert an iterator into a const_iterator to the same element
+                 */
+				const_iterator (const iterator& it) :
+						_d(it._d), _i(it._i)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return (*_d)[_i];}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return (*_d)[_i + n];}
+
+				const_iterator& operator ++ () {
+					++_i;
+					return *this;}
+
+				const_iterator operator ++ (int) {
+					const_iterator x = *this;
+					++_i;
+					return x;}
+
+				const_iterator& operator -- () {
+					--_i;
+					return *this;}
+
+				const_iterator operator -- (int) {
+					const_iterator x = *this;
+					--_i;
+					return x;}
+
+				const_iterator& operator += (difference_type d) {
+					_i += d;
+					return *this;}
+
+				const_iterator& operator -= (difference_type d) {
+					_i -= d;
+					return *this;}};
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+		explicit my_tiered_deque (const allocator_type& a = allocator_type()) :
+				_a(a), _m(allocator_type2(a)), _k(MIN_SHIFT), _f(0), _s(0) {
+			assert(valid());}
+
+        /**
+         * @param s a size_type
+         * @param v a const_reference 
+         * @param a an allocator_type reference
+         * construct s copies of v
+         */
+		explicit my_tiered_deque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) :
+				_a(a), _m(allocator_type2(a)), _k(MIN_SHIFT), _f(0), _s(0) {
+			insert(end(), s, v);
+			assert(valid());}
+
+		my_tiered_deque (const my_tiered_deque& that) :
+				_a(that._a), _m(allocator_type2(that._a)), _k(MIN_SHIFT), _f(0), _s(0) {
+			insert(end(), that.begin(), that.end());
+			assert(valid());}
+
+        /**
+         * @param that a my_tiered_deque rvalue reference
+         * move constructor, takes over the blocks of that and leaves it empty
+         */
+		my_tiered_deque (my_tiered_deque&& that) :
+				_a(that._a), _m(allocator_type2(that._a)), _k(MIN_SHIFT), _f(0), _s(0) {
+			swap(that);
+			assert(valid());}
+
+        // ----------
+        // destructor
+        // ----------
+
+		~my_tiered_deque () {
+			clear();}
+
+        // ----------
+        // operator =
+        // ----------
+
+		my_tiered_deque& operator = (const my_tiered_deque& rhs) {
+			if (this != &rhs)
+				assign(rhs.begin(), rhs.end());
+			return *this;}
+
+        /**
+         * @param rhs a my_tiered_deque rvalue reference
+         * move assignment, swaps the blocks when the allocators compare equal
+         */
+		my_tiered_deque& operator = (my_tiered_deque&& rhs) {
+			if (this != &rhs) {
+				if (_a == rhs._a) {
+					clear();
+					swap(rhs);}
+				else
+					assign(std::make_move_iterator(rhs.begin()), std::make_move_iterator(rhs.end()));}
+			return *this;}
+
+        // -----------
+        // operator []
+        // -----------
+
+        /**
+         * @param n a size_type
+         * an index a little past the end lands in a slot of the last block, as it does in my_deque,
+         * never in memory the deque does not own
+         */
+		reference operator [] (size_type n) {
+			size_type k, r;
+			locate(n, k, r);
+			return *slot(std::min(k, _m.size() - 1), r);}
+
+		const_reference operator [] (size_type n) const {
+			return const_cast<my_tiered_deque*>(this)->operator[](n);}
+
+        // --
+        // at
+        // --
+
+		reference at (size_type n) {
+			if (n >= size())
+				throw std::out_of_range("my_tiered_deque");
+			return (*this)[n];}
+
+		const_reference at (size_type n) const {
+			if (n >= size())
+				throw std::out_of_range("my_tiered_deque");
+			return (*this)[n];}
+
+        // ------
+        // assign
+        // ------
+
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value>::type assign (II b, II e) {
+			clear();
+			insert(end(), b, e);}
+
+		void assign (size_type n, const_reference v) {
+			const value_type x(v);
+			clear();
+			insert(end(), n, x);}
+
+        // ----
+        // back
+        // ----
+
+		reference back () {
+			assert(!empty());
+			return *slot(_m.size() - 1, back_count() - 1);}
+
+		const_reference back () const {
+			assert(!empty());
+			return *slot(_m.size() - 1, back_count() - 1);}
+
+        // -----
+        // begin
+        // -----
+
+		iterator begin () {
+			return iterator(this, 0);}
+
+		const_iterator begin () const {
+			return const_iterator(this, 0);}
+
+        // -----------
+        // block_width
+        // -----------
+
+        /**
+         * return L, the number of slots in a block, which follows sqrt(size())
+         */
+		size_type block_width () const {
+			return width();}
+
+        // -----
+        // clear
+        // -----
+
+        /**
+         * destroy every element and release every block, L starts over at its smallest
+         */
+		void clear () {
+			for (size_type k = 0; k != _m.size(); ++k) {
+				if (!std::is_trivially_destructible<value_type>::value)
+					for (size_type r = 0, c = count(k); r != c; ++r)
+						_a.destroy(slot(k, r));
+				free_block(_m[k]);}
+			_m.clear();
+			_k = MIN_SHIFT;
+			_f = _s = 0;
+			assert(valid());}
+
+        // -------
+        // emplace
+        // -------
+
+		template <typename... Args>
+		void emplace_back (Args&&... args) {
+			if (_m.empty() || (back_count() == width()))
+				push_block_back(0, std::forward<Args>(args)...);
+			else
+				_a.construct(slot(_m.size() - 1, back_count()), std::forward<Args>(args)...);
+			if (_m.size() == 1)
+				++_f;
+			++_s;
+			grow();
+			assert(valid());}
+
+		template <typename... Args>
+		void emplace_front (Args&&... args) {
+			if (_m.empty() || (_f == width())) {
+				push_block_front(0, std::forward<Args>(args)...);
+				_f = 1;}
+			else {
+				block& b = _m.front();
+				const size_type h = (b._h - 1) & mask();
+				_a.construct(b._p + h, std::forward<Args>(args)...);
+				b._h = h;
+				++_f;}
+			++_s;
+			grow();
+			assert(valid());}
+
+        /**
+         * @param p an iterator
+         * @param args the arguments for value_type's constructor
+         * construct a value in front of p, shifting the elements toward the nearer end, O(L + n / L)
+         * return iterator to the new element
+         */
+		template <typename... Args>
+		iterator emplace (iterator p, Args&&... args) {
+			const size_type i = p - begin();
+			if (i == _s)
+				emplace_back(std::forward<Args>(args)...);
+			else if (i == 0)
+				emplace_front(std::forward<Args>(args)...);
+			else {
+				value_type x(std::forward<Args>(args)...);
+				if (i < _s - i)
+					insert_front(i, x);
+				else
+					insert_back(i, x);
+				++_s;
+				grow();}
+			assert(valid());
+			return begin() + i;}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return !_s;}
+
+        // ---
+        // end
+        // ---
+
+		iterator end () {
+			return iterator(this, _s);}
+
+		const_iterator end () const {
+			return const_iterator(this, _s);}
+
+        // -----
+        // erase
+        // -----
+
+        /**
+         * @param p an iterator
+         * remove *p, shifting the elements toward it from the nearer end, O(L + n / L)
+         * return iterator to the element that followed it
+         */
+		iterator erase (iterator p) {
+			const size_type i = p - begin();
+			if (i < _s - i - 1)
+				erase_front(i);
+			else
+				erase_back(i);
+			shrink();
+			assert(valid());
+			return begin() + i;}
+
+        /**
+         * @param b an iterator
+         * @param e an iterator
+         * remove [b, e), shifting whichever side is shorter over them
+         * return iterator to the element that followed them
+         */
+		iterator erase (iterator b, iterator e) {
+			const size_type i = b - begin();
+			const size_type n = e - b;
+			if (n == 1)
+				return erase(b);
+			if (i < _s - i - n) {
+				std::move_backward(begin(), b, e);
+				pop_front_n(n);}
+			else {
+				std::move(e, end(), b);
+				pop_back_n(n);}
+			assert(valid());
+			return begin() + i;}
+
+        // -----
+        // front
+        // -----
+
+		reference front () {
+			assert(!empty());
+			return *slot(0, 0);}
+
+		const_reference front () const {
+			assert(!empty());
+			return *slot(0, 0);}
+
+        // ------
+        // insert
+        // ------
+
+		iterator insert (iterator p, const_reference v) {
+			return emplace(p, v);}
+
+		iterator insert (iterator p, value_type&& v) {
+			return emplace(p, std::move(v));}
+
+        /**
+         * @param p an iterator
+         * @param n a size_type
+         * @param v a const_reference
+         * insert n copies of v in front of p, adding them at the nearer end and rotating them into place
+         * return iterator to the first inserted value
+         */
+		iterator insert (iterator p, size_type n, const_reference v) {
+			const size_type i = p - begin();
+			const value_type x(v);
+			const size_type m = _s;
+			if (i < _s - i) {
+				try {
+					for (size_type k = 0; k != n; ++k)
+						emplace_front(x);}
+				catch (...) {
+					pop_front_n(_s - m);
+					throw;}
+				std::rotate(begin(), begin() + n, begin() + (n + i));}
+			else {
+				try {
+					for (size_type k = 0; k != n; ++k)
+						emplace_back(x);}
+				catch (...) {
+					pop_back_n(_s - m);
+					throw;}
+				std::rotate(begin() + i, begin() + m, end());}
+			assert(valid());
+			return begin() + i;}
+
+        /**
+         * @param p an iterator
+         * @param b an input iterator
+         * @param e an input iterator
+         * insert [b, e) in front of p, appending it and rotating it into place
+         * return iterator to the first inserted value
+         */
+		template <typename II>
+		typename std::enable_if<!std::is_integral<II>::value, iterator>::type insert (iterator p, II b, II e) {
+			const size_type i = p - begin();
+			const size_type m = _s;
+			try {
+				while (b != e) {
+					emplace_back(*b);
+					++b;}}
+			catch (...) {
+				pop_back_n(_s - m);
+				throw;}
+			std::rotate(begin() + i, begin() + m, end());
+			assert(valid());
+			return begin() + i;}
+
+        // ---
+        // pop
+        // ---
+
+		void pop_back () {
+			assert(!empty());
+			erase_back(_s - 1);
+			shrink();
+			assert(valid());}
+
+		void pop_front () {
+			assert(!empty());
+			erase_front(0);
+			shrink();
+			assert(valid());}
+
+        /**
+         * @param n a size_type
+         * remove the last n elements
+         */
+		void pop_back_n (size_type n) {
+			assert(n <= _s);
+			for (size_type k = 0; k != n; ++k)
+				erase_back(_s - 1);
+			shrink();
+			assert(valid());}
+
+        /**
+         * @param n a size_type
+         * remove the first n elements
+         */
+		void pop_front_n (size_type n) {
+			assert(n <= _s);
+			for (size_type k = 0; k != n; ++k)
+				erase_front(0);
+			shrink();
+			assert(valid());}
+
+        // ----
+        // push
+        // ----
+
+		void push_back (const_reference v) {
+			emplace_back(v);}
+
+		void push_back (value_type&& v) {
+			emplace_back(std::move(v));}
+
+		void push_front (const_reference v) {
+			emplace_front(v);}
+
+		void push_front (value_type&& v) {
+			emplace_front(std::move(v));}
+
+        // ------
+        // resize
+        // ------
+
+		void resize (size_type s, const_reference v = value_type()) {
+			if (s < _s)
+				pop_back_n(_s - s);
+			else
+				insert(end(), s - _s, v);}
+
+        // ----
+        // size
+        // ----
+
+		size_type size () const {
+			return _s;}
+
+        // ----
+        // swap
+        // ----
+
+        /**
+         * @param that a my_tiered_deque reference
+         * swap the blocks when the allocators compare equal, otherwise the elements
+         */
+		void swap (my_tiered_deque& that) {
+			if (_a == that._a) {
+				_m.swap(that._m);
+				std::swap(_k, that._k);
+				std::swap(_f, that._f);
+				std::swap(_s, that._s);}
+			else {
+				my_tiered_deque x(std::move(*this));
+				*this = std::move(that);
+				that = std::move(x);}}};
+
+template <typename T, typename A>
+const typename my_tiered_deque<T, A>::size_type my_tiered_deque<T, A>::MIN_SHIFT;
+
+// -------------
+// my_spsc_queue
+// -------------
+
+/**
+ * a lock free queue for exactly one producer thread and one consumer thread
+ * elements live in segments of S slots, like the blocks of my_deque, and the queue grows by linking
+ * a new segment at the back, so nothing is ever relocated
+ * _tail (written by the producer) and _head (written by the consumer) count every element ever pushed
+ * and popped, they are published with release and read with acquire, each side keeps a cached copy
+ * of the other's index so the shared cache line is only read when the cached one says full or empty
+ * producer and consumer state are a full cache line apart, padding rather than alignas so that
+ * a queue allocated with plain new is laid out the same
+ * the segment the consumer leaves behind is kept as a spare for the producer's next link
+ */
+template < typename T, std::size_t S = 256, typename A = std::allocator<T> >
+class my_spsc_queue {
+	static_assert(S != 0, "my_spsc_queue: S must not be 0");
+
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef A										 allocator_type;
+		typedef typename allocator_type::value_type		 value_type;	
+
+		typedef typename allocator_type::size_type		 size_type;
+		typedef typename allocator_type::difference_type difference_type;
+
+		typedef typename allocator_type::pointer		 pointer;	
+		typedef typename allocator_type::const_pointer	 const_pointer;
+
+		typedef typename allocator_type::reference		 reference;
+		typedef typename allocator_type::const_reference const_reference;
+
+		static const std::size_t CACHE_LINE = 64;
+
+	private:
+		struct segment {
+			segment* _next;
+			pointer  _p;};
+
+		typedef typename allocator_type::template rebind<segment>::other allocator_type2;
+
+		// ----
+        // data
+        // ----
+
+		allocator_type  _a;
+		allocator_type2 _sa;
+		size_type       _limit;	// most elements in flight, try_push fails beyond it
+
+		// consumer
+		char _pad0[CACHE_LINE];
+		std::atomic<size_type> _head;
+		segment*  _hs;	// segment holding the front
+		size_type _ho;	// offset of the front in *_hs
+		size_type _tc;	// cached _tail
+
+		// producer
+		char _pad1[CACHE_LINE];
+		std::atomic<size_type> _tail;
+		segment*  _ts;	// segment holding the back
+		size_type _to;	// offset one past the back in *_ts
+		size_type _hc;	// cached _head
+
+		char _pad2[CACHE_LINE];
+		std::atomic<segment*> _spare;
+
+	private:
+		// -------
+		// segment
+		// -------
+
+		segment* new_segment () {
+			segment* s = _spare.exchange(0, std::memory_order_acquire);
+			if (!s) {
+				s = _sa.allocate(1);
+				try {
+					s->_p = _a.allocate(S);}
+				catch (...) {
+					_sa.deallocate(s, 1);
+					throw;}}
+			s->_next = 0;
+			return s;}
+
+		void delete_segment (segment* s) {
+			_a.deallocate(s->_p, S);
+			_sa.deallocate(s, 1);}
+
+		void recycle_segment (segment* s) {
+			segment* x = _spare.exchange(s, std::memory_order_acq_rel);
+			if (x)
+				delete_segment(x);}
+
+        /**
+         * producer only
+         * return the slot for the next push, linking a new segment if the back one is full
+         */
+		pointer back_slot () {
+			if (_to == S) {
+				_ts->_next = new_segment();
+				_ts = _ts->_next;
+				_to = 0;}
+			return _ts->_p + _to;}
+
+        /**
+         * consumer only
+         * return the slot of the front, stepping to the next segment if the front one is used up
+         */
+		pointer front_slot () {
+			if (_ho == S) {
+				segment* s = _hs;
+				_hs = _hs->_next;
+				_ho = 0;
+				recycle_segment(s);}
+			return _hs->_p + _ho;}
+
+        /**
+         * producer only
+         * @param t a size_type, the current tail
+         * @param n a size_type
+         * return how many of n elements fit under the limit
+         */
+		size_type room (size_type t, size_type n) {
+			if (t - _hc + n > _limit) {
+				_hc = _head.load(std::memory_order_acquire);
+				if (t - _hc >= _limit)
+					return 0;}
+			return std::min(n, _limit - (t - _hc));}
+
+        /**
+         * consumer only
+         * @param h a size_type, the current head
+         * @param n a size_type
+         * return how many of n elements are ready to pop
+         */
+		size_type ready (size_type h, size_type n) {
+			if (_tc - h < n)
+				_tc = _tail.load(std::memory_order_acquire);
+			return std::min(n, _tc - h);}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param limit a size_type, the most elements in flight before try_push fails
+         * @param a an allocator_type reference
+         */
+		explicit my_spsc_queue (size_type limit = size_type(-1) / 2, const allocator_type& a = allocator_type()) :
+				_a(a), _sa(a), _limit(limit), _head(0), _hs(0), _ho(0), _tc(0), _tail(0), _ts(0), _to(0), _hc(0), _spare(0) {
+			_hs = _ts = new_segment();}
+
+		my_spsc_queue (const my_spsc_queue&) = delete;
+
+		my_spsc_queue& operator = (const my_spsc_queue&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * neither thread may still be using the queue
+         */
+		~my_spsc_queue () {
+			for (size_type n = _tail.load() - _head.load(); n != 0; --n) {
+				_a.destroy(front_slot());
+				++_ho;}
+			while (_hs) {
+				segment* s = _hs->_next;
+				delete_segment(_hs);
+				_hs = s;}
+			if (_spare.load())
+				delete_segment(_spare.load());}
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * return true if nothing was ready at the time of the call
+         */
+		bool empty () const {
+			return size() == 0;}
+
+        // -----
+        // limit
+        // -----
+
+		size_type limit () const {
+			return _limit;}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * return the number of elements in flight at the time of the call, exact only when both threads are quiet
+         */
+		size_type size () const {
+			const size_type h = _head.load(std::memory_order_acquire);
+			return _tail.load(std::memory_order_acquire) - h;}
+
+        // -----------
+        // try_emplace
+        // -----------
+
+        /**
+         * producer only
+         * @param args the arguments for value_type's constructor
+         * return false if the queue is at its limit
+         */
+		template <typename... Args>
+		bool try_emplace (Args&&... args) {
+			const size_type t = _tail.load(std::memory_order_relaxed);
+			if (!room(t, 1))
+				return false;
+			_a.construct(back_slot(), std::forward<Args>(args)...);
+			++_to;
+			_tail.store(t + 1, std::memory_order_release);
+			return true;}
+
+        // -------
+        // try_pop
+        // -------
+
+        /**
+         * consumer only
+         * @param v a reference the front is moved into
+         * return false if the queue was empty
+         */
+		bool try_pop (reference v) {
+			const size_type h = _head.load(std::memory_order_relaxed);
+			if (!ready(h, 1))
+				return false;
+			pointer p = front_slot();
+			v = std::move(*p);
+			_a.destroy(p);
+			++_ho;
+			_head.store(h + 1, std::memory_order_release);
+			return true;}
+
+        /**
+         * consumer only
+         * @param x an output iterator
+         * @param n a size_type
+         * move up to n elements to x, publishing the new head once for the whole batch
+         * return the number of elements moved
+         */
+		template <typename OI>
+		size_type try_pop_n (OI x, size_type n) {
+			const size_type h = _head.load(std::memory_order_relaxed);
+			n = ready(h, n);
+			size_type i = 0;
+			try {
+				for (; i != n; ++i, ++x) {
+					pointer p = front_slot();
+					*x = std::move(*p);
+					_a.destroy(p);
+					++_ho;}}
+			catch (...) {
+				_head.store(h + i, std::memory_order_release);
+				throw;}
+			_head.store(h + n, std::memory_order_release);
+			return n;}
+
+        // --------
+        // try_push
+        // --------
+
+        /**
+         * producer only
+         * return false if the queue is at its limit
+         */
+		bool try_push (const_reference v) {
+			return try_emplace(v);}
+
+		bool try_push (value_type&& v) {
+			return try_emplace(std::move(v));}
+
+        /**
+         * producer only
+         * @param b an input iterator
+         * @param n a size_type
+         * copy up to n elements from b, publishing the new tail once for the whole batch
+         * if a copy throws, the elements before it are still pushed
+         * return the number of elements pushed
+         */
+		template <typename II>
+		size_type try_push_n (II b, size_type n) {
+			const size_type t = _tail.load(std::memory_order_relaxed);
+			n = room(t, n);
+			size_type i = 0;
+			try {
+				for (; i != n; ++i, ++b) {
+					_a.construct(back_slot(), *b);
+					++_to;}}
+			catch (...) {
+				_tail.store(t + i, std::memory_order_release);
+				throw;}
+			_tail.store(t + n, std::memory_order_release);
+			return n;}};
+
+template <typename T, std::size_t S, typename A>
+const std::size_t my_spsc_queue<T, S, A>::CACHE_LINE;
+
+// -----------
+// my_ws_deque
+// -----------
+
+/**
+ * a Chase-Lev work stealing deque, after Le, Pop, Cohen and Zappa Nardelli,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models"
+ * one owner thread calls push_back and pop_back, any thread may steal from the front
+ * push_back and pop_back never lock, steal is one compare and swap on the front index
+ * the elements live in a circular array that doubles when full, a thief may still be reading an
+ * old array so the old arrays are kept until destruction, all of them together are smaller than the live one
+ * T is copied bitwise by thieves that lose the race, so it must be trivially copyable (e.g. a task pointer)
+ */
+template < typename T, typename A = std::allocator<T> >
+class my_ws_deque {
+	static_assert(std::is_trivially_copyable<T>::value, "my_ws_deque: T must be trivially copyable");
+
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef A										 allocator_type;
+		typedef typename allocator_type::value_type		 value_type;	
+
+		typedef typename allocator_type::size_type		 size_type;
+		typedef typename allocator_type::difference_type difference_type;
+
+		typedef typename allocator_type::reference		 reference;
+		typedef typename allocator_type::const_reference const_reference;
+
+	private:
+		typedef std::atomic<value_type> cell;
+
+		struct array {
+			difference_type _m;	// capacity - 1, capacity is a power of two
+			cell*           _p;
+
+			value_type get (difference_type i) const {
+				return _p[i & _m].load(std::memory_order_relaxed);}
+
+			void put (difference_type i, const_reference v) {
+				_p[i & _m].store(v, std::memory_order_relaxed);}};
+
+		typedef typename allocator_type::template rebind<cell>::other  allocator_type2;
+		typedef typename allocator_type::template rebind<array>::other allocator_type3;
+
+		// ----
+        // data
+        // ----
+
+		allocator_type2 _ca;
+		allocator_type3 _aa;
+
+		std::atomic<difference_type> _t;	// front, advanced by thieves and the owner
+		char _pad[64];
+		std::atomic<difference_type> _b;	// one past the back, owned by the owner
+		std::atomic<array*> _p;
+		my_deque<array*>    _old;	// arrays a thief may still be reading
+
+	private:
+		// -----
+		// array
+		// -----
+
+		array* new_array (difference_type c) {
+			array* a = _aa.allocate(1);
+			try {
+				a->_p = _ca.allocate(c);}
+			catch (...) {
+				_aa.deallocate(a, 1);
+				throw;}
+			a->_m = c - 1;
+			for (difference_type i = 0; i != c; ++i)
+				::new (static_cast<void*>(a->_p + i)) cell();
+			return a;}
+
+		void delete_array (array* a) {
+			_ca.deallocate(a->_p, a->_m + 1);
+			_aa.deallocate(a, 1);}
+
+        /**
+         * owner only
+         * copy [t, b) into an array twice the size and publish it
+         */
+		array* grow (array* a, difference_type t, difference_type b) {
+			_old.push_back(a);
+			array* x = new_array(2 * (a->_m + 1));
+			for (difference_type i = t; i != b; ++i)
+				x->put(i, a->get(i));
+			_p.store(x, std::memory_order_release);
+			return x;}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param c a size_type, the initial capacity, rounded up to a power of two
+         * @param a an allocator_type reference
+         */
+		explicit my_ws_deque (size_type c = 64, const allocator_type& a = allocator_type()) :
+				_ca(a), _aa(a), _t(0), _b(0), _p(0) {
+			difference_type n = 1;
+			while (n < static_cast<difference_type>(c))
+				n *= 2;
+			_p.store(new_array(n), std::memory_order_relaxed);}
+
+		my_ws_deque (const my_ws_deque&) = delete;
+
+		my_ws_deque& operator = (const my_ws_deque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+		~my_ws_deque () {
+			delete_array(_p.load(std::memory_order_relaxed));
+			while (!_old.empty()) {
+				delete_array(_old.back());
+				_old.pop_back();}}
+
+        // --------
+        // capacity
+        // --------
+
+        /**
+         * owner only
+         */
+		size_type capacity () const {
+			return _p.load(std::memory_order_relaxed)->_m + 1;}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return size() == 0;}
+
+        // --------
+        // pop_back
+        // --------
+
+        /**
+         * owner only
+         * @param v a reference the back is copied into
+         * return false if the deque was empty, or a thief took the last element
+         */
+		bool pop_back (reference v) {
+			const difference_type b = _b.load(std::memory_order_relaxed) - 1;
+			array* a = _p.load(std::memory_order_relaxed);
+			_b.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			difference_type t = _t.load(std::memory_order_relaxed);
+			if (t > b) {
+				_b.store(b + 1, std::memory_order_relaxed);
+				return false;}
+			v = a->get(b);
+			if (t == b) {
+				const bool r = _t.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				_b.store(b + 1, std::memory_order_relaxed);
+				return r;}
+			return true;}
+
+        // ---------
+        // push_back
+        // ---------
+
+        /**
+         * owner only
+         * @param v a const_reference
+         * may grow the array, which is the only time it allocates
+         */
+		void push_back (const_reference v) {
+			const difference_type b = _b.load(std::memory_order_relaxed);
+			const difference_type t = _t.load(std::memory_order_acquire);
+			array* a = _p.load(std::memory_order_relaxed);
+			if (b - t > a->_m)
+				a = grow(a, t, b);
+			a->put(b, v);
+			std::atomic_thread_fence(std::memory_order_release);
+			_b.store(b + 1, std::memory_order_relaxed);}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * return the number of elements at the time of the call, exact only when no thread is stealing
+         */
+		size_type size () const {
+			const difference_type t = _t.load(std::memory_order_acquire);
+			const difference_type b = _b.load(std::memory_order_acquire);
+			return b > t ? b - t : 0;}
+
+        // -----
+        // steal
+        // -----
+
+        /**
+         * any thread
+         * @param v a reference the front is copied into
+         * return false if the deque was empty, or another thread got the front first
+         */
+		bool steal (reference v) {
+			difference_type t = _t.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const difference_type b = _b.load(std::memory_order_acquire);
+			if (t >= b)
+				return false;
+			array* a = _p.load(std::memory_order_acquire);
+			const value_type x = a->get(t);
+			if (!_t.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return false;
+			v = x;
+			return true;}};
+
+// ----------
+// my_ws_pool
+// ----------
+
+/**
+ * a fixed set of worker threads, each owning a my_ws_deque of tasks
+ * a task submitted from a worker goes to the back of that worker's deque, other submissions go to a shared queue
+ * an idle worker pops its own back, then takes from the shared queue, then steals the front of another worker,
+ * and after a while without work it sleeps until a submit wakes it
+ * a thread waiting on a group runs tasks itself until the group is done, so tasks may submit and wait on groups
+ */
+class my_ws_pool {
+	public:
+		typedef std::size_t            size_type;
+		typedef std::function<void ()> task;
+
+		// -----
+		// group
+		// -----
+
+        /**
+         * the tasks submitted with it, wait(group&) returns when they are all done
+         */
+		class group {
+			friend class my_ws_pool;
+
+			private:
+				std::atomic<size_type> _n;	// tasks submitted and not yet finished
+				std::exception_ptr     _e;	// first exception one of them threw, guarded by the pool's _m
+
+			public:
+				group () :
+						_n(0) {}
+
+				group (const group&) = delete;
+
+				group& operator = (const group&) = delete;
+
+				size_type pending () const {
+					return _n.load(std::memory_order_acquire);}};
+
+	private:
+		struct job {
+			task   _f;
+			group* _g;};
+
+		struct worker {
+			my_ws_deque<job*> _d;
+			std::thread       _t;
+			unsigned          _r;};	// victim picker state
+
+		// ----
+        // data
+        // ----
+
+		std::vector<worker*>    _w;
+		std::mutex              _m;
+		std::condition_variable _c;
+		my_deque<job*>          _q;	// submissions from outside the workers, guarded by _m
+		group                   _all;	// every task, whatever group it was submitted with
+		std::atomic<size_type>  _idle;
+		std::atomic<bool>       _stop;
+
+	private:
+        /**
+         * return the worker of this pool running on the calling thread, or 0
+         */
+		worker* self () const {
+			const std::pair<const my_ws_pool*, worker*>& x = current();
+			return x.first == this ? x.second : 0;}
+
+		static std::pair<const my_ws_pool*, worker*>& current () {
+			static thread_local std::pair<const my_ws_pool*, worker*> x(0, 0);
+			return x;}
+
+        /**
+         * @param w the calling worker, or 0
+         * @param j a reference the job found is stored in
+         * return false if no job was found anywhere
+         */
+		bool find (worker* w, job*& j) {
+			if (w && w->_d.pop_back(j))
+				return true;
+			{
+			std::lock_guard<std::mutex> g(_m);
+			if (!_q.empty()) {
+				j = _q.front();
+				_q.pop_front();
+				return true;}
+			}
+			const unsigned r = w ? (w->_r = w->_r * 1103515245u + 12345u) >> 8 : 0;
+			for (size_type i = 0; i != _w.size(); ++i) {
+				worker* v = _w[(r + i) % _w.size()];
+				if (v != w && v->_d.steal(j))
+					return true;}
+			return false;}
+
+		void run (job* j) {
+			try {
+				j->_f();}
+			catch (...) {
+				std::lock_guard<std::mutex> g(_m);
+				group& x = j->_g ? *j->_g : _all;
+				if (!x._e)
+					x._e = std::current_exception();}
+			if (j->_g)
+				j->_g->_n.fetch_sub(1, std::memory_order_acq_rel);
+			delete j;
+			_all._n.fetch_sub(1, std::memory_order_acq_rel);}
+
+		void loop (worker* w) {
+			current() = std::make_pair(static_cast<const my_ws_pool*>(this), w);
+			int misses = 0;
+			while (!_stop.load(std::memory_order_acquire)) {
+				job* j;
+				if (find(w, j)) {
+					run(j);
+					misses = 0;}
+				else if (++misses < 64)
+					std::this_thread::yield();
+				else {
+					std::unique_lock<std::mutex> g(_m);
+					_idle.fetch_add(1);
+					if (_q.empty() && !_stop.load())
+						_c.wait_for(g, std::chrono::milliseconds(1));
+					_idle.fetch_sub(1);
+					misses = 0;}}}
+
+		void shutdown () {
+			_stop.store(true, std::memory_order_release);
+			{
+			std::lock_guard<std::mutex> g(_m);
+			_c.notify_all();
+			}
+			for (size_type i = 0; i != _w.size(); ++i)
+				if (_w[i]->_t.joinable())
+					_w[i]->_t.join();
+			for (size_type i = 0; i != _w.size(); ++i)
+				delete _w[i];
+			_w.clear();}
+
+        /**
+         * @param g a group, run tasks on the calling thread until it is done
+         */
+		void help (group& g) {
+			worker* w = self();
+			while (g._n.load(std::memory_order_acquire)) {
+				job* j;
+				if (find(w, j))
+					run(j);
+				else
+					std::this_thread::yield();}
+			std::lock_guard<std::mutex> l(_m);
+			if (g._e) {
+				std::exception_ptr e = g._e;
+				g._e = std::exception_ptr();
+				std::rethrow_exception(e);}}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param n a size_type, the number of worker threads, at least 1
+         */
+		explicit my_ws_pool (size_type n = std::max(1u, std::thread::hardware_concurrency())) :
+				_idle(0), _stop(false) {
+			n = std::max<size_type>(n, 1);
+			try {
+				for (size_type i = 0; i != n; ++i) {
+					_w.push_back(new worker());
+					_w.back()->_r = static_cast<unsigned>(i);}
+				for (size_type i = 0; i != n; ++i)
+					_w[i]->_t = std::thread(&my_ws_pool::loop, this, _w[i]);}
+			catch (...) {
+				shutdown();
+				throw;}}
+
+		my_ws_pool (const my_ws_pool&) = delete;
+
+		my_ws_pool& operator = (const my_ws_pool&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * finishes every submitted task, then stops the workers
+         */
+		~my_ws_pool () {
+			try {
+				help(_all);}
+			catch (...) {}
+			shutdown();}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * return the number of worker threads
+         */
+		size_type size () const {
+			return _w.size();}
+
+        // ------
+        // submit
+        // ------
+
+        /**
+         * @param f a callable taking no arguments
+         * queue f to run on some worker, wait() covers it
+         */
+		template <typename F>
+		void submit (F&& f) {
+			push(new job{task(std::forward<F>(f)), 0});}
+
+        /**
+         * @param g a group
+         * @param f a callable taking no arguments
+         * queue f to run on some worker, wait(g) covers it
+         */
+		template <typename F>
+		void submit (group& g, F&& f) {
+			job* j = new job{task(std::forward<F>(f)), &g};
+			g._n.fetch_add(1, std::memory_order_acq_rel);
+			try {
+				push(j);}
+			catch (...) {
+				g._n.fetch_sub(1, std::memory_order_acq_rel);
+				throw;}}
+
+        // ----
+        // wait
+        // ----
+
+        /**
+         * run tasks on the calling thread until every submitted task is done
+         * must not be called from a task, use a group there
+         * rethrows the first exception a task submitted without a group threw
+         */
+		void wait () {
+			assert(!self());
+			help(_all);}
+
+        /**
+         * @param g a group
+         * run tasks on the calling thread until every task of g is done, may be called from a task
+         * rethrows the first exception one of them threw
+         */
+		void wait (group& g) {
+			help(g);}
+
+	private:
+		void push (job* j) {
+			_all._n.fetch_add(1, std::memory_order_acq_rel);
+			try {
+				if (worker* w = self())
+					w->_d.push_back(j);
+				else {
+					std::lock_guard<std::mutex> g(_m);
+					_q.push_back(j);}}
+			catch (...) {
+				_all._n.fetch_sub(1, std::memory_order_acq_rel);
+				delete j;
+				throw;}
+			if (_idle.load(std::memory_order_acquire))
+				_c.notify_one();}};
+
+// -------------------
+// parallel algorithms
+// -------------------
+
+/**
+ * the functions below split a container with segments(b, e), such as my_deque, into chunks of whole blocks
+ * and run the chunks on a my_ws_pool, halving the chunk range and leaving one half for the pool to steal
+ * chunks are cut by position alone, grain elements rounded up to whole blocks, never by how many workers run,
+ * so parallel_reduce combines the same partial results in the same order on any pool
+ * with one chunk, or a pool of one worker, everything runs on the calling thread
+ */
+
+/**
+ * @param w a size_type, the block width
+ * @param grain a size_type, elements per chunk, 0 for the default of 256 blocks
+ * return elements per chunk, a multiple of w
+ */
+inline std::size_t parallel_grain (std::size_t w, std::size_t grain) {
+	if (!grain)
+		return 256 * w;
+	return (grain + w - 1) / w * w;}
+
+/**
+ * @param p a my_ws_pool
+ * @param lo a size_type
+ * @param hi a size_type
+ * @param f a function taking a chunk number
+ * call f(c) for every c in [lo, hi), the lower half goes to the pool and the calling thread takes the upper half
+ * rethrows the first exception an f threw, after every f it started has returned
+ */
+template <typename F>
+void parallel_chunks (my_ws_pool& p, std::size_t lo, std::size_t hi, const F& f) {
+	if (hi - lo == 1) {
+		f(lo);
+		return;}
+	const std::size_t m = lo + (hi - lo) / 2;
+	my_ws_pool::group g;
+	p.submit(g, [&p, &f, lo, m] () {parallel_chunks(p, lo, m, f);});
+	try {
+		parallel_chunks(p, m, hi, f);}
+	catch (...) {
+		try {
+			p.wait(g);}
+		catch (...) {}
+		throw;}
+	p.wait(g);}
+
+/**
+ * @param p a my_ws_pool
+ * @param n a size_type, the number of elements
+ * @param g a size_type, elements per chunk
+ * @param f a function taking the first and one past the last position of a chunk
+ * call f for every chunk of [0, n), on the pool unless there is only one chunk or one worker
+ */
+template <typename F>
+void parallel_ranges (my_ws_pool& p, std::size_t n, std::size_t g, const F& f) {
+	const std::size_t k = (n + g - 1) / g;
+	const auto h = [&f, n, g] (std::size_t c) {
+		f(c * g, std::min(n, (c + 1) * g));};
+	if ((k <= 1) || (p.size() == 1))
+		for (std::size_t c = 0; c != k; ++c)
+			h(c);
+	else
+		parallel_chunks(p, 0, k, h);}
+
+// -----------------
+// parallel_for_each
+// -----------------
+
+/**
+ * @param p a my_ws_pool
+ * @param d a container
+ * @param f a function taking a T&, called once per element, from any worker, in no particular order
+ * @param grain a size_type, elements per chunk, 0 for the default
+ */
+template <typename D, typename F>
+void parallel_for_each (my_ws_pool& p, D& d, F f, std::size_t grain = 0) {
+	typedef typename D::value_type T;
+	const typename D::iterator b = d.begin();
+	parallel_ranges(p, d.size(), parallel_grain(D::block_width(), grain), [&] (std::size_t i, std::size_t j) {
+		d.for_each_segment(b + i, b + j, [&] (deque_span<T> s) {
+			T* const q = s.data();
+			const std::size_t n = s.size();
+			for (std::size_t k = 0; k != n; ++k)
+				f(q[k]);});});}
+
+// ------------------
+// parallel_transform
+// ------------------
+
+/**
+ * @param p a my_ws_pool
+ * @param x a container
+ * @param y a container with at least x.size() values, not x
+ * @param f a function from T to T
+ * @param grain a size_type, elements per chunk, 0 for the default
+ * y[i] = f(x[i]) for every i of x
+ */
+template <typename D, typename F>
+void parallel_transform (my_ws_pool& p, const D& x, D& y, F f, std::size_t grain = 0) {
+	typedef typename D::value_type T;
+	assert(x.size() <= y.size());
+	const typename D::const_iterator b = x.begin();
+	const typename D::iterator       c = y.begin();
+	parallel_ranges(p, x.size(), parallel_grain(D::block_width(), grain), [&] (std::size_t i, std::size_t j) {
+		deque_zip_segments(x, b + i, b + j, y, c + i, [&] (const T* u, T* v, std::size_t n) {
+			for (std::size_t k = 0; k != n; ++k)
+				v[k] = f(u[k]);});});}
+
+// ---------------
+// parallel_reduce
+// ---------------
+
+/**
+ * @param p a my_ws_pool
+ * @param d a container
+ * @param init a value
+ * @param op an associative function of two values
+ * @param grain a size_type, elements per chunk, 0 for the default
+ * folds each chunk left to right, then folds init and the chunk results left to right
+ * the result depends on d and grain only, not on the pool, so a floating point sum is the same on every run
+ * return the reduction of init and d
+ */
+template <typename D, typename T, typename Op>
+T parallel_reduce (my_ws_pool& p, const D& d, T init, Op op, std::size_t grain = 0) {
+	typedef typename D::value_type V;
+	const std::size_t g = parallel_grain(D::block_width(), grain);
+	std::vector<T> r((d.size() + g - 1) / g, init);
+	const typename D::const_iterator b = d.begin();
+	parallel_ranges(p, d.size(), g, [&] (std::size_t i, std::size_t j) {
+		T x = *(b + i);
+		std::size_t skip = 1;
+		d.for_each_segment(b + i, b + j, [&] (deque_span<const V> s) {
+			const V* const q = s.data();
+			const std::size_t n = s.size();
+			for (std::size_t k = skip; k != n; ++k)
+				x = op(x, q[k]);
+			skip = 0;});
+		r[i / g] = x;});
+	for (std::size_t c = 0; c != r.size(); ++c)
+		init = op(init, r[c]);
+	return init;}
+
+/**
+ * @param p a my_ws_pool
+ * @param d a container
+ * return the sum of d, in the same order on every run
+ */
+template <typename D>
+typename D::value_type parallel_reduce (my_ws_pool& p, const D& d) {
+	return parallel_reduce(p, d, typename D::value_type(), std::plus<typename D::value_type>());}
+
+// -----------------
+// parallel_count_if
+// -----------------
+
+/**
+ * @param p a my_ws_pool
+ * @param d a container
+ * @param f a predicate taking a const T&, called from any worker
+ * @param grain a size_type, elements per chunk, 0 for the default
+ * return how many elements satisfy f
+ */
+template <typename D, typename F>
+std::size_t parallel_count_if (my_ws_pool& p, const D& d, F f, std::size_t grain = 0) {
+	typedef typename D::value_type T;
+	const std::size_t g = parallel_grain(D::block_width(), grain);
+	std::vector<std::size_t> r((d.size() + g - 1) / g, 0);
+	const typename D::const_iterator b = d.begin();
+	parallel_ranges(p, d.size(), g, [&] (std::size_t i, std::size_t j) {
+		std::size_t c = 0;
+		d.for_each_segment(b + i, b + j, [&] (deque_span<const T> s) {
+			const T* const q = s.data();
+			const std::size_t n = s.size();
+			for (std::size_t k = 0; k != n; ++k)
+				c += bool(f(q[k]));});
+		r[i / g] = c;});
+	return std::accumulate(r.begin(), r.end(), std::size_t(0));}
+
+// -------------
+// parallel_sort
+// -------------
+
+/**
+ * @param p a my_ws_pool
+ * @param d a container
+ * @param cmp a strict weak order
+ * @param grain a size_type, elements per chunk, 0 for the default
+ * sort each chunk in parallel, then merge neighbouring runs pairwise, every merge of a round in parallel
+ * a merge moves its two runs into a buffer and back, so it needs room for that many elements, not for all of d
+ * not stable
+ */
+template <typename D, typename Compare>
+void parallel_sort (my_ws_pool& p, D& d, Compare cmp, std::size_t grain = 0) {
+	typedef typename D::value_type T;
+	const std::size_t n = d.size();
+	const std::size_t g = parallel_grain(D::block_width(), grain);
+	const typename D::iterator b = d.begin();
+	parallel_ranges(p, n, g, [&] (std::size_t i, std::size_t j) {
+		std::sort(b + i, b + j, cmp);});
+	for (std::size_t w = g; w < n; w *= 2)
+		parallel_ranges(p, n, 2 * w, [&] (std::size_t i, std::size_t j) {
+			const std::size_t m = std::min(i + w, j);
+			if (m == j)
+				return;
+			std::vector<T> t;
+			t.reserve(j - i);
+			std::merge(std::make_move_iterator(b + i), std::make_move_iterator(b + m),
+			           std::make_move_iterator(b + m), std::make_move_iterator(b + j), std::back_inserter(t), cmp);
+			std::move(t.begin(), t.end(), b + i);});}
+
+template <typename D>
+void parallel_sort (my_ws_pool& p, D& d) {
+	parallel_sort(p, d, std::less<typename D::value_type>());}
+
+// -----------------
+// my_blocking_deque
+// -----------------
+
+/**
+ * a thread safe adapter over a deque for any number of producers and consumers
+ * every operation comes in three forms: try_ never waits, _for waits at most a duration, the plain form waits
+ * pops wait while the deque is empty, pushes wait while it holds limit() elements
+ * after close() pushes fail, pops keep taking what is left and then fail instead of waiting
+ * a waiting thread first spins on an atomic copy of the size and only then parks on a condition variable,
+ * and a push or pop only signals when some thread is parked, once per batch
+ */
+template < typename T, typename C = my_deque<T> >
+class my_blocking_deque {
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef C									   container_type;
+		typedef typename container_type::value_type	   value_type;
+		typedef typename container_type::size_type	   size_type;
+		typedef typename container_type::reference	   reference;
+		typedef typename container_type::const_reference const_reference;
+
+		static const int SPINS = 64;
+
+	private:
+		// ----
+        // data
+        // ----
+
+		mutable std::mutex      _m;
+		std::condition_variable _not_empty;
+		std::condition_variable _not_full;
+		container_type          _d;
+		const size_type         _limit;
+		std::atomic<size_type>  _n;	// _d.size(), readable without the lock
+		std::atomic<bool>       _closed;
+		size_type               _pop_waiters;	// guarded by _m
+		size_type               _push_waiters;	// guarded by _m
+
+	private:
+        /**
+         * spin until p() might be true, without the lock
+         */
+		template <typename P>
+		static void spin (P p) {
+			for (int i = 0; i != SPINS && !p(); ++i)
+				std::this_thread::yield();}
+
+		bool can_pop () const {
+			return _n.load(std::memory_order_acquire) || _closed.load(std::memory_order_acquire);}
+
+		bool can_push (size_type k) const {
+			return _n.load(std::memory_order_acquire) + k <= _limit || _closed.load(std::memory_order_acquire);}
+
+        /**
+         * @param g a lock on _m
+         * @param c the condition variable to park on
+         * @param w the waiter count to bump while parked
+         * @param p the predicate to wait for
+         * @param d the deadline, or 0 to wait forever
+         * return p()
+         */
+		template <typename P>
+		bool park (std::unique_lock<std::mutex>& g, std::condition_variable& c, size_type& w, P p, const std::chrono::steady_clock::time_point* d) {
+			if (p())
+				return true;
+			++w;
+			bool r;
+			if (d)
+				r = c.wait_until(g, *d, p);
+			else {
+				c.wait(g, p);
+				r = true;}
+			--w;
+			return r;}
+
+        /**
+         * @param g a lock on _m
+         * @param k a size_type, the number of elements just pushed
+         * wake consumers, once for the whole batch
+         */
+		void pushed (std::unique_lock<std::mutex>& g, size_type k) {
+			_n.store(_d.size(), std::memory_order_release);
+			const size_type w = _pop_waiters;
+			g.unlock();
+			if (w == 1 || (w && k == 1))
+				_not_empty.notify_one();
+			else if (w)
+				_not_empty.notify_all();}
+
+        /**
+         * @param g a lock on _m
+         * wake producers waiting for room, once for the whole batch
+         */
+		void popped (std::unique_lock<std::mutex>& g) {
+			_n.store(_d.size(), std::memory_order_release);
+			const size_type w = _push_waiters;
+			g.unlock();
+			if (w)
+				_not_full.notify_all();}
+
+		template <typename U>
+		bool push (bool front, U&& v, int how, const std::chrono::steady_clock::time_point* d) {
+			if (how && !can_push(1))
+				spin([this] () {return this->can_push(1);});
+			std::unique_lock<std::mutex> g(_m);
+			const auto p = [this] () {return this->_closed.load() || this->_d.size() < this->_limit;};
+			if (how ? !park(g, _not_full, _push_waiters, p, d) : !p())
+				return false;
+			if (_closed.load())
+				return false;
+			if (front)
+				_d.push_front(std::forward<U>(v));
+			else
+				_d.push_back(std::forward<U>(v));
+			pushed(g, 1);
+			return true;}
+
+		bool pop (bool front, reference v, int how, const std::chrono::steady_clock::time_point* d) {
+			if (how && !can_pop())
+				spin([this] () {return this->can_pop();});
+			std::unique_lock<std::mutex> g(_m);
+			const auto p = [this] () {return this->_closed.load() || !this->_d.empty();};
+			if (how ? !park(g, _not_empty, _pop_waiters, p, d) : !p())
+				return false;
+			if (_d.empty())
+				return false;
+			if (front) {
+				v = std::move(_d.front());
+				_d.pop_front();}
+			else {
+				v = std::move(_d.back());
+				_d.pop_back();}
+			popped(g);
+			return true;}
+
+		template <typename Rep, typename Period>
+		static std::chrono::steady_clock::time_point deadline (const std::chrono::duration<Rep, Period>& t) {
+			return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(t);}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param limit a size_type, the most elements it holds before pushes wait
+         */
+		explicit my_blocking_deque (size_type limit = size_type(-1)) :
+				_limit(limit), _n(0), _closed(false), _pop_waiters(0), _push_waiters(0) {
+			assert(limit != 0);}
+
+		my_blocking_deque (const my_blocking_deque&) = delete;
+
+		my_blocking_deque& operator = (const my_blocking_deque&) = delete;
+
+        // -----
+        // close
+        // -----
+
+        /**
+         * fail every push from now on, and wake everyone waiting
+         * pops take what is left, then fail
+         */
+		void close () {
+			{
+			std::lock_guard<std::mutex> g(_m);
+			_closed.store(true, std::memory_order_release);
+			}
+			_not_empty.notify_all();
+			_not_full.notify_all();}
+
+		bool closed () const {
+			return _closed.load(std::memory_order_acquire);}
+
+        // -----
+        // drain
+        // -----
+
+        /**
+         * @param x an output iterator
+         * @param n a size_type
+         * wait for at least one element, then move up to n from the front to x under a single lock
+         * return the number moved, 0 only once closed and empty
+         */
+		template <typename OI>
+		size_type drain (OI x, size_type n) {
+			return drain_impl(x, n, 1, 0);}
+
+		template <typename OI, typename Rep, typename Period>
+		size_type drain_for (OI x, size_type n, const std::chrono::duration<Rep, Period>& t) {
+			const std::chrono::steady_clock::time_point d = deadline(t);
+			return drain_impl(x, n, 1, &d);}
+
+		template <typename OI>
+		size_type try_drain (OI x, size_type n) {
+			return drain_impl(x, n, 0, 0);}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return size() == 0;}
+
+        // -----
+        // limit
+        // -----
+
+		size_type limit () const {
+			return _limit;}
+
+        // ---
+        // pop
+        // ---
+
+        /**
+         * @param v a reference the element is moved into
+         * return false if closed and empty
+         */
+		bool pop_back (reference v) {
+			return pop(false, v, 1, 0);}
+
+		bool pop_front (reference v) {
+			return pop(true, v, 1, 0);}
+
+        /**
+         * return false if still empty after t, or closed and empty
+         */
+		template <typename Rep, typename Period>
+		bool pop_back_for (reference v, const std::chrono::duration<Rep, Period>& t) {
+			const std::chrono::steady_clock::time_point d = deadline(t);
+			return pop(false, v, 1, &d);}
+
+		template <typename Rep, typename Period>
+		bool pop_front_for (reference v, const std::chrono::duration<Rep, Period>& t) {
+			const std::chrono::steady_clock::time_point d = deadline(t);
+			return pop(true, v, 1, &d);}
+
+        /**
+         * return false if empty
+         */
+		bool try_pop_back (reference v) {
+			return pop(false, v, 0, 0);}
+
+		bool try_pop_front (reference v) {
+			return pop(true, v, 0, 0);}
+
+        // ----
+        // push
+        // ----
+
+        /**
+         * @param v a value, copied or moved in
+         * return false if closed
+         */
+		template <typename U>
+		bool push_back (U&& v) {
+			return push(false, std::forward<U>(v), 1, 0);}
+
+		template <typename U>
+		bool push_front (U&& v) {
+			return push(true, std::forward<U>(v), 1, 0);}
+
+        /**
+         * return false if still full after t, or closed
+         */
+		template <typename U, typename Rep, typename Period>
+		bool push_back_for (U&& v, const std::chrono::duration<Rep, Period>& t) {
+			const std::chrono::steady_clock::time_point d = deadline(t);
+			return push(false, std::forward<U>(v), 1, &d);}
+
+		template <typename U, typename Rep, typename Period>
+		bool push_front_for (U&& v, const std::chrono::duration<Rep, Period>& t) {
+			const std::chrono::steady_clock::time_point d = deadline(t);
+			return push(true, std::forward<U>(v), 1, &d);}
+
+        /**
+         * return false if full or closed
+         */
+		template <typename U>
+		bool try_push_back (U&& v) {
+			return push(false, std::forward<U>(v), 0, 0);}
+
+		template <typename U>
+		bool try_push_front (U&& v) {
+			return push(true, std::forward<U>(v), 0, 0);}
+
+        /**
+         * @param b a forward iterator
+         * @param e a forward iterator
+         * wait for room, then push [b, e) at the back under a single lock, waking consumers once
+         * [b, e) must not be longer than limit()
+         * return false if closed
+         */
+		template <typename FI>
+		bool push_back_n (FI b, FI e) {
+			const size_type k = std::distance(b, e);
+			assert(k <= _limit);
+			if (!can_push(k))
+				spin([this, k] () {return this->can_push(k);});
+			std::unique_lock<std::mutex> g(_m);
+			park(g, _not_full, _push_waiters, [this, k] () {return this->_closed.load() || this->_d.size() + k <= this->_limit;}, 0);
+			if (_closed.load())
+				return false;
+			_d.insert(_d.end(), b, e);
+			pushed(g, k);
+			return true;}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * return the number of elements at the time of the call
+         */
+		size_type size () const {
+			return _n.load(std::memory_order_acquire);}
+
+	private:
+		template <typename OI>
+		size_type drain_impl (OI x, size_type n, int how, const std::chrono::steady_clock::time_point* d) {
+			if (!n)
+				return 0;
+			if (how && !can_pop())
+				spin([this] () {return this->can_pop();});
+			std::unique_lock<std::mutex> g(_m);
+			const auto p = [this] () {return this->_closed.load() || !this->_d.empty();};
+			if (how ? !park(g, _not_empty, _pop_waiters, p, d) : !p())
+				return 0;
+			const size_type k = std::min(n, _d.size());
+			for (size_type i = 0; i != k; ++i, ++x) {
+				*x = std::move(_d.front());
+				_d.pop_front();}
+			popped(g);
+			return k;}};
+
+template <typename T, typename C>
+const int my_blocking_deque<T, C>::SPINS;
+
+// --------------
+// sliding_window
+// --------------
+
+/**
+ * the smallest and the largest value among the samples of a time window, each in O(1) amortized per sample
+ * two monotonic my_deques keep only the samples that can still become the min or the max,
+ * a sample leaves them when a better one arrives after it or when it falls out of the window
+ * samples must come in nondecreasing ts order; min and max are by Compare and want a nonempty window
+ */
+template <typename T, typename Compare = std::less<T>, typename Ts = long long>
+class sliding_window {
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef T                  value_type;
+		typedef Compare            value_compare;
+		typedef Ts                 time_type;
+		typedef std::pair<T, Ts>   sample_type;
+		typedef my_deque<sample_type> container_type;
+		typedef typename container_type::size_type size_type;
+
+	private:
+		// ----
+        // data
+        // ----
+
+		container_type           _lo;	// values strictly increasing by Compare, front is the min
+		container_type           _hi;	// values strictly decreasing by Compare, front is the max
+		Compare                  _c;
+		std::vector<sample_type> _b;	// the batch of the last push_n, kept to not allocate per batch
+		std::vector<sample_type> _s;	// its suffix minima or maxima
+
+	private:
+		bool valid () const {
+			return (_lo.empty() == _hi.empty()) && (_lo.empty() || !(_lo.back().second < _hi.back().second));}
+
+        /**
+         * @param better whether its first argument beats its second
+         * set _s to the samples of _b that beat every later one, in order
+         */
+		template <typename B>
+		void suffix (B better) {
+			_s.clear();
+			for (size_type i = _b.size(); i != 0; --i)
+				if (_s.empty() || better(_b[i - 1].first, _s.back().first))
+					_s.push_back(_b[i - 1]);
+			std::reverse(_s.begin(), _s.end());}
+
+        /**
+         * @param d a container_type, _lo or _hi
+         * @param better whether its first argument beats its second, so the second can never be the answer
+         * drop the samples of d that the first of _s beats, then append _s
+         */
+		template <typename B>
+		void append (container_type& d, B better) {
+			while (!d.empty() && !better(d.back().first, _s.front().first))
+				d.pop_back();
+			d.append_range(_s.begin(), _s.end());}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+		explicit sliding_window (const Compare& c = Compare()) :
+				_c(c) {}
+
+        // -----
+        // empty
+        // -----
+
+        /**
+         * return true when every sample was evicted, or none pushed
+         */
+		bool empty () const {
+			return _lo.empty();}
+
+        // ----------------
+        // evict_older_than
+        // ----------------
+
+        /**
+         * @param ts a time_type
+         * drop the samples stamped before ts
+         */
+		void evict_older_than (const Ts& ts) {
+			while (!_lo.empty() && (_lo.front().second < ts))
+				_lo.pop_front();
+			while (!_hi.empty() && (_hi.front().second < ts))
+				_hi.pop_front();}
+
+        // -------
+        // min/max
+        // -------
+
+        /**
+         * return the smallest value in the window by Compare
+         */
+		const T& min () const {
+			assert(!empty());
+			return _lo.front().first;}
+
+        /**
+         * return the largest value in the window by Compare
+         */
+		const T& max () const {
+			assert(!empty());
+			return _hi.front().first;}
+
+        // ----
+        // push
+        // ----
+
+        /**
+         * @param v a value
+         * @param ts a time_type, not before the previous sample's
+         * add a sample, dropping the older ones it makes irrelevant
+         */
+		void push (const T& v, const Ts& ts) {
+			assert(_lo.empty() || !(ts < _lo.back().second));
+			while (!_lo.empty() && !_c(_lo.back().first, v))
+				_lo.pop_back();
+			_lo.emplace_back(v, ts);
+			while (!_hi.empty() && !_c(v, _hi.back().first))
+				_hi.pop_back();
+			_hi.emplace_back(v, ts);
+			assert(valid());}
+
+        /**
+         * @param v an input iterator over n values
+         * @param t an input iterator over their n nondecreasing time stamps
+         * @param n a size_type
+         * add n samples at once, the same as n calls to push
+         * only the batch's suffix minima and maxima reach the deques, found in one backward pass over the batch,
+         * and each deque is trimmed once against the whole batch instead of once per sample
+         */
+		template <typename VI, typename TI>
+		void push_n (VI v, TI t, size_type n) {
+			if (!n)
+				return;
+			_b.clear();
+			for (size_type i = 0; i != n; ++i, ++v, ++t)
+				_b.push_back(sample_type(*v, *t));
+			assert(_lo.empty() || !(_b.front().second < _lo.back().second));
+			const Compare& c = _c;
+			suffix(c);
+			append(_lo, c);
+			const auto r = [&c] (const T& x, const T& y) {return c(y, x);};
+			suffix(r);
+			append(_hi, r);
+			assert(valid());}};
+
+// ----------------
+// two_stack_window
+// ----------------
+
+/**
+ * any associative aggregate, such as a sum, a product or a gcd, of the samples of a time window
+ * in O(1) amortized per sample, with no inverse of Op needed
+ * new samples go on a back stack that keeps the aggregate of all of them;
+ * the front stack holds the older samples, each with the aggregate of itself and the ones after it on that stack,
+ * and is refilled from the back stack when an eviction empties it
+ * samples must come in nondecreasing ts order; aggregate wants a nonempty window
+ */
+template <typename T, typename Op = std::plus<T>, typename Ts = long long>
+class two_stack_window {
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef T                     value_type;
+		typedef Op                    operation_type;
+		typedef Ts                    time_type;
+		typedef std::pair<T, Ts>      sample_type;
+		typedef my_deque<sample_type> container_type;
+		typedef typename container_type::size_type size_type;
+
+	private:
+		// ----
+        // data
+        // ----
+
+		container_type _f;	// older samples, oldest first, each holding the aggregate from it to the back of _f
+		container_type _b;	// newer samples, oldest first, as pushed
+		T              _a;	// aggregate of _b, meaningless when _b is empty
+		Op             _op;
+
+	private:
+        /**
+         * move the back stack onto the empty front stack, aggregating from the newest sample down
+         */
+		void flip () {
+			assert(_f.empty());
+			_f.swap(_b);
+			typename container_type::iterator i = _f.end();
+			--i;
+			T a = i->first;
+			while (i != _f.begin()) {
+				--i;
+				a = _op(i->first, a);
+				i->first = a;}}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+		explicit two_stack_window (const Op& op = Op()) :
+				_a(), _op(op) {}
+
+        // ---------
+        // aggregate
+        // ---------
+
+        /**
+         * return Op over the samples in the window, oldest first
+         */
+		T aggregate () const {
+			assert(!empty());
+			if (_f.empty())
+				return _a;
+			if (_b.empty())
+				return _f.front().first;
+			return _op(_f.front().first, _a);}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return _f.empty() && _b.empty();}
+
+        // ----------------
+        // evict_older_than
+        // ----------------
+
+        /**
+         * @param ts a time_type
+         * drop the samples stamped before ts
+         */
+		void evict_older_than (const Ts& ts) {
+			while (!empty()) {
+				if (_f.empty()) {
+					if (!(_b.front().second < ts))
+						return;
+					flip();}
+				if (!(_f.front().second < ts))
+					return;
+				_f.pop_front();}}
+
+        // ---
+        // pop
+        // ---
+
+        /**
+         * drop the oldest sample
+         */
+		void pop () {
+			assert(!empty());
+			if (_f.empty())
+				flip();
+			_f.pop_front();}
+
+        // ----
+        // push
+        // ----
+
+        /**
+         * @param v a value
+         * @param ts a time_type, not before the previous sample's
+         */
+		void push (const T& v, const Ts& ts) {
+			_a = _b.empty() ? v : _op(_a, v);
+			_b.emplace_back(v, ts);}
+
+        /**
+         * @param v an input iterator over n values
+         * @param t an input iterator over their n nondecreasing time stamps
+         * @param n a size_type
+         * add n samples at once, with one reservation of the back stack
+         */
+		template <typename VI, typename TI>
+		void push_n (VI v, TI t, size_type n) {
+			_b.reserve_back(n);
+			for (size_type i = 0; i != n; ++i, ++v, ++t)
+				push(*v, *t);}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * return the number of samples in the window
+         */
+		size_type size () const {
+			return _f.size() + _b.size();}};
 
 #endif // Deque_h
@@ -0,0 +1,50 @@
+// ------------------------------
+// projects/deque/ExamplePool.c++
+// ------------------------------
+
+/*
+A small example of my_ws_pool: a parallel sum over a my_deque, split in halves until the pieces are small.
+
+To compile the example:
+    % g++ -std=c++11 -O2 -pedantic -Wall ExamplePool.c++ -o ExamplePool -lpthread
+
+To run the example:
+    % ExamplePool
+*/
+
+// --------
+// includes
+// --------
+
+#include <iostream> // cout, endl
+#include <numeric>  // accumulate
+
+#include "Deque.h"
+
+typedef my_deque<long>::const_iterator const_iterator;
+
+/**
+ * @param p a my_ws_pool, the calling thread is one of its workers or waits on it
+ * @param b a const_iterator
+ * @param e a const_iterator
+ * return the sum of [b, e), the left half goes to the pool, the calling thread does the right half
+ */
+long sum (my_ws_pool& p, const_iterator b, const_iterator e) {
+    if (e - b < 10000)
+        return std::accumulate(b, e, 0L);
+    const const_iterator m = b + (e - b) / 2;
+    long x = 0;
+    my_ws_pool::group g;
+    p.submit(g, [&p, &x, b, m] () {x = sum(p, b, m);});
+    const long y = sum(p, m, e);
+    p.wait(g);
+    return x + y;}
+
+int main () {
+    my_deque<long> d;
+    for (long i = 1; i <= 1000000; ++i)
+        d.push_back(i);
+    my_ws_pool p;
+    std::cout << p.size() << " workers" << std::endl;
+    std::cout << "sum = " << sum(p, d.begin(), d.end()) << std::endl;
+    return 0;}
@@ -0,0 +1,1309 @@
+// ----------------------------
+// projects/deque/MappedDeque.h
+// ----------------------------
+
+#ifndef MappedDeque_h
+#define MappedDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>    // find, lexicographical_compare, equal
+#include <cassert>      // assert
+#include <cerrno>       // errno, EEXIST, EINTR, ENOENT
+#include <climits>      // IOV_MAX
+#include <cstdint>      // uint32_t, uint64_t
+#include <cstdio>       // rename, snprintf
+#include <cstring>      // memcmp, memcpy
+#include <fstream>      // ifstream
+#include <iterator>     // random_access_iterator_tag
+#include <map>          // map
+#include <mutex>        // lock_guard, mutex
+#include <new>          // bad_alloc
+#include <stdexcept>    // out_of_range, runtime_error
+#include <string>       // string
+#include <system_error> // generic_category, system_error
+#include <type_traits>  // false_type, is_trivially_copyable, true_type
+#include <utility>      // pair
+#include <vector>       // vector
+
+#include <dirent.h>     // closedir, opendir, readdir
+#include <fcntl.h>      // open, O_CREAT, O_RDWR
+#include <sys/mman.h>   // madvise, mmap, msync, munmap
+#include <sys/stat.h>   // fstat, mkdir
+#include <sys/uio.h>    // iovec, readv, writev
+#include <unistd.h>     // close, fsync, ftruncate, sysconf, unlink
+
+#include "Deque.h"
+
+// ---------------
+// my_mapped_deque
+// ---------------
+
+/**
+ * a deque of trivially copyable T kept in files under a directory, for backlogs bigger than memory
+ * the elements live in segment files of segment_bytes() each, every one mapped shared, so references
+ * and iterators stay valid while the deque grows and shrinks at the other end, as with my_deque
+ * the hot() segments at each end are kept resident and read ahead; a segment that drifts further into the middle
+ * is handed back to the kernel, which writes it out and reads it in again only if the deque comes back to it
+ * sync() flushes the elements, checkpoint() flushes them and records where the deque starts and ends,
+ * so a my_mapped_deque opened on the same directory after a restart, or a crash, holds the elements it held at the
+ * last checkpoint, except that one overwritten since, in place or by a pop and a push, may show its new value
+ * errors from the system throw std::system_error
+ */
+template <typename T>
+class my_mapped_deque {
+	static_assert(std::is_trivially_copyable<T>::value, "my_mapped_deque: T must be trivially copyable");
+
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef T              value_type;
+		typedef std::size_t    size_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T*             pointer;
+		typedef const T*       const_pointer;
+		typedef T&             reference;
+		typedef const T&       const_reference;
+
+		static const size_type SEGMENT_BYTES = size_type(1) << 24;
+		static const size_type HOT           = 2;
+
+	public:
+		// -----------
+        // operator ==
+        // -----------
+
+		friend bool operator == (const my_mapped_deque& lhs, const my_mapped_deque& rhs) {
+			return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+		// ----------
+        // operator <
+        // ----------
+
+		friend bool operator < (const my_mapped_deque& lhs, const my_mapped_deque& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+
+	private:
+		/**
+		 * the meta file, where checkpoint() records the deque
+		 */
+		struct header {
+			char          _magic[8];
+			std::uint32_t _version;
+			std::uint32_t _size_of;	// sizeof(T)
+			std::uint64_t _shift;	// log2 of the elements per segment
+			std::uint64_t _b;		// position of the front element
+			std::uint64_t _e;		// position one past the back element
+			std::uint64_t _n;		// number of elements, _e - _b, as a check
+		};
+
+		static const std::uint32_t VERSION = 1;
+
+		// ----
+        // data
+        // ----
+
+		std::string   _dir;
+		size_type     _shift;	// log2 of the elements per segment
+		size_type     _bytes;	// bytes of a segment file, whole pages
+		size_type     _hot;		// segments kept resident at each end
+		my_deque<pointer> _m;	// the mapped segments, _m[k] is segment _s0 + k
+		std::uint64_t _s0;		// number of the first mapped segment
+		std::uint64_t _b;		// position of the front element, element p is in segment p >> _shift
+		std::uint64_t _e;		// position one past the back element
+		std::vector<std::uint64_t> _dead;	// segments dropped since the last checkpoint, which may still refer to them
+
+		/**
+		 * positions start this far in, so there is room to push_front for as long as there is to push_back
+		 */
+		static const std::uint64_t ORIGIN = std::uint64_t(1) << 62;
+
+	private:
+		// -----
+        // valid
+        // -----
+
+		bool valid () const {
+			return (_b <= _e) && (_s0 <= (_b >> _shift)) && ((_e >> _shift) < _s0 + _m.size());}
+
+		static void check (bool ok, const char* what) {
+			if (!ok)
+				throw std::system_error(errno, std::generic_category(), what);}
+
+		std::uint64_t mask () const {
+			return (std::uint64_t(1) << _shift) - 1;}
+
+		std::string path (std::uint64_t k) const {
+			char s[32];
+			std::snprintf(s, sizeof(s), "/%016llx.seg", static_cast<unsigned long long>(k));
+			return _dir + s;}
+
+		std::string meta () const {
+			return _dir + "/meta";}
+
+		pointer slot (std::uint64_t p) const {
+			return _m[size_type((p >> _shift) - _s0)] + (p & mask());}
+
+		// --------
+        // segments
+        // --------
+
+        /**
+         * @param k a segment number
+         * open segment k, creating the file if it is new, and map it
+         * return its first element
+         */
+		pointer map (std::uint64_t k) {
+			const std::string f = path(k);
+			const int fd = ::open(f.c_str(), O_RDWR | O_CREAT, 0644);
+			check(fd >= 0, "my_mapped_deque: open");
+			struct stat st;
+			if ((::fstat(fd, &st) != 0) || ((size_type(st.st_size) != _bytes) && (::ftruncate(fd, _bytes) != 0))) {
+				const int e = errno;
+				::close(fd);
+				errno = e;
+				check(false, "my_mapped_deque: ftruncate");}
+			void* p = ::mmap(0, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			check(p != MAP_FAILED, "my_mapped_deque: mmap");
+			_dead.erase(std::remove(_dead.begin(), _dead.end(), k), _dead.end());
+			return static_cast<pointer>(p);}
+
+        /**
+         * @param p a segment's first element
+         * @param k its number
+         * unmap it, its file goes at the next checkpoint
+         */
+		void unmap (pointer p, std::uint64_t k) {
+			::munmap(p, _bytes);
+			_dead.push_back(k);}
+
+        /**
+         * @param k an index into _m
+         * let the kernel write segment k out and reclaim its memory, unless it is one of the hot ones at either end
+         */
+		void cool (size_type k) {
+			if ((k < _hot) || (k + _hot >= _m.size()))
+				return;
+#ifdef MADV_PAGEOUT
+			::madvise(_m[k], _bytes, MADV_PAGEOUT);
+#else
+			::madvise(_m[k], _bytes, MADV_DONTNEED);
+#endif
+			}
+
+        /**
+         * @param k an index into _m
+         * ask the kernel to read segment k ahead, it is about to be one of the hot ones
+         */
+		void warm (size_type k) {
+			if (k < _m.size())
+				::madvise(_m[k], _bytes, MADV_WILLNEED);}
+
+        /**
+         * map the segment after the last one, cooling the one that leaves the hot back
+         */
+		void grow_back () {
+			_m.push_back(map(_s0 + _m.size()));
+			if (_m.size() > _hot)
+				cool(_m.size() - 1 - _hot);}
+
+        /**
+         * map the segment before the first one, cooling the one that leaves the hot front
+         */
+		void grow_front () {
+			_m.push_front(map(_s0 - 1));
+			--_s0;
+			cool(_hot);}
+
+        /**
+         * keep at most one empty segment mapped past each end, so pushing and popping across a boundary does not thrash
+         */
+		void trim () {
+			while ((_s0 + _m.size() - 1) > (_e >> _shift) + 1) {
+				unmap(_m.back(), _s0 + _m.size() - 1);
+				_m.pop_back();
+				if (_m.size() > _hot)
+					warm(_m.size() - _hot);}
+			while (_s0 + 1 < (_b >> _shift)) {
+				unmap(_m.front(), _s0);
+				_m.pop_front();
+				++_s0;
+				warm(_hot - 1);}}
+
+        /**
+         * map the segments of [_b, _e] after open or clear
+         */
+		void map_all () {
+			for (std::uint64_t k = _b >> _shift; k <= (_e >> _shift); ++k)
+				_m.push_back(map(k));
+			_s0 = _b >> _shift;
+			for (size_type k = 0; k != _m.size(); ++k)
+				cool(k);}
+
+        /**
+         * remove the segment files outside [_s0, _s0 + _m.size()), left by a crash after they were made or dropped
+         */
+		void sweep () {
+			DIR* d = ::opendir(_dir.c_str());
+			check(d != 0, "my_mapped_deque: opendir");
+			while (dirent* x = ::readdir(d)) {
+				unsigned long long k;
+				char c;
+				if ((std::sscanf(x->d_name, "%16llx.se%c", &k, &c) == 2) && (c == 'g') &&
+				    ((k < _s0) || (k >= _s0 + _m.size())))
+					::unlink((_dir + "/" + x->d_name).c_str());}
+			::closedir(d);}
+
+        // ----
+        // meta
+        // ----
+
+        /**
+         * return true if the directory has a checkpoint, read into _shift, _b and _e
+         */
+		bool load () {
+			const int fd = ::open(meta().c_str(), O_RDONLY);
+			if ((fd < 0) && (errno == ENOENT))
+				return false;
+			check(fd >= 0, "my_mapped_deque: open meta");
+			header h;
+			const ssize_t r = ::read(fd, &h, sizeof(h));
+			::close(fd);
+			if ((r != ssize_t(sizeof(h))) || std::memcmp(h._magic, "MDEQUE\0\0", 8) || (h._version != VERSION) ||
+			    (h._e - h._b != h._n) || (h._shift >= 48))
+				throw std::runtime_error("my_mapped_deque: " + meta() + " is not a checkpoint");
+			if (h._size_of != sizeof(T))
+				throw std::runtime_error("my_mapped_deque: " + meta() + " holds elements of another size");
+			_shift = size_type(h._shift);
+			_b     = h._b;
+			_e     = h._e;
+			return true;}
+
+        /**
+         * write the meta file next to the old one, then rename it over, so a crash leaves one or the other
+         */
+		void store () const {
+			header h;
+			std::memset(&h, 0, sizeof(h));
+			std::memcpy(h._magic, "MDEQUE\0\0", 8);
+			h._version = VERSION;
+			h._size_of = sizeof(T);
+			h._shift   = _shift;
+			h._b       = _b;
+			h._e       = _e;
+			h._n       = _e - _b;
+			const std::string t = meta() + ".tmp";
+			const int fd = ::open(t.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			check(fd >= 0, "my_mapped_deque: open meta");
+			const bool ok = (::write(fd, &h, sizeof(h)) == ssize_t(sizeof(h))) && (::fsync(fd) == 0);
+			const int e = errno;
+			::close(fd);
+			errno = e;
+			check(ok, "my_mapped_deque: write meta");
+			check(std::rename(t.c_str(), meta().c_str()) == 0, "my_mapped_deque: rename meta");
+			const int d = ::open(_dir.c_str(), O_RDONLY);
+			if (d >= 0) {
+				::fsync(d);
+				::close(d);}}
+
+	public:
+		class const_iterator;
+
+		// --------
+        // iterator
+        // --------
+
+		class iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag     iterator_category;
+				typedef typename my_mapped_deque::value_type      value_type;
+				typedef typename my_mapped_deque::difference_type difference_type;
+				typedef typename my_mapped_deque::pointer         pointer;
+				typedef typename my_mapped_deque::reference       reference;
+
+				friend class my_mapped_deque;
+				friend class my_mapped_deque::const_iterator;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const iterator& lhs, const iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._p == rhs._p);}
+
+				friend bool operator != (const iterator& lhs, const iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const iterator& lhs, const iterator& rhs) {
+					return lhs._p < rhs._p;}
+
+				friend bool operator > (const iterator& lhs, const iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const iterator& lhs, const iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const iterator& lhs, const iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend iterator operator + (iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend iterator operator + (difference_type lhs, iterator rhs) {
+					return rhs += lhs;}
+
+				friend iterator operator - (iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+					return difference_type(lhs._p - rhs._p);}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				my_mapped_deque* _d;	// the deque
+				std::uint64_t    _p;	// position of the element, unchanged by pushes and pops at either end
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the deque this iterator walks
+                 * @param p the position of the element
+                 */
+				iterator (my_mapped_deque* d = 0, std::uint64_t p = 0) :
+						_d(d), _p(p)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return *_d->slot(_p);}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return *_d->slot(_p + n);}
+
+				iterator& operator ++ () {
+					++_p;
+					return *this;}
+
+				iterator operator ++ (int) {
+					iterator x = *this;
+					++_p;
+					return x;}
+
+				iterator& operator -- () {
+					--_p;
+					return *this;}
+
+				iterator operator -- (int) {
+					iterator x = *this;
+					--_p;
+					return x;}
+
+				iterator& operator += (difference_type d) {
+					_p += d;
+					return *this;}
+
+				iterator& operator -= (difference_type d) {
+					_p -= d;
+					return *this;}};
+
+        // --------------
+        // const_iterator
+        // --------------
+
+		class const_iterator {
+			public:
+                // --------
+                // typedefs
+                // --------
+
+				typedef std::random_access_iterator_tag     iterator_category;
+				typedef typename my_mapped_deque::value_type      value_type;
+				typedef typename my_mapped_deque::difference_type difference_type;
+				typedef typename my_mapped_deque::const_pointer   pointer;
+				typedef typename my_mapped_deque::const_reference reference;
+
+				friend class my_mapped_deque;
+
+			public:
+                // -----------
+                // operators
+                // -----------
+
+				friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
+					return (lhs._d == rhs._d) && (lhs._p == rhs._p);}
+
+				friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs == rhs);}
+
+				friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+					return lhs._p < rhs._p;}
+
+				friend bool operator > (const const_iterator& lhs, const const_iterator& rhs) {
+					return rhs < lhs;}
+
+				friend bool operator <= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(rhs < lhs);}
+
+				friend bool operator >= (const const_iterator& lhs, const const_iterator& rhs) {
+					return !(lhs < rhs);}
+
+				friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
+					return lhs += rhs;}
+
+				friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+					return rhs += lhs;}
+
+				friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
+					return lhs -= rhs;}
+
+				friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+					return difference_type(lhs._p - rhs._p);}
+
+			private:
+                // ----
+                // data
+                // ----
+
+				const my_mapped_deque* _d;	// the deque
+				std::uint64_t          _p;	// position of the element
+
+			public:
+                // -----------
+                // constructor
+                // -----------
+
+                /**
+                 * @param d the deque this const_iterator walks
+                 * @param p the position of the element
+                 */
+				const_iterator (const my_mapped_deque* d = 0, std::uint64_t p = 0) :
+						_d(d), _p(p)
+					{}
+
+                /**
+                 * @param it an iterator
+                 * convert an iterator into a const_iterator to the same element
+                 */
+				const_iterator (const iterator& it) :
+						_d(it._d), _p(it._p)
+					{}
+
+                // Default copy, destructor, and copy assignment.
+
+				reference operator * () const {
+					return *_d->slot(_p);}
+
+				pointer operator -> () const {
+					return &**this;}
+
+				reference operator [] (difference_type n) const {
+					return *_d->slot(_p + n);}
+
+				const_iterator& operator ++ () {
+					++_p;
+					return *this;}
+
+				const_iterator operator ++ (int) {
+					const_iterator x = *this;
+					++_p;
+					return x;}
+
+				const_iterator& operator -- () {
+					--_p;
+					return *this;}
+
+				const_iterator operator -- (int) {
+					const_iterator x = *this;
+					--_p;
+					return x;}
+
+				const_iterator& operator += (difference_type d) {
+					_p += d;
+					return *this;}
+
+				const_iterator& operator -= (difference_type d) {
+					_p -= d;
+					return *this;}};
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param dir a directory, made if missing
+         * @param segment_bytes a size_type, the size of a segment file, rounded down to a power of two elements;
+         *        a directory with a checkpoint keeps the size it was made with
+         * @param hot a size_type, how many segments at each end to keep resident, at least 1
+         * open the deque checkpointed in dir, or start an empty one there
+         */
+		explicit my_mapped_deque (const std::string& dir, size_type segment_bytes = SEGMENT_BYTES, size_type hot = HOT) :
+				_dir(dir), _shift(0), _bytes(0), _hot(std::max<size_type>(hot, 1)), _s0(0), _b(ORIGIN), _e(ORIGIN) {
+			check((::mkdir(_dir.c_str(), 0755) == 0) || (errno == EEXIST), "my_mapped_deque: mkdir");
+			if (!load())
+				while ((size_type(2) << _shift) * sizeof(T) <= segment_bytes)
+					++_shift;
+			const size_type page = size_type(::sysconf(_SC_PAGESIZE));
+			_bytes = ((size_type(1) << _shift) * sizeof(T) + page - 1) / page * page;
+			try {
+				map_all();
+				sweep();}
+			catch (...) {
+				for (size_type k = 0; k != _m.size(); ++k)
+					::munmap(_m[k], _bytes);
+				throw;}
+			assert(valid());}
+
+		my_mapped_deque (const my_mapped_deque&) = delete;
+
+		my_mapped_deque& operator = (const my_mapped_deque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * checkpoint, so a clean shutdown loses nothing, then unmap
+         */
+		~my_mapped_deque () {
+			try {
+				checkpoint();}
+			catch (...) {}
+			for (size_type k = 0; k != _m.size(); ++k)
+				::munmap(_m[k], _bytes);}
+
+        // -----------
+        // operator []
+        // -----------
+
+		reference operator [] (size_type i) {
+			assert(i < size());
+			return *slot(_b + i);}
+
+		const_reference operator [] (size_type i) const {
+			assert(i < size());
+			return *slot(_b + i);}
+
+        // --
+        // at
+        // --
+
+		reference at (size_type i) {
+			if (i >= size())
+				throw std::out_of_range("my_mapped_deque::at");
+			return (*this)[i];}
+
+		const_reference at (size_type i) const {
+			return const_cast<my_mapped_deque*>(this)->at(i);}
+
+        // ----
+        // back
+        // ----
+
+		reference back () {
+			assert(!empty());
+			return *slot(_e - 1);}
+
+		const_reference back () const {
+			assert(!empty());
+			return *slot(_e - 1);}
+
+        // -----
+        // begin
+        // -----
+
+		iterator begin () {
+			return iterator(this, _b);}
+
+		const_iterator begin () const {
+			return const_iterator(this, _b);}
+
+        // ----------
+        // checkpoint
+        // ----------
+
+        /**
+         * flush the elements, then record where the deque starts and ends, then remove the files of dropped segments
+         * after a crash, the deque reopens as it was at the last checkpoint that returned
+         */
+		void checkpoint () {
+			sync();
+			store();
+			for (size_type i = 0; i != _dead.size(); ++i)
+				::unlink(path(_dead[i]).c_str());
+			_dead.clear();}
+
+        // -----
+        // clear
+        // -----
+
+		void clear () {
+			_b = _e = (_b + _e) / 2;
+			trim();
+			assert(valid());}
+
+        // ---------
+        // directory
+        // ---------
+
+		const std::string& directory () const {
+			return _dir;}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return _b == _e;}
+
+        // ---
+        // end
+        // ---
+
+		iterator end () {
+			return iterator(this, _e);}
+
+		const_iterator end () const {
+			return const_iterator(this, _e);}
+
+        // -----
+        // front
+        // -----
+
+		reference front () {
+			assert(!empty());
+			return *slot(_b);}
+
+		const_reference front () const {
+			assert(!empty());
+			return *slot(_b);}
+
+        // ---
+        // hot
+        // ---
+
+        /**
+         * return the number of segments kept resident at each end
+         */
+		size_type hot () const {
+			return _hot;}
+
+        // ---
+        // pop
+        // ---
+
+        /**
+         * drop the back element, a segment emptied beyond the spare is unmapped and its file removed at the next checkpoint
+         */
+		void pop_back () {
+			assert(!empty());
+			--_e;
+			if ((_e & mask()) == mask())
+				trim();
+			assert(valid());}
+
+        /**
+         * drop the front element, a segment emptied beyond the spare is unmapped and its file removed at the next checkpoint
+         */
+		void pop_front () {
+			assert(!empty());
+			++_b;
+			if ((_b & mask()) == 0)
+				trim();
+			assert(valid());}
+
+        // ----
+        // push
+        // ----
+
+        /**
+         * @param v a const_reference
+         * append v, mapping a new segment when the back one is full
+         */
+		void push_back (const_reference v) {
+			if (((_e + 1) >> _shift) >= _s0 + _m.size())
+				grow_back();
+			*slot(_e) = v;
+			++_e;
+			assert(valid());}
+
+        /**
+         * @param v a const_reference
+         * prepend v, mapping a new segment when the front one is full
+         */
+		void push_front (const_reference v) {
+			if (((_b - 1) >> _shift) < _s0)
+				grow_front();
+			--_b;
+			*slot(_b) = v;
+			assert(valid());}
+
+        // ------------
+        // segment_size
+        // ------------
+
+        /**
+         * return the number of elements in a segment
+         */
+		size_type segment_size () const {
+			return size_type(1) << _shift;}
+
+        // ----
+        // size
+        // ----
+
+		size_type size () const {
+			return size_type(_e - _b);}
+
+        // ----
+        // sync
+        // ----
+
+        /**
+         * @param wait a bool, false to only start the writes
+         * flush the elements to their files, every mapped segment since elements can change through references
+         */
+		void sync (bool wait = true) {
+			for (size_type k = 0; k != _m.size(); ++k)
+				check(::msync(_m[k], _bytes, wait ? MS_SYNC : MS_ASYNC) == 0, "my_mapped_deque: msync");}};
+
+template <typename T>
+const typename my_mapped_deque<T>::size_type my_mapped_deque<T>::SEGMENT_BYTES;
+
+template <typename T>
+const typename my_mapped_deque<T>::size_type my_mapped_deque<T>::HOT;
+
+template <typename T>
+const std::uint32_t my_mapped_deque<T>::VERSION;
+
+template <typename T>
+const std::uint64_t my_mapped_deque<T>::ORIGIN;
+
+// --------------
+// snapshot files
+// --------------
+
+/**
+ * @param fd a file descriptor
+ * @param v the pieces to move, left advanced past what was moved
+ * @param in true to readv into them, false to writev from them
+ * move every byte of v, up to IOV_MAX pieces per call and again after a partial one
+ */
+inline void deque_transfer (int fd, std::vector<iovec>& v, bool in) {
+	iovec* p = v.data();
+	iovec* const e = p + v.size();
+	while (p != e) {
+		const int k = int(std::min<std::ptrdiff_t>(e - p, IOV_MAX));
+		const ssize_t r = in ? ::readv(fd, p, k) : ::writev(fd, p, k);
+		if ((r < 0) && (errno == EINTR))
+			continue;
+		if (r < 0)
+			throw std::system_error(errno, std::generic_category(), in ? "deque snapshot: readv" : "deque snapshot: writev");
+		if (r == 0)
+			throw std::runtime_error("deque snapshot: short data");
+		std::size_t n = std::size_t(r);
+		while ((p != e) && (n >= p->iov_len)) {
+			n -= p->iov_len;
+			++p;}
+		if (n) {
+			p->iov_base = static_cast<char*>(p->iov_base) + n;
+			p->iov_len -= n;}}}
+
+/**
+ * @param d a my_deque of trivially copyable T
+ * @param fd a file descriptor open for writing
+ * write the same snapshot as my_deque::save, the header and every block gathered into one writev
+ */
+template <typename T, typename A, typename G, typename S>
+void deque_save_fd (const my_deque<T, A, G, S>& d, int fd) {
+	static_assert(std::is_trivially_copyable<T>::value, "deque_save_fd: T must be trivially copyable");
+	deque_snapshot_header h = deque_snapshot_header::make(sizeof(T), d.size());
+	std::vector<iovec> v;
+	v.reserve(d.size() / my_deque<T, A, G, S>::block_width() + 3);
+	v.push_back(iovec{&h, sizeof(h)});
+	d.for_each_segment([&v] (deque_span<const T> s) {
+		v.push_back(iovec{const_cast<T*>(s.data()), s.size_bytes()});});
+	deque_transfer(fd, v, false);}
+
+/**
+ * @param d a my_deque of trivially copyable T
+ * @param fd a file descriptor open for reading, at a snapshot
+ * replace the elements of d with the snapshot's, allocating exactly the blocks they need
+ * and scattering them into those blocks with one readv
+ * throws runtime_error, leaving d empty, when fd does not hold a whole snapshot of this T
+ */
+template <typename T, typename A, typename G, typename S>
+void deque_load_fd (my_deque<T, A, G, S>& d, int fd) {
+	static_assert(std::is_trivially_copyable<T>::value, "deque_load_fd: T must be trivially copyable");
+	deque_snapshot_header h;
+	std::vector<iovec> v(1, iovec{&h, sizeof(h)});
+	deque_transfer(fd, v, true);
+	const std::size_t n = h.check(sizeof(T));
+	d.clear();
+	v.clear();
+	d.write_spans(n, [&v] (deque_span<T> s) {
+		v.push_back(iovec{s.data(), s.size_bytes()});
+		return s.size();});
+	try {
+		deque_transfer(fd, v, true);}
+	catch (...) {
+		d.clear();
+		throw;}}
+
+// -----------------
+// my_deque_snapshot
+// -----------------
+
+/**
+ * a read-only view of a snapshot file written by my_deque::save or deque_save_fd, mapped rather than read,
+ * so iterating it copies nothing and only touches the pages it reaches
+ * the elements are contiguous, its iterators are plain pointers
+ */
+template <typename T>
+class my_deque_snapshot {
+	static_assert(std::is_trivially_copyable<T>::value, "my_deque_snapshot: T must be trivially copyable");
+
+	public:
+		// --------
+        // typedefs
+        // --------
+
+		typedef T              value_type;
+		typedef std::size_t    size_type;
+		typedef const T*       const_pointer;
+		typedef const T&       const_reference;
+		typedef const T*       const_iterator;
+		typedef const T*       iterator;
+
+	private:
+		// ----
+        // data
+        // ----
+
+		void*       _p;	// the mapping, header first
+		std::size_t _l;	// its length
+		const T*    _b;	// the first element
+		size_type   _n;	// the number of elements
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param file a snapshot file
+         * map it read only, throwing runtime_error if it is not a whole snapshot of this T
+         */
+		explicit my_deque_snapshot (const std::string& file) :
+				_p(0), _l(0), _b(0), _n(0) {
+			const int fd = ::open(file.c_str(), O_RDONLY);
+			if (fd < 0)
+				throw std::system_error(errno, std::generic_category(), "my_deque_snapshot: open " + file);
+			struct stat st;
+			if (::fstat(fd, &st) != 0) {
+				const int e = errno;
+				::close(fd);
+				throw std::system_error(e, std::generic_category(), "my_deque_snapshot: fstat " + file);}
+			_l = std::size_t(st.st_size);
+			if (_l < sizeof(deque_snapshot_header)) {
+				::close(fd);
+				throw std::runtime_error("deque snapshot: short header");}
+			_p = ::mmap(0, _l, PROT_READ, MAP_SHARED, fd, 0);
+			const int e = errno;
+			::close(fd);
+			if (_p == MAP_FAILED)
+				throw std::system_error(e, std::generic_category(), "my_deque_snapshot: mmap " + file);
+			try {
+				_n = static_cast<const deque_snapshot_header*>(_p)->check(sizeof(T));
+				if ((_l - sizeof(deque_snapshot_header)) / sizeof(T) < _n)
+					throw std::runtime_error("deque snapshot: short data");}
+			catch (...) {
+				::munmap(_p, _l);
+				throw;}
+			_b = reinterpret_cast<const T*>(static_cast<const char*>(_p) + sizeof(deque_snapshot_header));
+			::madvise(_p, _l, MADV_SEQUENTIAL);}
+
+		my_deque_snapshot (const my_deque_snapshot&) = delete;
+
+		my_deque_snapshot& operator = (const my_deque_snapshot&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+		~my_deque_snapshot () {
+			::munmap(_p, _l);}
+
+        // -----------
+        // operator []
+        // -----------
+
+		const_reference operator [] (size_type i) const {
+			assert(i < _n);
+			return _b[i];}
+
+        // --
+        // at
+        // --
+
+		const_reference at (size_type i) const {
+			if (i >= _n)
+				throw std::out_of_range("my_deque_snapshot::at");
+			return _b[i];}
+
+        // ----
+        // back
+        // ----
+
+		const_reference back () const {
+			assert(_n);
+			return _b[_n - 1];}
+
+        // -----
+        // begin
+        // -----
+
+		const_iterator begin () const {
+			return _b;}
+
+        // ----
+        // data
+        // ----
+
+		const_pointer data () const {
+			return _b;}
+
+        // -----
+        // empty
+        // -----
+
+		bool empty () const {
+			return !_n;}
+
+        // ---
+        // end
+        // ---
+
+		const_iterator end () const {
+			return _b + _n;}
+
+        // -----
+        // front
+        // -----
+
+		const_reference front () const {
+			assert(_n);
+			return _b[0];}
+
+        // ----
+        // size
+        // ----
+
+		size_type size () const {
+			return _n;}};
+
+
+// ---------------
+// huge_page_arena
+// ---------------
+
+/**
+ * memory for huge_page_allocator, carved out of anonymous chunks mapped on 2 MB boundaries
+ * and marked MADV_HUGEPAGE, so the kernel backs them with transparent huge pages
+ * and random access over a big my_deque misses the TLB once per 2 MB instead of once per 4 KB
+ * a block is far smaller than a huge page, so blocks are cut from a chunk one after the other
+ * and a freed block goes on a free list of its size, for the next block of that size;
+ * an allocation bigger than a quarter chunk gets a mapping of its own, given back when it is freed
+ * with prefault every chunk is touched as it is mapped, so reserve() takes the page faults up front
+ * without transparent huge pages, set to never or not built in, the chunks are ordinary pages and huge() is false
+ * chunks are kept until the arena goes, which must outlive every allocator using it
+ */
+class huge_page_arena {
+	public:
+		// ---------
+        // constants
+        // ---------
+
+		static const std::size_t HUGE_PAGE = std::size_t(2) << 20;
+		static const std::size_t ALIGN     = 64;
+
+	private:
+		// ----
+        // data
+        // ----
+
+		std::mutex                      _m;
+		const std::size_t               _chunk;		// bytes per chunk, a multiple of HUGE_PAGE
+		const bool                      _prefault;
+		char*                           _p;			// the unused rest of the current chunk
+		char*                           _e;
+		std::vector<char*>              _chunks;	// every chunk, current and spare
+		std::vector<char*>              _spare;		// chunks mapped by reserve and not yet cut
+		std::map<std::size_t, void*>    _free;		// free list heads by size
+		std::map<void*, std::size_t>    _large;		// mappings of their own, by address
+		std::size_t                     _mapped;
+		bool                            _huge;
+
+	private:
+        /**
+         * @param n a size_type
+         * return n rounded up to a multiple of m, a power of 2
+         */
+		static std::size_t round_up (std::size_t n, std::size_t m) {
+			return (n + m - 1) & ~(m - 1);}
+
+        /**
+         * @param n a multiple of HUGE_PAGE
+         * map n bytes on a HUGE_PAGE boundary, by mapping HUGE_PAGE more and trimming both ends,
+         * ask for huge pages and prefault if asked to
+         * return the mapping, throwing bad_alloc when the system has none
+         */
+		char* map_aligned (std::size_t n) {
+			void* const v = ::mmap(0, n + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (v == MAP_FAILED)
+				throw std::bad_alloc();
+			char* const b = static_cast<char*>(v);
+			char* const p = reinterpret_cast<char*>(round_up(reinterpret_cast<std::uintptr_t>(b), HUGE_PAGE));
+			if (p != b)
+				::munmap(b, p - b);
+			if (p + n != b + n + HUGE_PAGE)
+				::munmap(p + n, (b + n + HUGE_PAGE) - (p + n));
+#ifdef MADV_HUGEPAGE
+			if (::madvise(p, n, MADV_HUGEPAGE) != 0)
+				_huge = false;
+#else
+			_huge = false;
+#endif
+			if (_prefault)
+				for (std::size_t i = 0; i < n; i += 4096)
+					static_cast<volatile char*>(p)[i] = 0;
+			_mapped += n;
+			return p;}
+
+        /**
+         * make the next chunk current, a spare one if reserve left any
+         */
+		void next_chunk () {
+			if (_spare.empty()) {
+				_p = map_aligned(_chunk);
+				_chunks.push_back(_p);}
+			else {
+				_p = _spare.back();
+				_spare.pop_back();}
+			_e = _p + _chunk;}
+
+	public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * @param chunk a size_type, bytes mapped at a time, rounded up to a multiple of HUGE_PAGE
+         * @param prefault a bool, true to touch every page of a chunk as it is mapped
+         */
+		explicit huge_page_arena (std::size_t chunk = std::size_t(64) << 20, bool prefault = false) :
+				_chunk(round_up(std::max(chunk, std::size_t(HUGE_PAGE)), HUGE_PAGE)), _prefault(prefault),
+				_p(0), _e(0), _mapped(0), _huge(true) {}
+
+		huge_page_arena (const huge_page_arena&) = delete;
+
+		huge_page_arena& operator = (const huge_page_arena&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+		~huge_page_arena () {
+			for (char* c : _chunks)
+				::munmap(c, _chunk);
+			for (const std::pair<void* const, std::size_t>& l : _large)
+				::munmap(l.first, l.second);}
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * @param n a size_type, bytes
+         * return n bytes aligned to ALIGN, throwing bad_alloc when the system has none
+         */
+		void* allocate (std::size_t n) {
+			n = round_up(std::max<std::size_t>(n, 1), ALIGN);
+			std::lock_guard<std::mutex> g(_m);
+			if (n > _chunk / 4) {
+				const std::size_t l = round_up(n, HUGE_PAGE);
+				char* const p = map_aligned(l);
+				_large[p] = l;
+				return p;}
+			void*& h = _free[n];
+			if (h) {
+				void* const p = h;
+				std::memcpy(&h, p, sizeof(void*));
+				return p;}
+			if (std::size_t(_e - _p) < n)
+				next_chunk();
+			char* const p = _p;
+			_p += n;
+			return p;}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * @param p what allocate(n) returned
+         * @param n a size_type, the same bytes
+         */
+		void deallocate (void* p, std::size_t n) {
+			n = round_up(std::max<std::size_t>(n, 1), ALIGN);
+			std::lock_guard<std::mutex> g(_m);
+			if (n > _chunk / 4) {
+				const std::map<void*, std::size_t>::iterator i = _large.find(p);
+				assert(i != _large.end());
+				::munmap(i->first, i->second);
+				_mapped -= i->second;
+				_large.erase(i);
+				return;}
+			void*& h = _free[n];
+			std::memcpy(p, &h, sizeof(void*));
+			h = p;}
+
+        // ----
+        // huge
+        // ----
+
+        /**
+         * return false when the kernel refused MADV_HUGEPAGE for some chunk, or the system has no such advice
+         * true does not promise huge pages, the kernel may still not find 2 MB of contiguous memory
+         */
+		bool huge () {
+			std::lock_guard<std::mutex> g(_m);
+			return _huge;}
+
+        // --------
+        // instance
+        // --------
+
+        /**
+         * return the arena that default constructed huge_page_allocators share
+         */
+		static huge_page_arena& instance () {
+			static huge_page_arena a;
+			return a;}
+
+        // ------
+        // mapped
+        // ------
+
+        /**
+         * return the bytes mapped, chunks and large allocations
+         */
+		std::size_t mapped () {
+			std::lock_guard<std::mutex> g(_m);
+			return _mapped;}
+
+        // -------
+        // reserve
+        // -------
+
+        /**
+         * @param n a size_type, bytes
+         * map spare chunks until the current and spare chunks have n bytes free, prefaulting them if asked to
+         */
+		void reserve (std::size_t n) {
+			std::lock_guard<std::mutex> g(_m);
+			std::size_t k = std::size_t(_e - _p) + _spare.size() * _chunk;
+			while (k < n) {
+				_spare.push_back(map_aligned(_chunk));
+				_chunks.push_back(_spare.back());
+				k += _chunk;}}
+
+        // --------
+        // thp_mode
+        // --------
+
+        /**
+         * return the system's transparent huge page setting, "always", "madvise" or "never",
+         * or an empty string where there is none to read
+         */
+		static std::string thp_mode () {
+			std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+			std::string s;
+			std::getline(in, s);
+			const std::size_t b = s.find('[');
+			const std::size_t e = s.find(']');
+			if ((b == std::string::npos) || (e == std::string::npos) || (e < b))
+				return std::string();
+			return s.substr(b + 1, e - b - 1);}};
+
+// -------------------
+// huge_page_allocator
+// -------------------
+
+/**
+ * an allocator for my_deque<T, huge_page_allocator<T> > whose blocks, and block map, come from a huge_page_arena
+ * default constructed it uses huge_page_arena::instance()
+ */
+template <typename T>
+struct huge_page_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        typedef huge_page_allocator<U> other;};
+
+    typedef std::false_type is_always_equal;
+
+    huge_page_arena* _h;
+
+    huge_page_allocator () :
+            _h(&huge_page_arena::instance())
+        {}
+
+    explicit huge_page_allocator (huge_page_arena& h) :
+            _h(&h)
+        {}
+
+    template <typename U>
+    huge_page_allocator (const huge_page_allocator<U>& a) :
+            _h(a._h)
+        {}
+
+    T* allocate (std::size_t n) {
+        if (n > std::size_t(-1) / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(_h->allocate(n * sizeof(T)));}
+
+    void deallocate (T* p, std::size_t n) {
+        _h->deallocate(p, n * sizeof(T));}
+
+    friend bool operator == (const huge_page_allocator& lhs, const huge_page_allocator& rhs) {
+        return lhs._h == rhs._h;}
+
+    friend bool operator != (const huge_page_allocator& lhs, const huge_page_allocator& rhs) {
+        return !(lhs == rhs);}};
+
+template <typename T>
+struct uses_default_construct< huge_page_allocator<T> > :
+        std::true_type
+    {};
+
+#endif // MappedDeque_h
@@ -37,17 +37,32 @@ To obtain coverage of the test:
 // includes
 // --------
 
-#include <algorithm> // equal
+#include <algorithm> // equal, is_sorted, lower_bound, sort
+#include <atomic>    // atomic
+#include <chrono>    // milliseconds, seconds
+#include <cstdlib>   // mkdtemp, system
 #include <cstring>   // strcmp
 #include <deque>     // deque
-#include <sstream>   // ostringstream
+#include <iterator>  // distance, istream_iterator
+#include <memory>    // unique_ptr
+#include <numeric>   // accumulate
+#include <random>    // mt19937
+#include <sstream>   // ostringstream, stringstream
 #include <stdexcept> // invalid_argument
 #include <string>    // ==
+#include <thread>    // thread, yield
+#include <type_traits> // false_type, true_type
+#include <vector>    // vector
 #include <cassert>
 
+#include <sys/wait.h> // waitpid
+#include <fcntl.h>    // open
+#include <unistd.h>   // _exit, close, fork
+
 #include "gtest/gtest.h"
 
 #include "Deque.h"
+#include "MappedDeque.h"
 
 
 #define DEFS           typedef typename TestFixture::deque_type      deque_type; \
@@ -60,6 +75,15 @@ To obtain coverage of the test:
                         typedef typename TestFixture::reference       reference; \
                         typedef typename TestFixture::const_reference const_reference;
 
+/**
+ * a small block width that is not a power of two, so the typed tests cross many blocks
+ * and exercise the division path of my_deque's index math
+ */
+template <>
+struct deque_block_size<short> :
+        std::integral_constant<std::size_t, 7>
+    {};
+
 // ---------
 // TestDeque
 // ---------
@@ -84,7 +108,14 @@ typedef testing::Types<
             std::deque<int>,
             std::deque<double>,
             my_deque<int>,
-            my_deque<double> >
+            my_deque<double>,
+            my_deque<short>,
+            my_tiered_deque<int>,
+            my_tiered_deque<double>,
+            my_ring_deque<int, 4096>,
+            my_ring_deque<double, 4096>,
+            my_small_deque<int, 16>,
+            my_small_deque<double, 16> >
         my_types;
 
 TYPED_TEST_CASE(TestDeque, my_types);
@@ -1283,6 +1314,30 @@ TYPED_TEST(TestDeque, erase_6) {
     ASSERT_EQ(d[0], 10);  
 }
 
+TYPED_TEST(TestDeque, erase_7) {
+    DEFS
+
+    deque_type d;
+    for (int i = 0; i < 300; ++i)
+        d.push_back(i);
+    typename deque_type::iterator p = d.begin();
+    while (p != d.end())
+        if (int(*p) % 3 == 0)
+            p = d.erase(p);
+        else
+            ++p;
+    ASSERT_EQ(d.size(), 200);
+    for (int i = 0; i < 200; ++i)
+        ASSERT_EQ(d[i], i / 2 * 3 + i % 2 + 1);
+    p = d.erase(d.begin() + 150);
+    ASSERT_EQ(p - d.begin(), 150);
+    ASSERT_EQ(*p, 227);
+    p = d.erase(d.begin() + 10, d.begin() + 20);
+    ASSERT_EQ(p - d.begin(), 10);
+    ASSERT_EQ(*p, 31);
+    ASSERT_EQ(d.size(), 189);
+}
+
 // -----------
 // insert
 // -----------
@@ -1365,6 +1420,26 @@ TYPED_TEST(TestDeque, insert_6) {
     ASSERT_EQ(d[1], 1);
 }
 
+TYPED_TEST(TestDeque, insert_7) {
+    DEFS
+
+    deque_type d;
+    std::deque<int> e;
+    for (int i = 0; i < 200; ++i) {
+        const int j = (i * 37) % (int(d.size()) + 1);
+        typename deque_type::iterator p = d.insert(d.begin() + j, i);
+        e.insert(e.begin() + j, i);
+        ASSERT_EQ(p - d.begin(), j);
+        ASSERT_EQ(*p, i);}
+    ASSERT_TRUE(std::equal(e.begin(), e.end(), d.begin()));
+    d.insert(d.begin() + 20, 3, -1);
+    e.insert(e.begin() + 20, 3, -1);
+    d.insert(d.end() - 20, 3, -2);
+    e.insert(e.end() - 20, 3, -2);
+    ASSERT_EQ(d.size(), e.size());
+    ASSERT_TRUE(std::equal(e.begin(), e.end(), d.begin()));
+}
+
 
 
 // ---------
@@ -2598,3 +2673,1766 @@ TYPED_TEST(TestDeque, it_cons_3) {
     ASSERT_EQ(5, s);
     ASSERT_TRUE(std::equal(x.begin(), x.end(), a));
 }
+
+// ---------
+// block_map
+// ---------
+
+// references survive pushes at either end, except when my_small_deque moves its inline elements to the heap
+// or my_tiered_deque changes its block width
+template <typename D>
+struct stable_references : std::true_type {};
+
+template <typename T, std::size_t N, typename A>
+struct stable_references< my_small_deque<T, N, A> > : std::false_type {};
+
+template <typename T, typename A>
+struct stable_references< my_tiered_deque<T, A> > : std::false_type {};
+
+TYPED_TEST(TestDeque, block_map_1) {
+    DEFS
+
+    if (!stable_references<deque_type>::value)
+        return;
+    deque_type d;
+    d.push_back(1);
+    d.push_front(0);
+    const value_type* p = &d.front();
+    const value_type* q = &d.back();
+    for (int i = 0; i < 1000; ++i) {
+        d.push_back(2);
+        d.push_front(3);}
+    ASSERT_EQ(d.size(), 2002);
+    ASSERT_EQ(p, &d[1000]);
+    ASSERT_EQ(q, &d[1001]);
+    ASSERT_EQ(*p, 0);
+    ASSERT_EQ(*q, 1);
+}
+
+TYPED_TEST(TestDeque, block_map_2) {
+    DEFS
+
+    deque_type d;
+    std::deque<value_type> x;
+    for (int i = 0; i < 500; ++i) {
+        d.push_back(i);
+        x.push_back(i);
+        if (i % 3 == 0) {
+            d.pop_front();
+            x.pop_front();}}
+    ASSERT_EQ(d.size(), x.size());
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), d.begin()));
+}
+
+TYPED_TEST(TestDeque, block_map_3) {
+    DEFS
+
+    deque_type d(120, 4);
+    for (int i = 0; i < 120; ++i)
+        d.pop_back();
+    ASSERT_TRUE(d.empty());
+    for (int i = 0; i < 300; ++i)
+        d.push_front(i);
+    for (int i = 0; i < 299; ++i)
+        d.pop_front();
+    ASSERT_EQ(d.size(), 1);
+    ASSERT_EQ(d.front(), 0);
+    ASSERT_EQ(d.back(), 0);
+}
+
+// -------
+// emplace
+// -------
+
+TYPED_TEST(TestDeque, emplace_1) {
+    DEFS
+
+    deque_type d;
+    d.emplace_back(2);
+    d.emplace_front(1);
+    d.emplace_back(3);
+    ASSERT_EQ(d.size(), 3);
+    ASSERT_EQ(d.front(), 1);
+    ASSERT_EQ(d.back(),  3);
+}
+
+TYPED_TEST(TestDeque, emplace_2) {
+    DEFS
+
+    deque_type d(5, 1);
+    typename deque_type::iterator it = d.emplace(d.begin() + 2, 7);
+    ASSERT_EQ(d.size(), 6);
+    ASSERT_EQ(*it, 7);
+    ASSERT_EQ(d[2], 7);
+    ASSERT_EQ(d[3], 1);
+}
+
+TYPED_TEST(TestDeque, emplace_3) {
+    DEFS
+
+    deque_type d;
+    value_type v = 4;
+    d.push_back(std::move(v));
+    d.push_front(value_type(3));
+    d.insert(d.end(), value_type(5));
+    ASSERT_EQ(d.size(), 3);
+    ASSERT_EQ(d[0], 3);
+    ASSERT_EQ(d[1], 4);
+    ASSERT_EQ(d[2], 5);
+}
+
+// ----
+// move
+// ----
+
+TYPED_TEST(TestDeque, move_1) {
+    DEFS
+
+    deque_type x(100, 2);
+    const value_type* p = &x[50];
+    deque_type y(std::move(x));
+    ASSERT_EQ(y.size(), 100);
+    ASSERT_EQ(&y[50], p);
+}
+
+TYPED_TEST(TestDeque, move_2) {
+    DEFS
+
+    deque_type x(100, 2);
+    deque_type y(3, 1);
+    y = std::move(x);
+    ASSERT_EQ(y.size(), 100);
+    ASSERT_EQ(y[99], 2);
+}
+
+TEST(TestMyDeque, move_string) {
+    my_deque<std::string> x;
+    x.push_back(std::string(100, 'a'));
+    std::string s(100, 'b');
+    x.push_front(std::move(s));
+    ASSERT_TRUE(s.empty());
+    x.emplace_back(3, 'c');
+    x.emplace(x.begin() + 1, "d");
+    ASSERT_EQ(x.size(), 4);
+    ASSERT_EQ(x[0], std::string(100, 'b'));
+    ASSERT_EQ(x[1], "d");
+    ASSERT_EQ(x[2], std::string(100, 'a'));
+    ASSERT_EQ(x[3], "ccc");
+    my_deque<std::string> y(std::move(x));
+    ASSERT_EQ(y.size(), 4);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(TestMyDeque, move_only) {
+    my_deque< std::unique_ptr<int> > x;
+    for (int i = 0; i < 200; ++i)
+        x.emplace_back(new int(i));
+    x.push_front(std::unique_ptr<int>(new int(-1)));
+    x.erase(x.begin() + 10);
+    x.insert(x.begin() + 5, std::unique_ptr<int>(new int(42)));
+    ASSERT_EQ(x.size(), 201);
+    ASSERT_EQ(*x[0], -1);
+    ASSERT_EQ(*x[5], 42);
+    ASSERT_EQ(*x[10], 8);
+    ASSERT_EQ(*x[11], 10);
+    ASSERT_EQ(*x.back(), 199);
+}
+
+template <typename T>
+struct tagged_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        typedef tagged_allocator<U> other;};
+
+    int tag;
+
+    tagged_allocator (int t = 0) :
+            tag(t)
+        {}
+
+    template <typename U>
+    tagged_allocator (const tagged_allocator<U>& that) :
+            tag(that.tag)
+        {}
+
+    friend bool operator == (const tagged_allocator& lhs, const tagged_allocator& rhs) {
+        return lhs.tag == rhs.tag;}};
+
+TEST(TestMyDeque, move_allocator) {
+    typedef my_deque<std::string, tagged_allocator<std::string> > deque_type;
+    deque_type x(tagged_allocator<std::string>(1));
+    for (int i = 0; i < 60; ++i)
+        x.push_back(std::string(20, 'a' + i % 26));
+    deque_type y(std::move(x), tagged_allocator<std::string>(2));
+    ASSERT_EQ(y.size(), 60);
+    ASSERT_EQ(y[27], std::string(20, 'b'));
+    deque_type z(tagged_allocator<std::string>(3));
+    z.push_back("z");
+    z.swap(y);
+    ASSERT_EQ(z.size(), 60);
+    ASSERT_EQ(y.size(), 1);
+    ASSERT_EQ(y[0], "z");
+}
+
+// ---------------
+// random_access
+// ---------------
+
+TYPED_TEST(TestDeque, random_access_1) {
+    DEFS
+
+    deque_type d;
+    for (int i = 0; i < 300; ++i)
+        d.push_front(i);
+    std::sort(d.begin(), d.end());
+    ASSERT_EQ(d.front(), 0);
+    ASSERT_EQ(d.back(), 299);
+    ASSERT_TRUE(std::is_sorted(d.begin(), d.end()));
+    typename deque_type::iterator it = std::lower_bound(d.begin(), d.end(), 123);
+    ASSERT_EQ(it - d.begin(), 123);
+    ASSERT_EQ(std::distance(d.begin(), d.end()), 300);
+}
+
+TYPED_TEST(TestDeque, random_access_2) {
+    DEFS
+
+    deque_type d;
+    for (int i = 0; i < 200; ++i)
+        d.push_back(i);
+    typename deque_type::iterator b = d.begin();
+    typename deque_type::iterator e = d.end();
+    ASSERT_EQ(e - b, 200);
+    ASSERT_EQ(b[151], 151);
+    ASSERT_EQ(*(e - 77), 123);
+    ASSERT_EQ(*(60 + b), 60);
+    ASSERT_TRUE(b < e);
+    ASSERT_TRUE(e > b + 199);
+    ASSERT_TRUE(b + 50 <= b + 50);
+    ASSERT_TRUE(b + 51 >= b + 50);
+    b += 170;
+    b -= 120;
+    ASSERT_EQ(*b, 50);
+}
+
+TYPED_TEST(TestDeque, random_access_3) {
+    DEFS
+
+    deque_type d;
+    for (int i = 0; i < 130; ++i)
+        d.push_back(i);
+    typename deque_type::const_iterator b = d.begin();
+    typename deque_type::const_iterator e = d.end();
+    ASSERT_EQ(e - b, 130);
+    ASSERT_TRUE(b == d.begin());
+    int n = 0;
+    while (e != b) {
+        --e;
+        ++n;}
+    ASSERT_EQ(n, 130);
+}
+
+TYPED_TEST(TestDeque, random_access_4) {
+    DEFS
+
+    deque_type d;
+    ASSERT_TRUE(d.begin() == d.end());
+    ASSERT_EQ(d.end() - d.begin(), 0);
+}
+
+// ----------
+// relocation
+// ----------
+
+TYPED_TEST(TestDeque, relocation_1) {
+    DEFS
+
+    deque_type d;
+    std::deque<value_type> x;
+    for (int i = 0; i < 400; ++i) {
+        const int j = (i * 37) % (d.size() + 1);
+        d.insert(d.begin() + j, i);
+        x.insert(x.begin() + j, i);}
+    for (int i = 0; i < 300; ++i) {
+        const int j = (i * 53) % d.size();
+        d.erase(d.begin() + j);
+        x.erase(x.begin() + j);}
+    ASSERT_EQ(d.size(), x.size());
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), d.begin()));
+}
+
+struct relocatable_value {
+    static int moves;
+
+    int* p;
+
+    relocatable_value (int v = 0) :
+            p(new int(v))
+        {}
+
+    relocatable_value (const relocatable_value& that) :
+            p(new int(*that.p))
+        {}
+
+    relocatable_value (relocatable_value&& that) noexcept :
+            p(that.p) {
+        that.p = 0;
+        ++moves;}
+
+    relocatable_value& operator = (relocatable_value that) {
+        std::swap(p, that.p);
+        ++moves;
+        return *this;}
+
+    ~relocatable_value () {
+        delete p;}};
+
+int relocatable_value::moves = 0;
+
+template <>
+struct is_trivially_relocatable<relocatable_value> :
+        std::true_type
+    {};
+
+TEST(TestMyDeque, relocation_2) {
+    my_deque<relocatable_value> x;
+    for (int i = 0; i < 120; ++i)
+        x.emplace_back(i);
+    relocatable_value::moves = 0;
+    x.emplace(x.begin() + 3, -1);
+    ASSERT_EQ(relocatable_value::moves, 1);
+    x.erase(x.begin() + 1);
+    ASSERT_EQ(relocatable_value::moves, 1);
+    ASSERT_EQ(x.size(), 120);
+    ASSERT_EQ(*x[0].p, 0);
+    ASSERT_EQ(*x[1].p, 2);
+    ASSERT_EQ(*x[2].p, -1);
+    ASSERT_EQ(*x[3].p, 3);
+    ASSERT_EQ(*x[119].p, 119);
+}
+
+TEST(TestMyDeque, relocation_3) {
+    my_deque<int> x(130, 7);
+    my_deque<int> y(x);
+    ASSERT_TRUE(x == y);
+    y.push_front(1);
+    my_deque<int> z(y);
+    ASSERT_EQ(z.size(), 131);
+    ASSERT_EQ(z[0], 1);
+    ASSERT_EQ(z[130], 7);
+}
+
+// --------
+// capacity
+// --------
+
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        typedef counting_allocator<U> other;};
+
+    static int allocations;
+
+    counting_allocator ()
+        {}
+
+    template <typename U>
+    counting_allocator (const counting_allocator<U>&)
+        {}
+
+    T* allocate (std::size_t n) {
+        ++allocations;
+        return std::allocator<T>::allocate(n);}};
+
+template <typename T>
+int counting_allocator<T>::allocations = 0;
+
+TEST(TestMyDeque, capacity_1) {
+    my_deque<int> x;
+    ASSERT_EQ(x.capacity(), 0);
+    x.reserve_back(1000);
+    ASSERT_TRUE(x.back_capacity() >= 1000);
+    x.reserve_front(500);
+    ASSERT_TRUE(x.front_capacity() >= 500);
+    ASSERT_TRUE(x.capacity() >= 1500);
+}
+
+TEST(TestMyDeque, capacity_2) {
+    typedef counting_allocator<int> allocator_type;
+    my_deque<int, allocator_type> x;
+    x.reserve_back(1000);
+    x.reserve_front(1000);
+    const int n = allocator_type::allocations;
+    for (int i = 0; i < 1000; ++i) {
+        x.push_back(i);
+        x.push_front(-i);}
+    ASSERT_EQ(allocator_type::allocations, n);
+    ASSERT_EQ(x.size(), 2000);
+    ASSERT_EQ(x.front(), -999);
+    ASSERT_EQ(x.back(), 999);
+}
+
+TEST(TestMyDeque, capacity_3) {
+    my_deque<int> x;
+    x.reserve_back(300);
+    for (int i = 0; i < 200; ++i)
+        x.push_back(i);
+    for (int i = 0; i < 200; ++i)
+        x.pop_back();
+    ASSERT_TRUE(x.back_capacity() >= 300);
+    x.push_back(1);
+    x.shrink_to_fit();
+    ASSERT_EQ(x.size(), 1);
+    ASSERT_EQ(x.front(), 1);
+    ASSERT_TRUE(x.capacity() <= 2 * my_deque<int>::block_width());
+    x.pop_back();
+    x.shrink_to_fit();
+    ASSERT_EQ(x.capacity(), 0);
+    x.push_front(2);
+    ASSERT_EQ(x.front(), 2);
+}
+
+TEST(TestMyDeque, growth_1) {
+    my_deque<int, std::allocator<int>, front_growth> x;
+    my_deque<int, std::allocator<int>, back_growth>  y;
+    for (int i = 0; i < 5000; ++i) {
+        x.push_front(i);
+        y.push_back(i);}
+    ASSERT_EQ(x.front(), 4999);
+    ASSERT_EQ(x.back(), 0);
+    ASSERT_EQ(y.front(), 0);
+    ASSERT_EQ(y.back(), 4999);
+    for (int i = 0; i < 5000; ++i)
+        ASSERT_EQ(x[i], y[4999 - i]);
+}
+
+// ------
+// ranges
+// ------
+
+TYPED_TEST(TestDeque, ranges_1) {
+    DEFS
+
+    deque_type d(10, 1);
+    const value_type a[] = {5, 6, 7, 8};
+    typename deque_type::iterator it = d.insert(d.begin() + 3, a, a + 4);
+    ASSERT_EQ(it - d.begin(), 3);
+    ASSERT_EQ(d.size(), 14);
+    ASSERT_EQ(d[2], 1);
+    ASSERT_EQ(d[3], 5);
+    ASSERT_EQ(d[6], 8);
+    ASSERT_EQ(d[7], 1);
+}
+
+TYPED_TEST(TestDeque, ranges_2) {
+    DEFS
+
+    deque_type d;
+    std::deque<value_type> x;
+    for (int i = 0; i < 60; ++i) {
+        d.insert(d.begin() + (i * 7) % (d.size() + 1), i % 5 + 1, i);
+        x.insert(x.begin() + (i * 7) % (x.size() + 1), i % 5 + 1, i);}
+    ASSERT_EQ(d.size(), x.size());
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), d.begin()));
+    for (int i = 0; i < 30; ++i) {
+        const int j = (i * 11) % (d.size() - 4);
+        d.erase(d.begin() + j, d.begin() + j + 4);
+        x.erase(x.begin() + j, x.begin() + j + 4);}
+    ASSERT_EQ(d.size(), x.size());
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), d.begin()));
+}
+
+TYPED_TEST(TestDeque, ranges_3) {
+    DEFS
+
+    deque_type d(200, 3);
+    typename deque_type::iterator it = d.erase(d.begin(), d.begin() + 120);
+    ASSERT_TRUE(it == d.begin());
+    ASSERT_EQ(d.size(), 80);
+    it = d.erase(d.begin() + 10, d.end());
+    ASSERT_TRUE(it == d.end());
+    ASSERT_EQ(d.size(), 10);
+    it = d.erase(d.begin() + 5, d.begin() + 5);
+    ASSERT_EQ(it - d.begin(), 5);
+    ASSERT_EQ(d.size(), 10);
+}
+
+TYPED_TEST(TestDeque, ranges_4) {
+    DEFS
+
+    deque_type d(5, 1);
+    const value_type a[] = {1, 2, 3, 4, 5, 6, 7};
+    d.assign(a, a + 7);
+    ASSERT_EQ(d.size(), 7);
+    ASSERT_TRUE(std::equal(d.begin(), d.end(), a));
+    d.assign(a + 4, a + 7);
+    ASSERT_EQ(d.size(), 3);
+    ASSERT_EQ(d[0], 5);
+    d.assign(100, 9);
+    ASSERT_EQ(d.size(), 100);
+    ASSERT_EQ(d[99], 9);
+    d.assign(2, 8);
+    ASSERT_EQ(d.size(), 2);
+    ASSERT_EQ(d[1], 8);
+}
+
+TYPED_TEST(TestDeque, ranges_5) {
+    DEFS
+
+    std::istringstream in("1 2 3 4");
+    deque_type d(3, 0);
+    d.insert(d.begin() + 1, std::istream_iterator<value_type>(in), std::istream_iterator<value_type>());
+    ASSERT_EQ(d.size(), 7);
+    ASSERT_EQ(d[0], 0);
+    ASSERT_EQ(d[1], 1);
+    ASSERT_EQ(d[4], 4);
+    ASSERT_EQ(d[5], 0);
+}
+
+TEST(TestMyDeque, ranges_6) {
+    my_deque<int> x;
+    std::vector<int> v;
+    for (int i = 0; i < 130; ++i)
+        v.push_back(i);
+    x.append_range(v);
+    x.prepend_range(v.begin(), v.begin() + 70);
+    ASSERT_EQ(x.size(), 200);
+    ASSERT_EQ(x[0], 0);
+    ASSERT_EQ(x[69], 69);
+    ASSERT_EQ(x[70], 0);
+    ASSERT_EQ(x[199], 129);
+    x.pop_front_n(75);
+    x.pop_back_n(100);
+    ASSERT_EQ(x.size(), 25);
+    ASSERT_EQ(x.front(), 5);
+    ASSERT_EQ(x.back(), 29);
+}
+
+TEST(TestMyDeque, ranges_7) {
+    std::istringstream in("1 2 3");
+    my_deque<std::string> x(2, "a");
+    x.prepend_range(std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+    ASSERT_EQ(x.size(), 5);
+    ASSERT_EQ(x[0], "1");
+    ASSERT_EQ(x[2], "3");
+    ASSERT_EQ(x[3], "a");
+    const std::string a[] = {"p", "q"};
+    x.insert(x.begin() + 1, a, a + 2);
+    x.insert(x.begin() + 4, 3, "r");
+    ASSERT_EQ(x.size(), 10);
+    ASSERT_EQ(x[1], "p");
+    ASSERT_EQ(x[2], "q");
+    ASSERT_EQ(x[3], "2");
+    ASSERT_EQ(x[6], "r");
+    ASSERT_EQ(x[7], "3");
+    x.erase(x.begin() + 1, x.begin() + 7);
+    ASSERT_EQ(x.size(), 4);
+    ASSERT_EQ(x[1], "3");
+}
+
+TEST(TestMyDeque, ring_1) {
+    my_ring_deque<int, 8> x;
+    ASSERT_EQ(x.capacity(), 8);
+    for (int i = 0; i < 8; ++i)
+        ASSERT_TRUE(x.push_back(i));
+    ASSERT_TRUE(x.full());
+    ASSERT_FALSE(x.push_back(8));
+    ASSERT_FALSE(x.push_front(-1));
+    ASSERT_EQ(x.size(), 8);
+    ASSERT_EQ(x.front(), 0);
+    ASSERT_EQ(x.back(), 7);
+    ASSERT_THROW(x.insert(x.begin() + 3, 9), std::length_error);
+    ASSERT_THROW(x.resize(9), std::length_error);
+    for (int i = 8; i < 20; ++i) {
+        x.pop_front();
+        ASSERT_TRUE(x.push_back(i));}
+    ASSERT_EQ(x.front(), 12);
+    ASSERT_EQ(x.back(), 19);
+    ASSERT_EQ(x.end() - x.begin(), 8);
+}
+
+TEST(TestMyDeque, ring_2) {
+    my_ring_deque<std::string, 4, ring_overwrite> x;
+    for (int i = 0; i < 6; ++i)
+        ASSERT_TRUE(x.push_back(std::string(1, 'a' + i)));
+    ASSERT_EQ(x.size(), 4);
+    ASSERT_EQ(x.front(), "c");
+    ASSERT_EQ(x.back(), "f");
+    ASSERT_TRUE(x.push_front("z"));
+    ASSERT_EQ(x.size(), 4);
+    ASSERT_EQ(x[0], "z");
+    ASSERT_EQ(x[1], "c");
+    ASSERT_EQ(x.back(), "e");
+    my_ring_deque<std::string, 4, ring_overwrite> y(x);
+    ASSERT_TRUE(x == y);
+    y.erase(y.begin() + 1);
+    ASSERT_EQ(y.size(), 3);
+    ASSERT_EQ(y[1], "d");
+    y.insert(y.begin() + 2, "q");
+    ASSERT_EQ(y[2], "q");
+    ASSERT_EQ(y[3], "e");
+}
+
+TEST(TestMyDeque, ring_3) {
+    my_ring_deque<int, 16> x;
+    std::deque<int> y;
+    for (int i = 0; i < 100; ++i) {
+        if (x.full()) {
+            x.erase(x.begin() + (i % x.size()));
+            y.erase(y.begin() + (i % y.size()));}
+        if (i % 3 == 0) {
+            x.push_front(i);
+            y.push_front(i);}
+        else {
+            x.insert(x.begin() + (i % (x.size() + 1)), i);
+            y.insert(y.begin() + (i % (y.size() + 1)), i);}
+        ASSERT_TRUE(std::equal(x.begin(), x.end(), y.begin()));}
+    my_ring_deque<int, 16> z(std::move(x));
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ(z.size(), y.size());
+}
+
+TEST(TestMyDeque, spsc_1) {
+    my_spsc_queue<std::string, 4> x;
+    ASSERT_TRUE(x.empty());
+    std::string v;
+    ASSERT_FALSE(x.try_pop(v));
+    for (int i = 0; i < 10; ++i)
+        ASSERT_TRUE(x.try_push(std::string(1, 'a' + i)));
+    ASSERT_EQ(x.size(), 10);
+    ASSERT_TRUE(x.try_pop(v));
+    ASSERT_EQ(v, "a");
+    std::vector<std::string> y;
+    ASSERT_EQ(x.try_pop_n(std::back_inserter(y), 6), 6);
+    ASSERT_EQ(y.front(), "b");
+    ASSERT_EQ(y.back(), "g");
+    ASSERT_EQ(x.size(), 3);
+}
+
+TEST(TestMyDeque, spsc_2) {
+    my_spsc_queue<int, 3> x(5);
+    const int a[] = {1, 2, 3, 4, 5, 6, 7};
+    ASSERT_EQ(x.try_push_n(a, 7), 5);
+    ASSERT_FALSE(x.try_push(8));
+    int v;
+    ASSERT_TRUE(x.try_pop(v));
+    ASSERT_EQ(v, 1);
+    ASSERT_EQ(x.try_push_n(a + 5, 2), 1);
+    int b[10];
+    ASSERT_EQ(x.try_pop_n(b, 10), 5);
+    ASSERT_EQ(b[0], 2);
+    ASSERT_EQ(b[4], 6);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(TestMyDeque, spsc_3) {
+    const int n = 100000;
+    my_spsc_queue<int, 64> x(1000);
+    std::thread p([&x] () {
+        int a[7];
+        for (int i = 0; i < n;) {
+            if (i % 3 == 0) {
+                const int k = std::min(7, n - i);
+                for (int j = 0; j != k; ++j)
+                    a[j] = i + j;
+                int m = x.try_push_n(a, k);
+                i += m;
+                if (!m)
+                    std::this_thread::yield();}
+            else if (x.try_push(i))
+                ++i;
+            else
+                std::this_thread::yield();}});
+    long long sum = 0;
+    int next = 0;
+    bool ordered = true;
+    int b[5];
+    while (next != n) {
+        int m = x.try_pop_n(b, 5);
+        for (int j = 0; j != m; ++j) {
+            ordered = ordered && (b[j] == next);
+            sum += b[j];
+            ++next;}
+        if (!m)
+            std::this_thread::yield();}
+    p.join();
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(sum, (long long) n * (n - 1) / 2);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(TestMyDeque, ws_deque_1) {
+    my_ws_deque<int> x(2);
+    ASSERT_EQ(x.capacity(), 2);
+    int v;
+    ASSERT_FALSE(x.pop_back(v));
+    ASSERT_FALSE(x.steal(v));
+    for (int i = 0; i < 100; ++i)
+        x.push_back(i);
+    ASSERT_EQ(x.size(), 100);
+    ASSERT_EQ(x.capacity(), 128);
+    ASSERT_TRUE(x.pop_back(v));
+    ASSERT_EQ(v, 99);
+    ASSERT_TRUE(x.steal(v));
+    ASSERT_EQ(v, 0);
+    ASSERT_EQ(x.size(), 98);
+    while (x.pop_back(v)) {}
+    ASSERT_EQ(v, 1);
+    ASSERT_TRUE(x.empty());
+}
+
+TEST(TestMyDeque, ws_deque_2) {
+    const int n = 50000;
+    my_ws_deque<int> x(4);
+    std::vector<char> seen(n, 0);
+    std::atomic<int> taken(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+    std::vector<std::vector<int> > got(3);
+    for (int k = 0; k < 3; ++k)
+        thieves.push_back(std::thread([&, k] () {
+            int v;
+            while (!done.load() || !x.empty())
+                if (x.steal(v)) {
+                    got[k].push_back(v);
+                    ++taken;}
+                else
+                    std::this_thread::yield();}));
+    int v;
+    for (int i = 0; i < n; ++i) {
+        x.push_back(i);
+        if (i % 3 == 0 && x.pop_back(v)) {
+            seen[v] += 1;
+            ++taken;}}
+    while (x.pop_back(v)) {
+        seen[v] += 1;
+        ++taken;}
+    done = true;
+    for (std::thread& t : thieves)
+        t.join();
+    for (const std::vector<int>& g : got)
+        for (int i : g)
+            seen[i] += 1;
+    ASSERT_EQ(taken.load(), n);
+    ASSERT_EQ(std::count(seen.begin(), seen.end(), 1), n);
+}
+
+namespace {
+
+long fib (my_ws_pool& p, int n) {
+    if (n < 12)
+        return n < 2 ? n : fib(p, n - 1) + fib(p, n - 2);
+    long a;
+    my_ws_pool::group g;
+    p.submit(g, [&p, &a, n] () {a = fib(p, n - 1);});
+    const long b = fib(p, n - 2);
+    p.wait(g);
+    return a + b;}
+
+}
+
+TEST(TestMyDeque, ws_pool_1) {
+    my_ws_pool p(3);
+    ASSERT_EQ(p.size(), 3);
+    ASSERT_EQ(fib(p, 22), 17711);
+    std::atomic<int> n(0);
+    for (int i = 0; i < 1000; ++i)
+        p.submit([&n] () {++n;});
+    p.wait();
+    ASSERT_EQ(n.load(), 1000);
+}
+
+TEST(TestMyDeque, ws_pool_2) {
+    my_ws_pool p(2);
+    my_ws_pool::group g;
+    std::atomic<int> n(0);
+    for (int i = 0; i < 10; ++i)
+        p.submit(g, [&n, i] () {
+            ++n;
+            if (i == 4)
+                throw std::invalid_argument("task");});
+    ASSERT_THROW(p.wait(g), std::invalid_argument);
+    ASSERT_EQ(n.load(), 10);
+    ASSERT_EQ(g.pending(), 0);
+    p.wait(g);
+}
+
+TEST(TestMyDeque, blocking_1) {
+    my_blocking_deque<std::string> x(3);
+    ASSERT_TRUE(x.try_push_back("b"));
+    ASSERT_TRUE(x.push_front(std::string("a")));
+    ASSERT_TRUE(x.push_back("c"));
+    ASSERT_FALSE(x.try_push_back("d"));
+    ASSERT_FALSE(x.push_back_for("d", std::chrono::milliseconds(5)));
+    ASSERT_EQ(x.size(), 3);
+    std::string v;
+    ASSERT_TRUE(x.try_pop_back(v));
+    ASSERT_EQ(v, "c");
+    std::vector<std::string> y;
+    ASSERT_EQ(x.drain(std::back_inserter(y), 5), 2);
+    ASSERT_EQ(y[0], "a");
+    ASSERT_EQ(y[1], "b");
+    ASSERT_FALSE(x.try_pop_front(v));
+    ASSERT_FALSE(x.pop_front_for(v, std::chrono::milliseconds(5)));
+    ASSERT_EQ(x.try_drain(std::back_inserter(y), 5), 0);
+}
+
+TEST(TestMyDeque, blocking_2) {
+    my_blocking_deque<int> x;
+    const int a[] = {1, 2, 3};
+    ASSERT_TRUE(x.push_back_n(a, a + 3));
+    x.close();
+    ASSERT_TRUE(x.closed());
+    ASSERT_FALSE(x.push_back(4));
+    ASSERT_FALSE(x.try_push_front(0));
+    int v;
+    ASSERT_TRUE(x.pop_back(v));
+    ASSERT_EQ(v, 3);
+    ASSERT_TRUE(x.pop_front(v));
+    ASSERT_EQ(v, 1);
+    ASSERT_TRUE(x.pop_front(v));
+    ASSERT_FALSE(x.pop_front(v));
+    ASSERT_FALSE(x.pop_back_for(v, std::chrono::seconds(10)));
+}
+
+TEST(TestMyDeque, blocking_3) {
+    const int n = 20000;
+    my_blocking_deque<int> x(64);
+    std::vector<std::thread> producers;
+    for (int k = 0; k < 3; ++k)
+        producers.push_back(std::thread([&x, k] () {
+            for (int i = k; i < n; i += 3)
+                if (i % 7 == 0) {
+                    const int b[] = {i};
+                    x.push_back_n(b, b + 1);}
+                else if (i % 2)
+                    x.push_back(i);
+                else
+                    x.push_front(i);}));
+    std::atomic<long long> sum(0);
+    std::atomic<int> count(0);
+    std::vector<std::thread> consumers;
+    for (int k = 0; k < 3; ++k)
+        consumers.push_back(std::thread([&x, &sum, &count, k] () {
+            int v;
+            int b[16];
+            for (;;) {
+                if (k == 0) {
+                    const std::size_t m = x.drain(b, 16);
+                    if (!m)
+                        break;
+                    for (std::size_t j = 0; j != m; ++j) {
+                        sum += b[j];
+                        ++count;}}
+                else if (k == 1 ? x.pop_front(v) : x.pop_back(v)) {
+                    sum += v;
+                    ++count;}
+                else
+                    break;}}));
+    for (std::thread& t : producers)
+        t.join();
+    x.close();
+    for (std::thread& t : consumers)
+        t.join();
+    ASSERT_EQ(count.load(), n);
+    ASSERT_EQ(sum.load(), (long long) n * (n - 1) / 2);
+}
+
+TEST(TestMyDeque, block_cache_1) {
+    typedef counting_allocator<int> allocator_type;
+    my_deque<int, allocator_type> x;
+    for (int i = 0; i < 1000; ++i)
+        x.push_back(i);
+    for (int i = 0; i < 100; ++i) {
+        x.push_back(i);
+        x.pop_front();}
+    const int n = allocator_type::allocations;
+    for (int i = 0; i < 100000; ++i) {
+        x.push_back(i);
+        x.pop_front();}
+    ASSERT_EQ(allocator_type::allocations, n);
+    ASSERT_EQ(x.size(), 1000);
+    ASSERT_TRUE(x.block_hits() > 0);
+    ASSERT_TRUE(x.block_cache_limit() > 0);
+}
+
+TEST(TestMyDeque, block_cache_2) {
+    typedef counting_allocator<int> allocator_type;
+    my_deque<int, allocator_type> x;
+    const int w = int(x.block_width());
+    x.set_block_cache(200);
+    for (int i = 0; i < 100 * w; ++i)
+        x.push_front(i);
+    x.clear();
+    ASSERT_TRUE(x.block_cache_size() >= 90);
+    const int n = allocator_type::allocations;
+    const std::size_t m = x.block_misses();
+    for (int k = 0; k < 10; ++k) {
+        for (int i = 0; i < 100 * w; ++i)
+            (i % 2 ? x.push_back(i) : x.push_front(i));
+        while (!x.empty())
+            (k % 2 ? x.pop_back() : x.pop_front());}
+    ASSERT_EQ(allocator_type::allocations, n);
+    ASSERT_EQ(x.block_misses(), m);
+    x.set_block_cache(3);
+    ASSERT_EQ(x.block_cache_size(), 3);
+    x.shrink_to_fit();
+    ASSERT_EQ(x.block_cache_size(), 0);
+    ASSERT_EQ(x.capacity(), 0);
+}
+
+TEST(TestMyDeque, block_cache_3) {
+    my_block_pool<std::string> p(my_deque<std::string>::block_width(), 100);
+    {
+    my_deque<std::string> x;
+    x.set_block_cache(0);
+    x.set_block_pool(&p);
+    for (std::size_t i = 0; i < 20 * x.block_width(); ++i)
+        x.push_back("abc");
+    x.clear();
+    x.shrink_to_fit();
+    ASSERT_TRUE(p.size() >= 19);
+    }
+    my_deque<std::string> y;
+    y.set_block_pool(&p);
+    const std::size_t n = p.size();
+    for (std::size_t i = 0; i < 10 * y.block_width(); ++i)
+        y.push_front("xyz");
+    ASSERT_EQ(y.block_misses(), 0);
+    ASSERT_TRUE(p.size() < n);
+    ASSERT_EQ(p.hits(), y.block_hits());
+    my_deque<std::string> z(std::move(y));
+    ASSERT_EQ(z.block_pool(), &p);
+    ASSERT_EQ(z.size(), 10 * z.block_width());
+    ASSERT_EQ(z.front(), "xyz");
+    z.set_block_pool(0);
+    p.set_limit(0);
+    ASSERT_EQ(p.size(), 0);
+}
+
+TEST(TestMyDeque, block_cache_4) {
+    my_block_pool<int>& p = my_deque<int>::thread_block_pool();
+    my_deque<int> x;
+    const int n = 20 * int(x.block_width());
+    x.set_block_cache(0);
+    x.set_block_pool(&p);
+    for (int i = 0; i < n; ++i)
+        x.push_back(i);
+    for (int i = 0; i < n; ++i)
+        x.pop_front();
+    const std::size_t m = x.block_misses();
+    for (int i = 0; i < n; ++i)
+        x.push_back(i);
+    ASSERT_EQ(x.block_misses(), m);
+    ASSERT_EQ(x[n - 1], n - 1);
+    x.set_block_pool(0);
+}
+
+TEST(TestMyDeque, small_1) {
+    typedef counting_allocator<std::string> allocator_type;
+    const int n = allocator_type::allocations;
+    my_small_deque<std::string, 4, allocator_type> x;
+    x.push_back("b");
+    x.push_front("a");
+    x.push_back("c");
+    x.insert(x.begin() + 1, "z");
+    ASSERT_TRUE(x.is_inline());
+    ASSERT_EQ(allocator_type::allocations, n);
+    x.push_front(x.back());
+    ASSERT_FALSE(x.is_inline());
+    ASSERT_EQ(x.size(), 5);
+    ASSERT_EQ(x[0], "c");
+    ASSERT_EQ(x[1], "a");
+    ASSERT_EQ(x[2], "z");
+    ASSERT_EQ(x[4], "c");
+    x.erase(x.begin() + 2);
+    x.shrink_to_fit();
+    ASSERT_TRUE(x.is_inline());
+    ASSERT_EQ(x.size(), 4);
+    ASSERT_EQ(x[2], "b");
+}
+
+TEST(TestMyDeque, small_2) {
+    my_small_deque<std::string, 3> x;
+    my_small_deque<std::string, 3> y;
+    x.push_back("a");
+    x.push_back("b");
+    for (int i = 0; i < 10; ++i)
+        y.push_front(std::string(1, 'k' + i));
+    x.swap(y);
+    ASSERT_EQ(x.size(), 10);
+    ASSERT_EQ(y.size(), 2);
+    ASSERT_TRUE(y.is_inline());
+    ASSERT_EQ(y[1], "b");
+    ASSERT_EQ(x.front(), "t");
+    my_small_deque<std::string, 3> z(std::move(y));
+    ASSERT_TRUE(y.empty());
+    ASSERT_EQ(z.back(), "b");
+    z = x;
+    ASSERT_TRUE(z == x);
+    x.clear();
+    ASSERT_TRUE(x.is_inline());
+    x = std::move(z);
+    ASSERT_EQ(x.size(), 10);
+    ASSERT_TRUE(z.empty());
+}
+
+TEST(TestMyDeque, small_3) {
+    my_small_deque<int, 8> x;
+    std::deque<int> y;
+    for (int i = 0; i < 200; ++i) {
+        const int k = i % 5;
+        if (k == 0) {
+            x.push_front(i);
+            y.push_front(i);}
+        else if (k == 1 && !y.empty()) {
+            x.erase(x.begin() + i % x.size());
+            y.erase(y.begin() + i % y.size());}
+        else {
+            x.insert(x.begin() + i % (x.size() + 1), i);
+            y.insert(y.begin() + i % (y.size() + 1), i);}
+        ASSERT_EQ(x.size(), y.size());
+        ASSERT_TRUE(std::equal(x.begin(), x.end(), y.begin()));
+        if (i % 37 == 0) {
+            while (x.size() > 6) {
+                x.pop_back();
+                y.pop_back();}
+            x.shrink_to_fit();
+            ASSERT_TRUE(x.is_inline());}}
+}
+
+TEST(TestMyDeque, stats_1) {
+    ASSERT_EQ(sizeof(my_deque<int>), (sizeof(my_deque<int, std::allocator<int>, deque_growth<>, deque_no_stats>)));
+    typedef my_deque<int, std::allocator<int>, deque_growth<>, deque_stats<> > deque_type;
+    deque_type x;
+    const std::size_t n = 20 * x.block_width();
+    x.set_block_cache(0);
+    for (std::size_t i = 0; i < n; ++i)
+        x.push_back(int(i));
+    const deque_stats<>& s = x.stats();
+    ASSERT_TRUE(s.allocations() >= 20);
+    ASSERT_EQ(s.max_size(), n);
+    ASSERT_TRUE(s.max_capacity() >= n);
+    ASSERT_TRUE(s.relocations() > 0);
+    ASSERT_EQ(s.moves(), 0);
+    ASSERT_TRUE(s.live_bytes() >= (n + 1) * sizeof(int));
+    ASSERT_TRUE(s.live_bytes() < s.bytes());
+    x.insert(x.begin() + 10, 5);
+    ASSERT_EQ(s.moves(), 10);
+    x.erase(x.begin() + 500, x.begin() + 600);
+    ASSERT_EQ(s.moves(), 10 + 500);
+    x.clear();
+    ASSERT_TRUE(s.deallocations() > 0);
+    ASSERT_TRUE(s.live_bytes() < s.bytes());
+    std::ostringstream out;
+    s.dump(out);
+    ASSERT_TRUE(out.str().find("allocations ") == 0);
+    ASSERT_TRUE(out.str().find("max_size " + std::to_string(n + 1) + "\n") != std::string::npos);
+    x.stats().reset();
+    ASSERT_EQ(s.allocations(), 0);
+}
+
+TEST(TestMyDeque, stats_2) {
+    typedef my_deque<std::string, std::allocator<std::string>, deque_growth<>, deque_stats<true> > deque_type;
+    deque_type x;
+    for (int i = 0; i < 100; ++i) {
+        x.push_back("a");
+        x.push_front("b");}
+    x.insert(x.begin() + 50, "c");
+    x.pop_back();
+    const std::size_t* h = x.stats().histogram(deque_op::push_back);
+    ASSERT_EQ(std::accumulate(h, h + deque_stats<true>::BUCKETS, std::size_t(0)), 100);
+    h = x.stats().histogram(deque_op::insert);
+    ASSERT_EQ(std::accumulate(h, h + deque_stats<true>::BUCKETS, std::size_t(0)), 1);
+    h = x.stats().histogram(deque_op::pop_back);
+    ASSERT_EQ(std::accumulate(h, h + deque_stats<true>::BUCKETS, std::size_t(0)), 1);
+    std::ostringstream out;
+    x.stats().dump(out);
+    ASSERT_TRUE(out.str().find("latency.push_front.le_") != std::string::npos);
+    ASSERT_EQ(x.stats().moves(), 50);
+}
+
+TEST(TestMyDeque, segments_1) {
+    my_deque<int> x;
+    ASSERT_TRUE(x.segments().empty());
+    for (int i = 0; i < 500; ++i) {
+        x.push_back(i);
+        x.push_front(-i - 1);}
+    std::vector<int> v;
+    std::size_t n = 0;
+    for (deque_span<int> s : x.segments()) {
+        ASSERT_FALSE(s.empty());
+        ASSERT_TRUE(s.size() <= my_deque<int>::block_width());
+        v.insert(v.end(), s.begin(), s.end());
+        ++n;}
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), v.begin()));
+    ASSERT_EQ(v.size(), x.size());
+    ASSERT_TRUE(n >= (x.size() + my_deque<int>::block_width() - 1) / my_deque<int>::block_width());
+    ASSERT_TRUE(n <= (x.size() + my_deque<int>::block_width() - 1) / my_deque<int>::block_width() + 1);
+    v.clear();
+    for (deque_span<int> s : x.segments(x.begin() + 7, x.begin() + 333))
+        v.insert(v.end(), s.data(), s.data() + s.size());
+    ASSERT_TRUE(std::equal(x.begin() + 7, x.begin() + 333, v.begin()));
+    ASSERT_EQ(v.size(), 326);
+    ASSERT_TRUE(x.segments(x.begin() + 50, x.begin() + 50).empty());
+    for (deque_span<int> s : x.segments(x.begin() + 1, x.begin() + 2))
+        ASSERT_EQ(s.size(), 1);}
+
+TEST(TestMyDeque, segments_2) {
+    my_deque<int> x;
+    for (int i = 0; i < 1000; ++i)
+        x.push_back(i);
+    const my_deque<int>& y = x;
+    long long sum = 0;
+    y.for_each_segment([&] (deque_span<const int> s) {
+        sum = std::accumulate(s.begin(), s.end(), sum);});
+    ASSERT_EQ(sum, 999 * 1000 / 2);
+    x.for_each_segment(x.begin() + 100, x.end(), [] (deque_span<int> s) {
+        for (std::size_t i = 0; i != s.size(); ++i)
+            s[i] = 0;});
+    ASSERT_EQ(std::count(x.begin(), x.end(), 0), 901);
+    std::size_t bytes = 0;
+    y.for_each_segment([&] (deque_span<const int> s) {
+        bytes += s.size_bytes();});
+    ASSERT_EQ(bytes, 1000 * sizeof(int));}
+
+TEST(TestMyDeque, segments_3) {
+    std::vector<int> v(777);
+    std::iota(v.begin(), v.end(), 0);
+    my_deque<int> x;
+    x.push_back(-1);
+    std::size_t k = 0;
+    ASSERT_EQ(x.write_spans(v.size(), [&] (deque_span<int> s) {
+        std::memcpy(s.data(), &v[k], s.size_bytes());
+        k += s.size();
+        return s.size();}), v.size());
+    ASSERT_EQ(x.size(), 778);
+    ASSERT_EQ(x.front(), -1);
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), x.begin() + 1));
+    ASSERT_EQ(x.write_spans(100, [] (deque_span<int> s) {
+        s[0] = 42;
+        return 1;}), 1);
+    ASSERT_EQ(x.size(), 779);
+    ASSERT_EQ(x.back(), 42);
+    ASSERT_EQ(x.write_spans(0, [] (deque_span<int>) {return 0;}), 0);
+    ASSERT_EQ(x.size(), 779);}
+
+TEST(TestMyDeque, segments_4) {
+    my_deque<std::string> x;
+    int calls = 0;
+    std::size_t n = 0;
+    try {
+        x.write_spans(3 * x.block_width(), [&] (deque_span<std::string> s) {
+            if (++calls == 3)
+                throw std::runtime_error("full");
+            for (std::size_t i = 0; i != s.size(); ++i)
+                new (&s[i]) std::string("abc");
+            n += s.size();
+            return s.size();});
+        ASSERT_TRUE(false);}
+    catch (const std::runtime_error&) {}
+    ASSERT_EQ(calls, 3);
+    ASSERT_EQ(x.size(), n);
+    ASSERT_EQ(std::count(x.begin(), x.end(), "abc"), x.size());
+    x.push_back("d");
+    ASSERT_EQ(x.back(), "d");}
+
+TEST(TestMyDeque, simd_1) {
+    my_deque<int> x;
+    for (int i = 0; i < 1000; ++i) {
+        x.push_back(i % 97 - 40);
+        x.push_front(i % 89);}
+    const deque_simd::level top = deque_simd::detect();
+    for (int k = deque_simd::scalar; k <= top; ++k) {
+        ASSERT_EQ(deque_simd::set_level(deque_simd::level(k)), k);
+        ASSERT_EQ(deque_sum(x), std::accumulate(x.begin(), x.end(), 0));
+        ASSERT_EQ(deque_sum(x, x.begin() + 3, x.begin() + 1234), std::accumulate(x.begin() + 3, x.begin() + 1234, 0));
+        ASSERT_EQ(deque_min(x), *std::min_element(x.begin(), x.end()));
+        ASSERT_EQ(deque_max(x, x.begin() + 1000, x.end()), *std::max_element(x.begin() + 1000, x.end()));
+        ASSERT_EQ(deque_minmax(x).first, -40);
+        ASSERT_EQ(deque_minmax(x).second, 88);
+        ASSERT_EQ(deque_count(x, 7), std::count(x.begin(), x.end(), 7));
+        ASSERT_EQ(deque_find(x, 56) - x.begin(), std::find(x.begin(), x.end(), 56) - x.begin());
+        ASSERT_EQ(deque_find(x, x.begin() + 1000, x.end(), -40) - x.begin(), 1000);
+        ASSERT_TRUE(deque_find(x, 1000) == x.end());
+        my_deque<int> y(x.size(), 1);
+        y.push_front(0);
+        y.pop_front();
+        deque_axpy(3, x, y);
+        for (std::size_t i = 0; i != x.size(); ++i)
+            ASSERT_EQ(y[i], 3 * x[i] + 1);}
+    deque_simd::set_level(top);}
+
+TEST(TestMyDeque, simd_2) {
+    my_deque<double> x;
+    for (int i = 0; i < 777; ++i)
+        x.push_back(i % 13 * 0.5);
+    const deque_simd::level top = deque_simd::detect();
+    for (int k = deque_simd::scalar; k <= top; ++k) {
+        deque_simd::set_level(deque_simd::level(k));
+        ASSERT_EQ(deque_sum(x), std::accumulate(x.begin(), x.end(), 0.0));
+        ASSERT_EQ(deque_sum(x, x.begin() + 1, x.begin() + 2), 0.5);
+        ASSERT_EQ(deque_sum(x, x.begin(), x.begin()), 0.0);
+        ASSERT_EQ(deque_min(x, x.begin() + 1, x.end()), 0.0);
+        ASSERT_EQ(deque_max(x), 6.0);
+        ASSERT_EQ(deque_count(x, 6.0), std::count(x.begin(), x.end(), 6.0));
+        ASSERT_EQ(deque_find(x, 5.5) - x.begin(), 11);
+        ASSERT_EQ(deque_find(x, x.begin() + 12, x.end(), 5.5) - x.begin(), 24);
+        my_deque<double> y(x.size(), 0.25);
+        deque_axpy(2.0, x, y);
+        for (std::size_t i = 0; i != x.size(); ++i)
+            ASSERT_EQ(y[i], 2.0 * x[i] + 0.25);}
+    deque_simd::set_level(top);}
+
+TEST(TestMyDeque, simd_3) {
+    my_deque<long> x;
+    for (long i = 0; i < 300; ++i)
+        x.push_back(i);
+    ASSERT_EQ(deque_sum(x), 299 * 300 / 2);
+    ASSERT_EQ(deque_count(x, 5), 1);
+    deque_transform(x, [] (long v) {return v * 2;});
+    ASSERT_EQ(x[299], 598);
+    my_deque<long> y(5, 0);
+    for (int i = 0; i < 295; ++i)
+        y.push_front(0);
+    deque_transform(x, y, [] (long v) {return v + 1;});
+    ASSERT_EQ(y[0], 1);
+    ASSERT_EQ(y[299], 599);}
+
+TEST(TestMyDeque, parallel_1) {
+    my_ws_pool p(3);
+    my_deque<int> x;
+    for (int i = 0; i < 20000; ++i)
+        x.push_back(i);
+    parallel_for_each(p, x, [] (int& v) {v *= 2;}, 500);
+    ASSERT_EQ(x[19999], 39998);
+    ASSERT_EQ(parallel_count_if(p, x, [] (int v) {return v % 3 == 0;}, 500), 6667);
+    my_deque<int> y(x.size(), 0);
+    y.push_front(0);
+    parallel_transform(p, x, y, [] (int v) {return v + 1;}, 700);
+    for (int i = 0; i < 20000; ++i)
+        ASSERT_EQ(y[i], 2 * i + 1);
+    ASSERT_EQ(y.back(), 0);
+    ASSERT_EQ(parallel_reduce(p, x), 20000LL * 19999);
+    my_deque<int> e;
+    ASSERT_EQ(parallel_reduce(p, e, 5, std::plus<int>()), 5);
+    ASSERT_EQ(parallel_count_if(p, e, [] (int) {return true;}), 0);}
+
+TEST(TestMyDeque, parallel_2) {
+    my_deque<double> x;
+    for (int i = 0; i < 50000; ++i)
+        x.push_back(1.0 / (i + 1));
+    double r[3];
+    for (int k = 0; k != 3; ++k) {
+        my_ws_pool p(k + 1);
+        r[k] = parallel_reduce(p, x, 0.0, std::plus<double>(), 1000);}
+    ASSERT_EQ(r[0], r[1]);
+    ASSERT_EQ(r[0], r[2]);
+    ASSERT_NEAR(r[0], std::accumulate(x.begin(), x.end(), 0.0), 1e-9);
+    my_ws_pool p(2);
+    ASSERT_THROW(parallel_for_each(p, x, [] (double& v) {
+        if (v < 1e-4)
+            throw std::invalid_argument("small");}, 1000), std::invalid_argument);}
+
+TEST(TestMyDeque, parallel_3) {
+    my_ws_pool p(4);
+    for (int n : {0, 1, 999, 12345}) {
+        my_deque<std::string> x;
+        unsigned r = 7;
+        for (int i = 0; i < n; ++i) {
+            r = r * 1103515245 + 12345;
+            x.push_front(std::to_string(r % 100000));}
+        std::vector<std::string> v(x.begin(), x.end());
+        std::sort(v.begin(), v.end());
+        parallel_sort(p, x, std::less<std::string>(), 1000);
+        ASSERT_TRUE(std::equal(v.begin(), v.end(), x.begin()));}
+    my_deque<int> y;
+    for (int i = 0; i < 30000; ++i)
+        y.push_back(i * 7919 % 30011);
+    parallel_sort(p, y);
+    ASSERT_TRUE(std::is_sorted(y.begin(), y.end()));}
+
+TEST(TestMyDeque, window_1) {
+    sliding_window<int> w;
+    sliding_window<int> v;
+    ASSERT_TRUE(w.empty());
+    std::deque<std::pair<int, long long> > naive;
+    unsigned r = 1;
+    std::vector<int> xs;
+    std::vector<long long> ts;
+    for (long long t = 0; t < 3000; ++t) {
+        r = r * 1103515245 + 12345;
+        const int x = int(r >> 16) % 1000;
+        w.push(x, t / 3);
+        xs.push_back(x);
+        ts.push_back(t / 3);
+        if (xs.size() == 37 || t == 2999) {
+            v.push_n(xs.begin(), ts.begin(), xs.size());
+            xs.clear();
+            ts.clear();}
+        naive.push_back(std::make_pair(x, t / 3));
+        w.evict_older_than(t / 3 - 50);
+        while (naive.front().second < t / 3 - 50)
+            naive.pop_front();
+        int lo = naive.front().first;
+        int hi = lo;
+        for (const auto& s : naive) {
+            lo = std::min(lo, s.first);
+            hi = std::max(hi, s.first);}
+        ASSERT_EQ(w.min(), lo);
+        ASSERT_EQ(w.max(), hi);
+        if (xs.empty()) {
+            v.evict_older_than(t / 3 - 50);
+            ASSERT_EQ(v.min(), lo);
+            ASSERT_EQ(v.max(), hi);}}
+    w.evict_older_than(5000);
+    ASSERT_TRUE(w.empty());}
+
+TEST(TestMyDeque, window_2) {
+    sliding_window<int, std::greater<int> > w;
+    const int xs[] = {5, 1, 4, 1, 9, 2};
+    const int ts[] = {1, 2, 3, 4, 5, 6};
+    w.push_n(xs, ts, 6);
+    ASSERT_EQ(w.min(), 9);
+    ASSERT_EQ(w.max(), 1);
+    w.evict_older_than(6);
+    ASSERT_EQ(w.min(), 2);
+    ASSERT_EQ(w.max(), 2);
+    w.push(2, 6);
+    w.evict_older_than(6);
+    ASSERT_EQ(w.max(), 2);}
+
+TEST(TestMyDeque, window_3) {
+    two_stack_window<long> s;
+    ASSERT_TRUE(s.empty());
+    for (long t = 0; t < 1000; ++t) {
+        s.push(t, t);
+        s.evict_older_than(t - 9);
+        const long lo = std::max(0L, t - 9);
+        ASSERT_EQ(s.size(), t - lo + 1);
+        ASSERT_EQ(s.aggregate(), (lo + t) * (t - lo + 1) / 2);}
+    two_stack_window<std::string> c;
+    const std::string xs[] = {"a", "b", "c", "d", "e"};
+    const int ts[] = {1, 2, 3, 4, 5};
+    c.push_n(xs, ts, 3);
+    ASSERT_EQ(c.aggregate(), "abc");
+    c.pop();
+    c.push_n(xs + 3, ts + 3, 2);
+    ASSERT_EQ(c.aggregate(), "bcde");
+    c.evict_older_than(4);
+    ASSERT_EQ(c.aggregate(), "de");
+    c.evict_older_than(6);
+    ASSERT_TRUE(c.empty());}
+
+namespace {
+
+/**
+ * a fresh directory under /tmp, removed with everything in it when the test ends
+ */
+struct temp_dir {
+    std::string _d;
+
+    temp_dir () {
+        char s[] = "/tmp/TestDeque.XXXXXX";
+        _d = mkdtemp(s);}
+
+    ~temp_dir () {
+        std::system(("rm -rf " + _d).c_str());}
+
+    std::string operator () (const char* name) const {
+        return _d + "/" + name;}
+
+    int files (const char* dir) const {
+        std::string c = "ls " + _d + "/" + dir + " | grep -c seg";
+        FILE* f = popen(c.c_str(), "r");
+        int n = 0;
+        if (fscanf(f, "%d", &n) != 1)
+            n = -1;
+        pclose(f);
+        return n;}};
+
+}
+
+TEST(TestMyDeque, mapped_1) {
+    temp_dir t;
+    my_mapped_deque<int> x(t("q"), 4096);
+    ASSERT_EQ(x.segment_size(), 1024);
+    std::deque<int> y;
+    for (int i = 0; i < 5000; ++i) {
+        x.push_back(i);
+        y.push_back(i);
+        x.push_front(-i);
+        y.push_front(-i);}
+    ASSERT_EQ(x.size(), 10000);
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));
+    int& r = x[5000];
+    for (int i = 0; i < 3000; ++i) {
+        x.pop_back();
+        x.pop_front();
+        y.pop_back();
+        y.pop_front();}
+    ASSERT_EQ(&r, &x[2000]);
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));
+    ASSERT_EQ(x.end() - x.begin(), 4000);
+    ASSERT_EQ(x.front(), y.front());
+    ASSERT_EQ(x.back(), y.back());
+    ASSERT_THROW(x.at(4000), std::out_of_range);
+    std::sort(x.begin(), x.end());
+    ASSERT_TRUE(std::is_sorted(x.begin(), x.end()));
+    x.clear();
+    ASSERT_TRUE(x.empty());}
+
+TEST(TestMyDeque, mapped_2) {
+    temp_dir t;
+    {
+    my_mapped_deque<long> x(t("q"), 8192);
+    for (long i = 0; i < 10000; ++i)
+        x.push_back(i);
+    x.checkpoint();
+    for (long i = 0; i < 5000; ++i)
+        x.pop_front();
+    ASSERT_TRUE(t.files("q") >= 10);
+    x.push_front(-1);
+    }
+    ASSERT_TRUE(t.files("q") <= 7);
+    my_mapped_deque<long> x(t("q"));
+    ASSERT_EQ(x.segment_size(), 1024);
+    ASSERT_EQ(x.size(), 5001);
+    ASSERT_EQ(x.front(), -1);
+    ASSERT_EQ(x[1], 5000);
+    ASSERT_EQ(x.back(), 9999);
+    ASSERT_THROW(my_mapped_deque<int>(t("q")), std::runtime_error);}
+
+TEST(TestMyDeque, mapped_3) {
+    temp_dir t;
+    const pid_t c = fork();
+    if (c == 0) {
+        my_mapped_deque<double> x(t("q"), 4096);
+        for (int i = 0; i < 2000; ++i)
+            x.push_back(i);
+        x.checkpoint();
+        for (int i = 0; i < 1500; ++i)
+            x.push_back(-1);
+        for (int i = 0; i < 1000; ++i)
+            x.pop_front();
+        _exit(0);}
+    int status = 0;
+    ASSERT_EQ(waitpid(c, &status, 0), c);
+    ASSERT_EQ(status, 0);
+    my_mapped_deque<double> y(t("q"));
+    ASSERT_EQ(y.size(), 2000);
+    ASSERT_EQ(y[0], 0);
+    ASSERT_EQ(y[1999], 1999);
+    ASSERT_EQ(t.files("q"), 4);}
+
+TEST(TestMyDeque, snapshot_1) {
+    my_deque<int> x;
+    for (int i = 0; i < 1000; ++i) {
+        x.push_back(i);
+        x.push_front(-i);}
+    std::stringstream s;
+    x.save(s);
+    ASSERT_EQ(s.str().size(), sizeof(deque_snapshot_header) + 2000 * sizeof(int));
+    my_deque<int> y(3, 7);
+    y.load(s);
+    ASSERT_EQ(x, y);
+    std::stringstream t(s.str().substr(0, s.str().size() - 1));
+    ASSERT_THROW(y.load(t), std::runtime_error);
+    ASSERT_TRUE(y.empty());
+    std::stringstream u("not a snapshot of anything at all, not even of nothing, long enough to read a header");
+    ASSERT_THROW(y.load(u), std::runtime_error);
+    std::stringstream v(s.str());
+    my_deque<long long> z;
+    ASSERT_THROW(z.load(v), std::runtime_error);}
+
+TEST(TestMyDeque, snapshot_2) {
+    temp_dir t;
+    my_deque<double> x;
+    for (int i = 0; i < 5000; ++i)
+        x.push_back(i / 4.0);
+    x.erase(x.begin(), x.begin() + 17);
+    int fd = open(t("s").c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    ASSERT_TRUE(fd >= 0);
+    deque_save_fd(x, fd);
+    close(fd);
+    my_deque<double> y;
+    fd = open(t("s").c_str(), O_RDONLY);
+    deque_load_fd(y, fd);
+    close(fd);
+    ASSERT_EQ(x, y);
+    const my_deque_snapshot<double> z(t("s"));
+    ASSERT_EQ(z.size(), x.size());
+    ASSERT_TRUE(std::equal(z.begin(), z.end(), x.begin()));
+    ASSERT_EQ(z.front(), x.front());
+    ASSERT_EQ(z.back(), x.back());
+    ASSERT_THROW(z.at(z.size()), std::out_of_range);
+    ASSERT_THROW(my_deque_snapshot<int>(t("s")), std::runtime_error);
+    ASSERT_EQ(truncate(t("s").c_str(), 100), 0);
+    ASSERT_THROW(my_deque_snapshot<double>(t("s")), std::runtime_error);
+    fd = open(t("s").c_str(), O_RDONLY);
+    ASSERT_THROW(deque_load_fd(y, fd), std::runtime_error);
+    close(fd);
+    ASSERT_TRUE(y.empty());}
+
+TEST(TestMyDeque, huge_1) {
+    huge_page_arena h(1, true);
+    {
+    my_deque<int, huge_page_allocator<int> > x((huge_page_allocator<int>(h)));
+    for (int i = 0; i < 100000; ++i)
+        x.push_front(i);
+    for (int i = 0; i < 100000; ++i)
+        ASSERT_EQ(x[i], 99999 - i);
+    ASSERT_EQ(h.mapped() % huge_page_arena::HUGE_PAGE, 0u);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(&x.front()) % huge_page_arena::ALIGN, 0u);
+    x.erase(x.begin() + 100, x.end() - 100);
+    ASSERT_EQ(x.size(), 200);
+    ASSERT_EQ(x.back(), 0);
+    }
+    const std::string m = huge_page_arena::thp_mode();
+    if ((m == "always") || (m == "madvise")) {
+        ASSERT_TRUE(h.huge());}}
+
+TEST(TestMyDeque, huge_2) {
+    huge_page_arena h(4 << 20);
+    ASSERT_EQ(h.mapped(), 0u);
+    h.reserve(5 << 20);
+    ASSERT_EQ(h.mapped(), std::size_t(8) << 20);
+    void* const p = h.allocate(100);
+    void* const q = h.allocate(128);
+    ASSERT_EQ(static_cast<char*>(q) - static_cast<char*>(p), 128);
+    h.deallocate(p, 100);
+    ASSERT_EQ(h.allocate(120), p);
+    void* const r = h.allocate(3 << 20);
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(r) % huge_page_arena::HUGE_PAGE, 0u);
+    ASSERT_EQ(h.mapped(), std::size_t(12) << 20);
+    h.deallocate(r, 3 << 20);
+    ASSERT_EQ(h.mapped(), std::size_t(8) << 20);
+    my_deque<double, huge_page_allocator<double> > x(5000, 0.5, huge_page_allocator<double>(h));
+    my_deque<double, huge_page_allocator<double> > y(x);
+    ASSERT_EQ(x, y);
+    ASSERT_EQ(h.mapped(), std::size_t(8) << 20);
+    ASSERT_TRUE(huge_page_allocator<int>(h) == huge_page_allocator<int>(huge_page_allocator<double>(h)));
+    ASSERT_TRUE(huge_page_allocator<int>(h) != huge_page_allocator<int>());
+    h.deallocate(q, 128);
+    h.deallocate(p, 120);}
+
+TEST(TestMyDeque, shift_1) {
+    typedef my_deque<int, std::allocator<int>, deque_growth<>, deque_stats<> > deque_type;
+    deque_type x;
+    for (int i = 0; i < 1000; ++i)
+        x.push_back(i);
+    const deque_stats<>& s = x.stats();
+    x.erase(x.begin() + 990);
+    ASSERT_EQ(s.moves(), 9);
+    x.erase(x.begin() + 5);
+    ASSERT_EQ(s.moves(), 9 + 5);
+    const int a[] = {-1, -2, -3};
+    x.insert(x.begin() + 7, a, a + 3);
+    ASSERT_EQ(s.moves(), 9 + 5 + 7);
+    x.erase(x.begin() + 900, x.begin() + 950);
+    ASSERT_EQ(s.moves(), 9 + 5 + 7 + 51);
+    ASSERT_EQ(x.size(), 951);
+    ASSERT_EQ(x[6], 7);
+    ASSERT_EQ(x[7], -1);
+    ASSERT_EQ(x[10], 8);
+    ASSERT_EQ(x[899], 897);
+    ASSERT_EQ(x[900], 948);
+    ASSERT_EQ(x.back(), 999);}
+
+TEST(TestMyDeque, shift_2) {
+    my_deque<std::string> x;
+    std::deque<std::string> y;
+    for (int i = 0; i < 400; ++i) {
+        x.push_back(std::to_string(i));
+        y.push_back(std::to_string(i));}
+    for (int i = 0; i < 100; ++i) {
+        const int j = (i * 53) % int(x.size());
+        ASSERT_EQ(*x.insert(x.begin() + j, "n"), "n");
+        y.insert(y.begin() + j, "n");
+        const int k = (i * 71) % int(x.size());
+        const my_deque<std::string>::iterator p = x.erase(x.begin() + k);
+        ASSERT_EQ(p - x.begin(), k);
+        y.erase(y.begin() + k);}
+    x.insert(x.begin() + 30, 4, "f");
+    y.insert(y.begin() + 30, 4, "f");
+    std::istringstream in("a b c");
+    x.insert(x.begin() + 40, std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+    y.insert(y.begin() + 40, {"a", "b", "c"});
+    std::istringstream im("d e");
+    x.insert(x.end() - 40, std::istream_iterator<std::string>(im), std::istream_iterator<std::string>());
+    y.insert(y.end() - 40, {"d", "e"});
+    x.erase(x.begin() + 10, x.begin() + 30);
+    y.erase(y.begin() + 10, y.begin() + 30);
+    x.erase(x.end() - 30, x.end() - 10);
+    y.erase(y.end() - 30, y.end() - 10);
+    ASSERT_EQ(x.size(), y.size());
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));}
+
+TEST(TestMyDeque, remove_if_1) {
+    typedef my_deque<int, std::allocator<int>, deque_growth<>, deque_stats<> > deque_type;
+    const int w = int(deque_type::block_width());
+    std::mt19937 g(3);
+    for (int t = 0; t < 40; ++t) {
+        const int n = std::uniform_int_distribution<int>(0, 6 * w)(g);
+        const int m = std::uniform_int_distribution<int>(1, 5)(g);
+        std::vector<int> y;
+        deque_type x;
+        deque_type z;
+        for (int i = 0; i < n; ++i) {
+            y.push_back(i);
+            x.push_back(i);
+            z.push_back(i);}
+        int calls = 0;
+        const auto p = [&calls, m, n] (int v) {++calls; return (v % m == 0) && (v > n / 3);};
+        y.erase(std::remove_if(y.begin(), y.end(), p), y.end());
+        calls = 0;
+        ASSERT_EQ(x.remove_if(p), n - int(y.size()));
+        ASSERT_EQ(calls, n);
+        ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));
+        ASSERT_EQ(x.size(), y.size());
+        calls = 0;
+        ASSERT_EQ(z.remove_if_shorter(p), n - int(y.size()));
+        ASSERT_EQ(calls, n);
+        ASSERT_EQ(x, z);}
+    deque_type x;
+    for (int i = 0; i < 10 * w; ++i)
+        x.push_back(i);
+    const deque_stats<>& s = x.stats();
+    const std::size_t k = s.moves();
+    ASSERT_EQ(x.remove_if_shorter([] (int v) {return v < 9;}), 9);
+    ASSERT_EQ(s.moves(), k);
+    ASSERT_EQ(x.remove_if_shorter([] (int v) {return (v == 10) || (v == 12);}), 2);
+    ASSERT_EQ(s.moves(), k + 2);
+    ASSERT_EQ(x.remove_if_shorter([w] (int v) {return (v == 10 * w - 3) || (v == 10 * w - 5);}), 2);
+    ASSERT_EQ(s.moves(), k + 2 + 3);
+    ASSERT_EQ(x.front(), 9);
+    ASSERT_EQ(x[2], 13);
+    ASSERT_EQ(x.back(), 10 * w - 1);
+    ASSERT_EQ(erase_if(x, [w] (int v) {return v >= w;}), 9 * w - 2);
+    ASSERT_EQ(x.size(), w - 11);
+    ASSERT_TRUE(x.capacity() < 3 * deque_type::size_type(w));}
+
+TEST(TestMyDeque, remove_if_2) {
+    my_deque<std::string> x;
+    for (int i = 0; i < 300; ++i)
+        x.push_back(std::to_string(i));
+    my_deque<std::string> y(x);
+    int calls = 0;
+    const auto p = [&calls] (const std::string& v) {
+        if (++calls == 200)
+            throw std::runtime_error("p");
+        return v.size() == 2;};
+    ASSERT_THROW(x.remove_if(p), std::runtime_error);
+    ASSERT_EQ(x.size(), 300 - 90);
+    ASSERT_EQ(x[9], "9");
+    ASSERT_EQ(x[10], "100");
+    ASSERT_EQ(x.back(), "299");
+    calls = 0;
+    ASSERT_THROW(y.remove_if_shorter(p), std::runtime_error);
+    ASSERT_EQ(y.size(), 300);
+    ASSERT_EQ(y[150], "150");
+    calls = 0;
+    ASSERT_EQ(erase_if(y, [] (const std::string& v) {return v.back() != '7';}), 270);
+    ASSERT_EQ(y.front(), "7");
+    ASSERT_EQ(y.back(), "297");
+    ASSERT_EQ(y.remove_if_shorter([] (const std::string& v) {return v.size() < 3;}), 10);
+    ASSERT_EQ(y.front(), "107");}
+
+TEST(TestMyDeque, block_size_1) {
+    struct big {char c[3000];};
+    struct odd {char c[24];};
+    ASSERT_EQ(my_deque<int>::block_width(), 1024);
+    ASSERT_EQ(my_deque<double>::block_width(), 512);
+    ASSERT_EQ(my_deque<odd>::block_width(), 128);
+    ASSERT_EQ(my_deque<big>::block_width(), 16);
+    ASSERT_EQ(my_deque<short>::block_width(), 7);
+    ASSERT_EQ((deque_block_size<int, 256, 4>::value), 64);
+    ASSERT_EQ((deque_block_size<big, 256, 4>::value), 4);
+    my_deque<big> x;
+    for (int i = 0; i < 100; ++i) {
+        x.push_back(big());
+        x.back().c[0] = char(i);
+        x.push_front(big());
+        x.front().c[0] = char(-i);}
+    ASSERT_EQ(x.size(), 200);
+    ASSERT_EQ((x.begin() + 150)->c[0], 50);
+    ASSERT_EQ(x[99].c[0], 0);
+    ASSERT_EQ((x.end() - 1) - (x.begin() + 3), 196);
+    ASSERT_EQ((x.end() - 197)->c[0], -96);}
+
+TEST(TestMyDeque, tiered_1) {
+    my_tiered_deque<std::string> x;
+    std::deque<std::string> y;
+    std::mt19937 g(7);
+    for (int r = 0; r < 20000; ++r) {
+        const std::size_t n = y.size();
+        const std::string v = std::to_string(r);
+        switch (g() % 8) {
+            case 0:
+                x.push_back(v);
+                y.push_back(v);
+                break;
+            case 1:
+                x.push_front(v);
+                y.push_front(v);
+                break;
+            case 2:
+            case 3:
+            case 4: {
+                const std::size_t i = g() % (n + 1);
+                ASSERT_EQ(*x.insert(x.begin() + i, v), v);
+                y.insert(y.begin() + i, v);
+                break;}
+            case 5:
+            case 6:
+                if (n) {
+                    const std::size_t i = g() % n;
+                    const my_tiered_deque<std::string>::iterator p = x.erase(x.begin() + i);
+                    ASSERT_EQ(std::size_t(p - x.begin()), i);
+                    y.erase(y.begin() + i);}
+                break;
+            default:
+                if (n) {
+                    x.pop_back();
+                    y.pop_back();}}
+        ASSERT_EQ(x.size(), y.size());
+        if (r % 500 == 0) {
+            ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));}}
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));
+    ASSERT_TRUE(x.block_width() >= 32);
+    while (x.size() > 100) {
+        x.pop_front();
+        y.pop_front();}
+    ASSERT_EQ(x.block_width(), 16);
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));
+    x.erase(x.begin() + 10, x.begin() + 30);
+    y.erase(y.begin() + 10, y.begin() + 30);
+    x.insert(x.begin() + 60, 5, "five");
+    y.insert(y.begin() + 60, 5, "five");
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));}
+
+TEST(TestMyDeque, tiered_2) {
+    typedef counting_allocator<int> allocator_type;
+    {
+    my_tiered_deque<int, allocator_type> x;
+    for (int i = 0; i < 100000; ++i)
+        x.push_back(i);
+    ASSERT_EQ(x.block_width(), 256);
+    for (int i = 0; i < 1000; ++i)
+        x.insert(x.begin() + 50000, -i);
+    ASSERT_EQ(x[50000], -999);
+    ASSERT_EQ(x[50999], 0);
+    ASSERT_EQ(x[51000], 50000);
+    ASSERT_EQ(x.back(), 99999);
+    my_tiered_deque<int, allocator_type> y(x);
+    ASSERT_EQ(x, y);
+    y.erase(y.begin() + 50000, y.begin() + 51000);
+    ASSERT_TRUE(std::is_sorted(y.begin(), y.end()));
+    x = std::move(y);
+    ASSERT_EQ(x.size(), 100000);
+    ASSERT_TRUE(y.empty());
+    }
+    my_tiered_deque<int> z(5, 1);
+    z.push_front(0);
+    ASSERT_EQ(z.front(), 0);
+    ASSERT_THROW(z.at(6), std::out_of_range);}